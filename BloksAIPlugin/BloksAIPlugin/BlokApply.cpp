@@ -0,0 +1,458 @@
+#include "IllustratorSDK.h"
+#include "BlokApply.h"
+#include "BloksAIPluginSuites.h"
+
+#include <algorithm>
+
+/**	The matrix for a change: scale about the top left, then translate. The
+	top left is (left, -top) in Illustrator's coordinates.
+*/
+static AIRealMatrix GetChangeMatrix(const BlokChange& change)
+{
+	const BlokRect& actual = change.from;
+	AIReal scaleX = 1.0;
+	AIReal scaleY = 1.0;
+
+	if (change.kind != kBlokChangeTranslate)
+	{
+		scaleX = change.to.width / (actual.width == 0.0 ? 1.0 : actual.width);
+		scaleY = change.to.height / (actual.height == 0.0 ? 1.0 : actual.height);
+	}
+
+	AIReal deltaX = change.to.left - actual.left;
+	AIReal deltaY = change.to.top - actual.top;
+
+	// Invert Y coordinate to go from screen to cartesian
+	AIReal aiDeltaY = -deltaY;
+
+	AIRealMatrix matrix;
+	matrix.a = scaleX;
+	matrix.b = 0.0;
+	matrix.c = 0.0;
+	matrix.d = scaleY;
+	matrix.tx = actual.left - scaleX * actual.left + deltaX;
+	matrix.ty = scaleY * actual.top - actual.top + aiDeltaY;
+
+	return matrix;
+}
+
+/**	Port of the checks Blok.layout() makes. Decide what it takes to turn
+	actual into desired.
+@param art IN art being laid out.
+@param isAreaText IN true if art is area text.
+@param actual IN its bounds when captured.
+@param desired IN where the layout wants it.
+@param change OUT what to do, only valid if true is returned.
+@return true if the art has to move or resize.
+*/
+static bool DiffArt(AIArtHandle art, bool isAreaText, const BlokRect& actual, const BlokRect& desired, BlokChange& change)
+{
+	AIReal actualWidth = actual.width == 0.0 ? 1.0 : actual.width;
+	AIReal actualHeight = actual.height == 0.0 ? 1.0 : actual.height;
+
+	AIReal scaleX = desired.width / actualWidth;
+	AIReal scaleY = desired.height / actualHeight;
+
+	bool isScaleRequested = !BlokNearlyEqual(scaleX * 100.0, 100.0) || !BlokNearlyEqual(scaleY * 100.0, 100.0);
+	bool isMoveRequested = !BlokNearlyEqual(desired.left - actual.left, 0.0) || !BlokNearlyEqual(desired.top - actual.top, 0.0);
+
+	change.art = art;
+	change.kind = kBlokChangeTranslate;
+
+	if (isScaleRequested)
+	{
+		// Moving area text is fine, it's only scaling that distorts it
+		change.kind = isAreaText ? kBlokChangeTextPath : kBlokChangeResize;
+	}
+
+	change.from = actual;
+	change.to = desired;
+
+	if (!isScaleRequested)
+	{
+		change.to.width = actual.width;
+		change.to.height = actual.height;
+	}
+
+	change.matrix = GetChangeMatrix(change);
+
+	return isScaleRequested || isMoveRequested;
+}
+
+/** Grow a rect to include another */
+static void Union(BlokRect& rect, const BlokRect& other, bool& isEmpty)
+{
+	if (isEmpty)
+	{
+		rect = other;
+		isEmpty = false;
+		return;
+	}
+
+	AIReal right = std::max(rect.left + rect.width, other.left + other.width);
+	AIReal bottom = std::max(rect.top + rect.height, other.top + other.height);
+
+	rect.left = std::min(rect.left, other.left);
+	rect.top = std::min(rect.top, other.top);
+	rect.width = right - rect.left;
+	rect.height = bottom - rect.top;
+}
+
+/**	How a node's art, or everything in a container, moves. A container is rigid
+	if nothing in it resizes and everything moves by the same amount, in which
+	case a single transform of the group does the job.
+*/
+struct NodeMotion
+{
+	bool isRigid;
+	AIReal deltaX;
+	AIReal deltaY;
+};
+
+/** Fold the motion of one piece of art into its container's */
+static void CombineMotion(NodeMotion& motion, const NodeMotion& other, bool& isFirst)
+{
+	if (isFirst)
+	{
+		motion = other;
+		isFirst = false;
+	}
+	else
+	{
+		motion.isRigid = motion.isRigid && other.isRigid &&
+			BlokNearlyEqual(motion.deltaX, other.deltaX) &&
+			BlokNearlyEqual(motion.deltaY, other.deltaY);
+	}
+}
+
+/** The motion a single change (or no change) describes */
+static NodeMotion GetMotion(bool hasChange, const BlokChange& change)
+{
+	NodeMotion motion = { true, 0.0, 0.0 };
+
+	if (hasChange)
+	{
+		motion.isRigid = change.kind == kBlokChangeTranslate;
+		motion.deltaX = change.to.left - change.from.left;
+		motion.deltaY = change.to.top - change.from.top;
+	}
+
+	return motion;
+}
+
+void BlokApplier::Diff(const BlokSnapshot& snapshot, std::vector<BlokChange>& changes, std::vector<BlokRect>& bounds)
+{
+	const BlokLayoutTree& tree = snapshot.tree;
+	size_t size = tree.Size();
+
+	changes.clear();
+	bounds.assign(size, BlokRect());
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	// What every Blok and .bg would need on its own
+	std::vector<BlokRect> desired(size);
+	std::vector<BlokChange> artChanges(size);
+	std::vector<BlokChange> bgChanges(size);
+	std::vector<char> hasArtChange(size, 0);
+	std::vector<char> hasBgChange(size, 0);
+
+	// Parents always come before their children, so a forward sweep can add
+	// up the offsets
+	for (size_t node = 0; node < size; node++)
+	{
+		BlokRect& rect = desired[node];
+
+		if (node == 0)
+		{
+			// The root never moves
+			rect.left = snapshot.rect[0].left;
+			rect.top = snapshot.rect[0].top;
+		}
+		else
+		{
+			const BlokRect& parentRect = desired[tree.parent[node]];
+
+			rect.left = parentRect.left + tree.layoutLeft[node];
+			rect.top = parentRect.top + tree.layoutTop[node];
+		}
+
+		rect.width = tree.layoutWidth[node];
+		rect.height = tree.layoutHeight[node];
+
+		if (!snapshot.isContainer[node])
+		{
+			hasArtChange[node] = DiffArt(snapshot.art[node], snapshot.isAreaText[node], snapshot.rect[node], rect, artChanges[node]);
+			bounds[node] = hasArtChange[node] ? artChanges[node].to : snapshot.rect[node];
+		}
+		else if (snapshot.bg[node])
+		{
+			hasBgChange[node] = DiffArt(snapshot.bg[node], false, snapshot.bgRect[node], rect, bgChanges[node]);
+		}
+	}
+
+	// Containers are as big as everything in them, and move rigidly if
+	// everything in them does. Children again come first going backwards.
+	std::vector<NodeMotion> motion(size);
+
+	for (size_t node = size; node-- > 0;)
+	{
+		if (!snapshot.isContainer[node])
+		{
+			motion[node] = GetMotion(hasArtChange[node] != 0, artChanges[node]);
+			continue;
+		}
+
+		BlokRect rect = snapshot.rect[node];
+		bool isEmpty = true;
+		bool isFirst = true;
+
+		motion[node].isRigid = true;
+		motion[node].deltaX = 0.0;
+		motion[node].deltaY = 0.0;
+
+		if (snapshot.bg[node])
+		{
+			Union(rect, hasBgChange[node] ? bgChanges[node].to : snapshot.bgRect[node], isEmpty);
+			CombineMotion(motion[node], GetMotion(hasBgChange[node] != 0, bgChanges[node]), isFirst);
+		}
+
+		for (size_t child = tree.firstChild[node]; child < tree.firstChild[node] + tree.childCount[node]; child++)
+		{
+			Union(rect, bounds[child], isEmpty);
+			CombineMotion(motion[node], motion[child], isFirst);
+		}
+
+		bounds[node] = rect;
+	}
+
+	// Emit one transform per art, from the top down. A container that moves
+	// rigidly is translated as a group instead, which covers its whole subtree.
+	std::vector<char> isCovered(size, 0);
+
+	for (size_t node = 0; node < size; node++)
+	{
+		if (node > 0 && isCovered[tree.parent[node]])
+		{
+			isCovered[node] = 1;
+			continue;
+		}
+
+		if (!snapshot.isContainer[node])
+		{
+			if (hasArtChange[node])
+			{
+				changes.push_back(artChanges[node]);
+			}
+		}
+		else if (node > 0 &&
+			motion[node].isRigid &&
+			(!BlokNearlyEqual(motion[node].deltaX, 0.0) || !BlokNearlyEqual(motion[node].deltaY, 0.0)))
+		{
+			BlokChange change;
+			change.art = snapshot.art[node];
+			change.kind = kBlokChangeTranslate;
+			change.from = snapshot.rect[node];
+			change.to = change.from;
+			change.to.left += motion[node].deltaX;
+			change.to.top += motion[node].deltaY;
+			change.matrix = GetChangeMatrix(change);
+
+			changes.push_back(change);
+			isCovered[node] = 1;
+		}
+		else if (hasBgChange[node])
+		{
+			changes.push_back(bgChanges[node]);
+		}
+	}
+}
+
+AIErr BlokApplier::Apply(BlokSnapshot& snapshot)
+{
+	Diff(snapshot, fChanges, fBounds);
+
+	AIErr error = ApplyChanges(fChanges);
+
+	if (!error)
+	{
+		error = SaveTags(snapshot, fBounds);
+	}
+
+	return error;
+}
+
+AIErr BlokApplier::ApplyChanges(const std::vector<BlokChange>& changes)
+{
+	AIErr error = kNoErr;
+
+	for (size_t i = 0; !error && i < changes.size(); i++)
+	{
+		error = ApplyChange(changes[i]);
+	}
+
+	return error;
+}
+
+AIErr BlokApplier::ApplyChange(const BlokChange& change)
+{
+	AIErr error = kNoErr;
+
+	if (change.kind == kBlokChangeTextPath)
+	{
+		error = ApplyTextPath(change);
+	}
+	else
+	{
+		error = sAITransformArt->TransformArt(change.art, &change.matrix, 1.0, kTransformObjects | kTransformChildren);
+
+		if (!error)
+		{
+			fCallCount++;
+			fWriteCount++;
+
+			// The change from to back to from undoes it
+			BlokChange back = change;
+			back.from = change.to;
+			back.to = change.from;
+
+			BlokAppliedWrite write;
+			write.kind = change.kind;
+			write.isTag = false;
+			write.art = change.art;
+			write.inverse = GetChangeMatrix(back);
+
+			fWrites.push_back(write);
+		}
+	}
+
+	if (!error)
+	{
+		fChangeCount++;
+	}
+
+	return error;
+}
+
+AIErr BlokApplier::SaveTags(BlokSnapshot& snapshot, const std::vector<BlokRect>& bounds)
+{
+	AIErr error = kNoErr;
+
+	// Tags only get dirty if the value actually changed
+	for (size_t i = 0; !error && i < snapshot.tags.size(); i++)
+	{
+		snapshot.tags[i].SetNumber("cachedWidth", bounds[i].width);
+		snapshot.tags[i].SetNumber("cachedHeight", bounds[i].height);
+
+		if (snapshot.tags[i].IsDirty())
+		{
+			BlokAppliedWrite write;
+			write.kind = kBlokChangeTranslate;
+			write.isTag = true;
+			write.art = snapshot.art[i];
+
+			error = BlokReadTag(snapshot.art[i], write.tag);
+
+			if (!error)
+			{
+				error = BlokWriteTag(snapshot.art[i], snapshot.tags[i]);
+			}
+
+			if (!error)
+			{
+				fCallCount++;
+				fWriteCount++;
+				fWrites.push_back(write);
+			}
+		}
+	}
+
+	return error;
+}
+
+/**	Port of the AREATEXT half of Blok.layout(). Instead of setting the
+	textPath's left, top, width and height one at a time, map every point of
+	the path through the change's matrix and write them back in one go.
+@param change IN a kBlokChangeTextPath change.
+*/
+AIErr BlokApplier::ApplyTextPath(const BlokChange& change)
+{
+	AIArtHandle path = NULL;
+	ai::int16 count = 0;
+	std::vector<AIPathSegment> segments;
+
+	// Only calls that went through are counted
+	AIErr error = sAITextFrame->GetPathObject(change.art, &path);
+
+	if (!error)
+	{
+		fCallCount++;
+		error = sAIPath->GetPathSegmentCount(path, &count);
+	}
+
+	if (!error && count > 0)
+	{
+		segments.resize(count);
+		error = sAIPath->GetPathSegments(path, 0, count, &segments[0]);
+
+		BlokAppliedWrite write;
+		write.kind = kBlokChangeTextPath;
+		write.isTag = false;
+		write.art = path;
+
+		if (!error)
+		{
+			fCallCount++;
+
+			write.segments = segments;
+			BlokTransformPathSegments(segments, change.matrix);
+			error = sAIPath->SetPathSegments(path, 0, count, &segments[0]);
+		}
+
+		if (!error)
+		{
+			fCallCount++;
+			fWriteCount++;
+			fWrites.push_back(write);
+		}
+	}
+
+	return error;
+}
+
+AIErr BlokApplier::Rollback()
+{
+	AIErr error = kNoErr;
+
+	// Newest first, and keep going so as much as possible is put back
+	for (size_t i = fWrites.size(); i-- > 0;)
+	{
+		const BlokAppliedWrite& write = fWrites[i];
+		AIErr writeError = kNoErr;
+
+		if (write.isTag)
+		{
+			writeError = BlokWriteTag(write.art, write.tag);
+		}
+		else if (write.kind == kBlokChangeTextPath)
+		{
+			writeError = sAIPath->SetPathSegments(write.art, 0, (ai::int16)write.segments.size(), &write.segments[0]);
+		}
+		else
+		{
+			writeError = sAITransformArt->TransformArt(write.art, &write.inverse, 1.0, kTransformObjects | kTransformChildren);
+		}
+
+		if (!error)
+		{
+			error = writeError;
+		}
+	}
+
+	fWrites.clear();
+
+	return error;
+}
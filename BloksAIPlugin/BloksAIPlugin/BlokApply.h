@@ -0,0 +1,155 @@
+#ifndef __BlokApply_h__
+#define __BlokApply_h__
+
+#include "IllustratorSDK.h"
+#include "BlokArt.h"
+#include "BlokSnapshot.h"
+
+#include <vector>
+
+/** What has to happen to a piece of art to match a solved layout */
+enum BlokChangeKind
+{
+	/** Moved, same size */
+	kBlokChangeTranslate = 0,
+
+	/** Scaled about its top left, and maybe moved */
+	kBlokChangeResize = 1,
+
+	/**	Area text that resizes. Transforming it would scale the text, so its
+		text path is moved and resized instead, like Blok.layout() does.
+	*/
+	kBlokChangeTextPath = 2
+};
+
+/** A single entry of the change list BlokApplier::Diff() builds */
+struct BlokChange
+{
+	AIArtHandle art;
+	BlokChangeKind kind;
+
+	/** Bounds at capture time */
+	BlokRect from;
+
+	/** Bounds after the change */
+	BlokRect to;
+
+	/**	Transform that takes from to to, precomputed so applying is a single SDK
+		call. For kBlokChangeTextPath it maps the text path's points instead.
+	*/
+	AIRealMatrix matrix;
+};
+
+/** What BlokApplier::Rollback() needs to take back one write */
+struct BlokAppliedWrite
+{
+	/** kBlokChangeTextPath for a text path, the other kinds for a transform */
+	BlokChangeKind kind;
+
+	/** True for a tag write, kind is ignored then */
+	bool isTag;
+
+	/** The art written to, the text path itself for kBlokChangeTextPath */
+	AIArtHandle art;
+
+	/** Transform that takes the art back to where it was */
+	AIRealMatrix inverse;
+
+	/** The text path before it was rewritten */
+	std::vector<AIPathSegment> segments;
+
+	/** The tag before it was written */
+	BlokTagData tag;
+};
+
+/**	Moves and resizes art to match a solved BlokSnapshot. This does what
+	BlokContainer.layout() and Blok.layout() do, but works out every rect and
+	matrix up front in Diff(), which can run on any thread. ApplyChanges() and
+	SaveTags() then only make the SDK calls that are needed, and have to run on
+	the main thread.
+*/
+class BlokApplier
+{
+public:
+	BlokApplier() : fChangeCount(0), fCallCount(0), fWriteCount(0) {}
+
+	/**	Diff, apply and save the tags of a single snapshot.
+	@param snapshot IN/OUT a captured and solved snapshot. Its tags are updated.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Apply(BlokSnapshot& snapshot);
+
+	/**	Compare the solved layout of a snapshot against the bounds it was
+		captured with. Doesn't call into Illustrator.
+
+		Every node is placed relative to the root's captured top left and every
+		art gets at most one transform, so the cost is linear in the number of
+		leaves. A nested BlokContainer is a group that follows its children, so
+		it's only transformed when everything in it moves by the same amount
+		without resizing, in which case that one translate replaces theirs. Art
+		that doesn't move or resize isn't listed.
+	@param snapshot IN a captured and solved snapshot.
+	@param changes OUT the change list, cleared first.
+	@param bounds OUT the bounds each node's art will have once the changes are made.
+	*/
+	static void Diff(const BlokSnapshot& snapshot, std::vector<BlokChange>& changes, std::vector<BlokRect>& bounds);
+
+	/**	Transform every art in a change list, one TransformArt call each, or
+		a rewrite of the text path for area text.
+	@param changes IN change list from Diff().
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr ApplyChanges(const std::vector<BlokChange>& changes);
+
+	/**	Transform a single art from a change list. Changes don't depend on each
+		other, so a list can be applied in any order and spread over several
+		calls.
+	@param change IN an entry from Diff().
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr ApplyChange(const BlokChange& change);
+
+	/**	Cache every node's new dims in its tag, like Blok.layout() and
+		BlokContainer.layout() do, and write the tags that changed.
+	@param snapshot IN/OUT snapshot the changes were made for.
+	@param bounds IN bounds from Diff().
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr SaveTags(BlokSnapshot& snapshot, const std::vector<BlokRect>& bounds);
+
+	/** Number of art transformed so far */
+	size_t GetChangeCount() const { return fChangeCount; }
+
+	/** Number of SDK calls that went through so far, transforms and tag writes */
+	size_t GetCallCount() const { return fCallCount; }
+
+	/** True once any of those calls changed the document */
+	bool HasWritten() const { return fWriteCount > 0; }
+
+	/**	Keep everything written so far, Rollback() won't take it back.
+	*/
+	void Commit() { fWrites.clear(); }
+
+	/**	Take back every transform, text path and tag written since this
+		applier was made or last committed, newest first. Only touches what
+		the applier wrote, unlike undoing the whole undo context.
+	@return kNoErr if everything was put back, other AIErr otherwise.
+	*/
+	AIErr Rollback();
+
+private:
+	AIErr ApplyTextPath(const BlokChange& change);
+
+	// Since the last Commit(), for Rollback()
+	std::vector<BlokAppliedWrite> fWrites;
+
+	// Reused between Apply calls
+	std::vector<BlokChange> fChanges;
+	std::vector<BlokRect> fBounds;
+
+	size_t fChangeCount;
+	size_t fCallCount;
+	size_t fWriteCount;
+};
+
+#endif
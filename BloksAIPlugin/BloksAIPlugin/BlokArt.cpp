@@ -0,0 +1,293 @@
+#include "IllustratorSDK.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+#include <cmath>
+#include <limits>
+
+bool BlokNearlyEqual(AIReal a, AIReal b)
+{
+	const AIReal epsilon = 0.0001;
+	const AIReal minValue = std::numeric_limits<AIReal>::denorm_min();
+	const AIReal maxValue = std::numeric_limits<AIReal>::max();
+
+	AIReal absA = std::fabs(a);
+	AIReal absB = std::fabs(b);
+	AIReal diff = std::fabs(a - b);
+
+	if (a == b)
+	{
+		return true;
+	}
+	else if (a == 0 || b == 0 || diff < minValue)
+	{
+		return diff < (epsilon * minValue);
+	}
+	else
+	{
+		return (diff / std::min(absA + absB, maxValue)) < epsilon;
+	}
+}
+
+bool BlokIsKeyInString(const std::string& name, const char* key)
+{
+	if (name.empty())
+	{
+		return false;
+	}
+
+	std::string k(key);
+
+	if (name == k) // exact match
+	{
+		return true;
+	}
+	else if (name.find(k) != std::string::npos)
+	{
+		if (name.find(k + " ") == 0 || // start of the string
+			name.find(" " + k) == name.length() - k.length() - 1 || // end of the string
+			name.find(" " + k + " ") != std::string::npos) // inside of the string
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+AIErr BlokGetArtName(AIArtHandle art, std::string& name)
+{
+	ai::UnicodeString uName;
+	ASBoolean isDefaultName = false;
+
+	AIErr error = sAIArt->GetArtName(art, uName, &isDefaultName);
+
+	if (!error)
+	{
+		name = isDefaultName ? std::string() : uName.as_UTF8();
+	}
+
+	return error;
+}
+
+/** Convert Illustrator bounds to screen coordinates */
+static BlokRect ToBlokRect(const AIRealRect& bounds)
+{
+	BlokRect rect;
+
+	// Illustrator's y axis points up, ours points down
+	rect.left = std::min(bounds.left, bounds.right);
+	rect.top = -std::max(bounds.top, bounds.bottom);
+	rect.width = std::fabs(bounds.right - bounds.left);
+	rect.height = std::fabs(bounds.top - bounds.bottom);
+
+	return rect;
+}
+
+AIErr BlokGetArtRect(AIArtHandle art, BlokRect& rect)
+{
+	AIRealRect bounds;
+	AIErr error = sAIArt->GetArtTransformBounds(art, NULL, kNoStrokeBounds, &bounds);
+
+	if (!error)
+	{
+		rect = ToBlokRect(bounds);
+	}
+
+	return error;
+}
+
+void BlokGetVisibleRects(std::vector<BlokRect>& rects)
+{
+	AIRealRect bounds;
+	rects.clear();
+
+	if (sAIDocumentView->GetDocumentViewBounds(NULL, &bounds) == kNoErr)
+	{
+		rects.push_back(ToBlokRect(bounds));
+	}
+
+	if (ai::ArtboardUtils::GetActiveArtboardPosition(bounds) == kNoErr)
+	{
+		rects.push_back(ToBlokRect(bounds));
+	}
+}
+
+AIErr BlokGetViewRect(AIDocumentViewHandle view, const BlokRect& rect, AIRect& viewRect)
+{
+	AIRealRect artworkRect;
+
+	// Our y axis points down, Illustrator's up
+	artworkRect.left = rect.left;
+	artworkRect.top = -rect.top;
+	artworkRect.right = rect.left + rect.width;
+	artworkRect.bottom = -(rect.top + rect.height);
+
+	return sAIDocumentView->ArtworkRectToViewRect(view, &artworkRect, &viewRect);
+}
+
+bool BlokRectsIntersect(const BlokRect& rect1, const BlokRect& rect2)
+{
+	return rect1.left <= rect2.left + rect2.width &&
+		rect2.left <= rect1.left + rect1.width &&
+		rect1.top <= rect2.top + rect2.height &&
+		rect2.top <= rect1.top + rect1.height;
+}
+
+bool BlokIsDocumentOpen(AIDocumentHandle document)
+{
+	ai::int32 count = 0;
+
+	if (!document || sAIDocumentList->Count(&count) != kNoErr)
+	{
+		return false;
+	}
+
+	for (ai::int32 i = 0; i < count; i++)
+	{
+		AIDocumentHandle open = NULL;
+
+		if (sAIDocumentList->GetNthDocument(&open, i) == kNoErr && open == document)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+AIErr BlokReadTag(AIArtHandle art, BlokTagData& data)
+{
+	const char* type = NULL;
+
+	if (sAITag->GetTagType(art, kBlokTagName, &type) != kNoErr || !type)
+	{
+		// Not tagged yet
+		data.Parse(NULL);
+		return kNoErr;
+	}
+
+	char* value = NULL;
+	AIErr error = sAITag->GetTag(art, kBlokTagName, "string", &value);
+
+	if (!error)
+	{
+		data.Parse(value);
+	}
+
+	return error;
+}
+
+AIErr BlokWriteTag(AIArtHandle art, const BlokTagData& data)
+{
+	std::string value = data.Serialize();
+	return sAITag->SetTag(art, kBlokTagName, "string", value.c_str());
+}
+
+bool BlokIsContainer(AIArtHandle art)
+{
+	short type = kUnknownArt;
+
+	if (!art || sAIArt->GetArtType(art, &type) != kNoErr || type != kGroupArt)
+	{
+		return false;
+	}
+
+	BlokTagData data;
+	std::string tagType;
+
+	return BlokReadTag(art, data) == kNoErr &&
+		data.GetString("type", tagType) &&
+		tagType == "BlokContainer";
+}
+
+AIArtHandle BlokGetRootContainer(AIArtHandle art)
+{
+	AIArtHandle current = NULL;
+	AIArtHandle parent = NULL;
+
+	if (BlokIsContainer(art))
+	{
+		current = art;
+	}
+	else if (sAIArt->GetArtParent(art, &parent) == kNoErr && BlokIsContainer(parent))
+	{
+		current = parent;
+	}
+
+	while (current)
+	{
+		if (sAIArt->GetArtParent(current, &parent) != kNoErr || !BlokIsContainer(parent))
+		{
+			break;
+		}
+
+		current = parent;
+	}
+
+	return current;
+}
+
+bool BlokIsAreaText(AIArtHandle art)
+{
+	short type = kUnknownArt;
+
+	if (sAIArt->GetArtType(art, &type) != kNoErr || type != kTextFrameArt)
+	{
+		return false;
+	}
+
+	AITextFrameType frameType = kUnknownTextType;
+
+	return sAITextFrame->GetType(art, &frameType) == kNoErr && frameType == kInPathTextType;
+}
+
+bool BlokIsText(AIArtHandle art)
+{
+	short type = kUnknownArt;
+
+	return sAIArt->GetArtType(art, &type) == kNoErr && type == kTextFrameArt;
+}
+
+void BlokTransformPathSegments(std::vector<AIPathSegment>& segments, const AIRealMatrix& matrix)
+{
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		sAIRealMath->AIRealMatrixXformPoint(&matrix, &segments[i].p, &segments[i].p);
+		sAIRealMath->AIRealMatrixXformPoint(&matrix, &segments[i].in, &segments[i].in);
+		sAIRealMath->AIRealMatrixXformPoint(&matrix, &segments[i].out, &segments[i].out);
+	}
+}
+
+AIErr BlokGetRootContainers(std::vector<AIArtHandle>& roots)
+{
+	AIMatchingArtSpec spec(kGroupArt, 0, 0);
+	AIArtHandle** matches = NULL;
+	ai::int32 numMatches = 0;
+
+	roots.clear();
+
+	AIErr error = sAIMatchingArt->GetMatchingArt(&spec, 1, &matches, &numMatches);
+
+	if (!error)
+	{
+		for (ai::int32 i = 0; i < numMatches; i++)
+		{
+			AIArtHandle group = (*matches)[i];
+			AIArtHandle parent = NULL;
+
+			if (BlokIsContainer(group) &&
+				(sAIArt->GetArtParent(group, &parent) != kNoErr || !BlokIsContainer(parent)))
+			{
+				roots.push_back(group);
+			}
+		}
+
+		if (matches)
+		{
+			sAIMdMemory->MdMemoryDisposeHandle((AIMdMemoryHandle)matches);
+		}
+	}
+
+	return error;
+}
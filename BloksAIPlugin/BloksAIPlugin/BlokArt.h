@@ -0,0 +1,96 @@
+#ifndef __BlokArt_h__
+#define __BlokArt_h__
+
+#include "IllustratorSDK.h"
+#include "BlokTag.h"
+
+#include <string>
+#include <vector>
+
+/** A rectangle in screen coordinates (y grows downward), like rect.ts */
+struct BlokRect
+{
+	AIReal left;
+	AIReal top;
+	AIReal width;
+	AIReal height;
+};
+
+/**	Port of Utils.nearlyEqual, compares two numbers with a relative epsilon of 0.0001.
+*/
+bool BlokNearlyEqual(AIReal a, AIReal b);
+
+/**	Port of Utils.isKeyInString. Detects whether key is space delimited in name,
+	so ".spacer" matches ".spacer thing" but not ".spacerthing".
+*/
+bool BlokIsKeyInString(const std::string& name, const char* key);
+
+/**	The art's name as scripting sees it, empty if the art has a default name.
+*/
+AIErr BlokGetArtName(AIArtHandle art, std::string& name);
+
+/**	The art's geometric bounds (no stroke) in screen coordinates, matching
+	Blok.getPageItemBounds().
+*/
+AIErr BlokGetArtRect(AIArtHandle art, BlokRect& rect);
+
+/**	What the user can see right now, in the same coordinates as BlokGetArtRect():
+	the current document view and the active artboard.
+@param rects OUT the rects, cleared first. Ones that can't be read are left out.
+*/
+void BlokGetVisibleRects(std::vector<BlokRect>& rects);
+
+/**	Where a rect in the same coordinates as BlokGetArtRect() shows up in a
+	document view, for annotators.
+@param view IN the view, NULL for the current one.
+*/
+AIErr BlokGetViewRect(AIDocumentViewHandle view, const BlokRect& rect, AIRect& viewRect);
+
+/**	True if two rects overlap, touching edges included.
+*/
+bool BlokRectsIntersect(const BlokRect& rect1, const BlokRect& rect2);
+
+/**	True if the document is still open, for state kept per document.
+*/
+bool BlokIsDocumentOpen(AIDocumentHandle document);
+
+/**	Read the saved properties that blok-adapter.ts stores on the art. Art without
+	a tag yields empty data.
+*/
+AIErr BlokReadTag(AIArtHandle art, BlokTagData& data);
+
+/**	Write saved properties back to the art.
+*/
+AIErr BlokWriteTag(AIArtHandle art, const BlokTagData& data);
+
+/**	True if the art is tagged as a BlokContainer.
+*/
+bool BlokIsContainer(AIArtHandle art);
+
+/**	Walk up from any art to the outermost BlokContainer above it.
+@return the root container, art itself if it's an un-nested container, or NULL if
+	art isn't part of a Blok tree.
+*/
+AIArtHandle BlokGetRootContainer(AIArtHandle art);
+
+/**	Every root BlokContainer in the current document.
+@param roots OUT the roots, cleared first.
+@return kNoErr on success, other AIErr otherwise.
+*/
+AIErr BlokGetRootContainers(std::vector<AIArtHandle>& roots);
+
+/**	True for text frames of type AREATEXT, which can't be resized with a plain transform.
+*/
+bool BlokIsAreaText(AIArtHandle art);
+
+/**	True for any text frame.
+*/
+bool BlokIsText(AIArtHandle art);
+
+/**	Map every point of a path, anchors and handles, through matrix.
+@param segments IN/OUT segments from AIPathSuite::GetPathSegments().
+@param matrix IN transform to apply.
+*/
+void BlokTransformPathSegments(std::vector<AIPathSegment>& segments, const AIRealMatrix& matrix);
+
+#endif
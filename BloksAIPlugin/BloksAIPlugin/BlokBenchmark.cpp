@@ -0,0 +1,716 @@
+#include "BlokBenchmark.h"
+#include "BlokLayoutKernels.h"
+#include "BlokThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <vector>
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static const double kUndefined = std::numeric_limits<double>::quiet_NaN();
+
+/** Number of times every configuration is timed, the median is reported */
+static const size_t kBenchmarkRuns = 5;
+
+/** A small, repeatable random number generator so every run sees the same trees */
+class BenchmarkRandom
+{
+public:
+	explicit BenchmarkRandom(unsigned int seed) : fState(seed * 2654435761u + 1u) {}
+
+	unsigned int Next()
+	{
+		fState = fState * 1664525u + 1013904223u;
+		return fState >> 8;
+	}
+
+	double Range(double low, double high)
+	{
+		return low + (high - low) * (double)(Next() % 10000) / 10000.0;
+	}
+
+private:
+	unsigned int fState;
+};
+
+static void BuildChildren(BlokLayoutTree& tree, size_t node, size_t level, size_t depth, size_t fanout,
+	BenchmarkRandom& random, double width, double height)
+{
+	int flexDirection = (int)(random.Next() % 2);
+	int alignItems = (int)(random.Next() % 4);
+	bool isRow = flexDirection == kBlokFlexDirectionRow;
+
+	tree.flexDirection[node] = flexDirection;
+	tree.justifyContent[node] = random.Next() % 4 == 0 ? kBlokJustifySpaceBetween : kBlokJustifyFlexStart;
+	tree.alignItems[node] = alignItems;
+	tree.styleWidth[node] = kUndefined;
+	tree.styleHeight[node] = kUndefined;
+
+	if (random.Next() % 3 == 0)
+	{
+		tree.paddingTop[node] = tree.paddingBottom[node] = 4.0;
+		tree.paddingLeft[node] = tree.paddingRight[node] = 8.0;
+	}
+
+	if (tree.justifyContent[node] == kBlokJustifySpaceBetween)
+	{
+		if (isRow)
+		{
+			tree.styleWidth[node] = width;
+		}
+		else
+		{
+			tree.styleHeight[node] = height;
+		}
+	}
+
+	size_t first = tree.Append(fanout);
+	tree.SetChildren(node, first, fanout);
+
+	for (size_t i = 0; i < fanout; i++)
+	{
+		size_t child = first + i;
+		bool isContainer = level + 1 < depth;
+		double childWidth = isContainer ? random.Range(40.0, 60.0) * fanout : random.Range(5.0, 120.0);
+		double childHeight = isContainer ? random.Range(40.0, 60.0) * fanout : random.Range(5.0, 120.0);
+
+		tree.flex[child] = random.Next() % 5 == 0 ? (double)(1 + random.Next() % 3) : 0.0;
+		tree.alignSelf[child] = random.Next() % 6 == 0 ? (int)(random.Next() % 4) : kBlokAlignUnset;
+
+		if (isContainer)
+		{
+			BuildChildren(tree, child, level + 1, depth, fanout, random, childWidth, childHeight);
+		}
+		else
+		{
+			tree.styleWidth[child] = childWidth;
+			tree.styleHeight[child] = childHeight;
+		}
+
+		// Same rules as BlokSnapshot::CaptureChildren()
+		int alignSelf = tree.alignSelf[child];
+
+		if (alignSelf == kBlokAlignStretch || (alignItems == kBlokAlignStretch && alignSelf == kBlokAlignUnset))
+		{
+			if (isRow)
+			{
+				tree.styleHeight[node] = height;
+				tree.styleHeight[child] = kUndefined;
+			}
+			else
+			{
+				tree.styleWidth[node] = width;
+				tree.styleWidth[child] = kUndefined;
+			}
+		}
+
+		if (tree.flex[child] > 0.0)
+		{
+			if (isRow)
+			{
+				tree.styleWidth[node] = width;
+				tree.styleWidth[child] = kUndefined;
+			}
+			else
+			{
+				tree.styleHeight[node] = height;
+				tree.styleHeight[child] = kUndefined;
+			}
+		}
+	}
+}
+
+void BlokBenchmarkBuildTree(BlokLayoutTree& tree, size_t depth, size_t fanout, unsigned int seed)
+{
+	BenchmarkRandom random(seed);
+
+	tree.Clear();
+	tree.Append(1);
+
+	if (depth > 0)
+	{
+		BuildChildren(tree, 0, 0, depth, fanout, random, 60.0 * fanout, 60.0 * fanout);
+	}
+	else
+	{
+		tree.styleWidth[0] = 100.0;
+		tree.styleHeight[0] = 100.0;
+	}
+}
+
+/** True if both trees were solved to exactly the same numbers */
+static bool IsLayoutIdentical(const BlokLayoutTree& a, const BlokLayoutTree& b)
+{
+	return a.layoutLeft == b.layoutLeft &&
+		a.layoutTop == b.layoutTop &&
+		a.layoutWidth == b.layoutWidth &&
+		a.layoutHeight == b.layoutHeight;
+}
+
+/** Reset the output arrays and cache so a run can't pass by reusing the last run's results */
+static void ClearLayout(BlokLayoutTree& tree)
+{
+	tree.ClearCache();
+
+	std::fill(tree.layoutLeft.begin(), tree.layoutLeft.end(), 0.0);
+	std::fill(tree.layoutTop.begin(), tree.layoutTop.end(), 0.0);
+	std::fill(tree.layoutWidth.begin(), tree.layoutWidth.end(), 0.0);
+	std::fill(tree.layoutHeight.begin(), tree.layoutHeight.end(), 0.0);
+}
+
+/** Run solve kBenchmarkRuns times and return the median in milliseconds */
+static double TimeMedian(const std::function<void()>& solve)
+{
+	std::vector<double> times;
+
+	for (size_t i = 0; i < kBenchmarkRuns; i++)
+	{
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		solve();
+		times.push_back(std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	return times[times.size() / 2];
+}
+
+/**	Time solving a set of trees serially, then with 1, 2, 4... threads up to
+	the number of cores, and write a scenario to json.
+*/
+static void RunScenario(std::ostringstream& json, const char* name, std::vector<BlokLayoutTree>& trees, size_t cores)
+{
+	size_t nodes = 0;
+
+	for (size_t i = 0; i < trees.size(); i++)
+	{
+		nodes += trees[i].Size();
+	}
+
+	// Serial reference. Every run clears the cache so it times a cold solve
+	double serialMs = TimeMedian([&trees]
+	{
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			trees[i].ClearCache();
+			BlokLayoutSolve(trees[i]);
+		}
+	});
+
+	std::vector<BlokLayoutTree> expected = trees;
+
+	json << "{\"name\":\"" << name << "\""
+		<< ",\"trees\":" << trees.size()
+		<< ",\"nodes\":" << nodes
+		<< ",\"serialMs\":" << serialMs
+		<< ",\"runs\":[";
+
+	std::vector<size_t> threadCounts;
+
+	for (size_t threads = 1; threads < cores; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+
+	threadCounts.push_back(cores);
+
+	for (size_t t = 0; t < threadCounts.size(); t++)
+	{
+		size_t threads = threadCounts[t];
+
+		BlokThreadPool pool;
+
+		if (threads > 1)
+		{
+			// The calling thread is one of them
+			pool.Start(threads - 1);
+		}
+
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			ClearLayout(trees[i]);
+		}
+
+		BlokThreadPool* shared = &pool;
+
+		double ms = TimeMedian([&trees, shared]
+		{
+			shared->ParallelFor(trees.size(), [&trees, shared](size_t i)
+			{
+				trees[i].ClearCache();
+				BlokLayoutSolve(trees[i], shared);
+			});
+		});
+
+		bool isIdentical = true;
+
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			isIdentical = isIdentical && IsLayoutIdentical(trees[i], expected[i]);
+		}
+
+		pool.Stop();
+
+		json << (t > 0 ? "," : "")
+			<< "{\"threads\":" << threads
+			<< ",\"ms\":" << ms
+			<< ",\"speedup\":" << (ms > 0.0 ? serialMs / ms : 0.0)
+			<< ",\"identical\":" << (isIdentical ? "true" : "false")
+			<< "}";
+	}
+
+	json << "]}";
+}
+
+void BlokBenchmarkBuildWideTree(BlokLayoutTree& tree, size_t childCount, unsigned int seed)
+{
+	BenchmarkRandom random(seed);
+
+	tree.Clear();
+	tree.Append(1);
+
+	tree.flexDirection[0] = kBlokFlexDirectionRow;
+	tree.justifyContent[0] = kBlokJustifySpaceBetween;
+	tree.alignItems[0] = kBlokAlignFlexStart;
+	tree.styleWidth[0] = 80.0 * childCount;
+	tree.styleHeight[0] = kUndefined;
+	tree.paddingTop[0] = tree.paddingBottom[0] = 4.0;
+	tree.paddingLeft[0] = tree.paddingRight[0] = 8.0;
+
+	size_t first = tree.Append(childCount);
+	tree.SetChildren(0, first, childCount);
+
+	for (size_t i = 0; i < childCount; i++)
+	{
+		size_t child = first + i;
+
+		tree.flex[child] = random.Next() % 4 == 0 ? (double)(1 + random.Next() % 3) : 0.0;
+		tree.alignSelf[child] = kBlokAlignUnset;
+		tree.styleWidth[child] = tree.flex[child] > 0.0 ? kUndefined : random.Range(5.0, 120.0);
+		tree.styleHeight[child] = random.Range(5.0, 120.0);
+	}
+}
+
+void BlokBenchmarkBuildListTree(BlokLayoutTree& tree, size_t rowCount, bool isRepeated, unsigned int seed)
+{
+	tree.Clear();
+	tree.Append(1);
+
+	tree.flexDirection[0] = kBlokFlexDirectionColumn;
+	tree.alignItems[0] = kBlokAlignFlexStart;
+	tree.paddingTop[0] = tree.paddingBottom[0] = 8.0;
+	tree.paddingLeft[0] = tree.paddingRight[0] = 8.0;
+	tree.gap[0] = 8.0;
+
+	size_t firstRow = tree.Append(rowCount);
+	tree.SetChildren(0, firstRow, rowCount);
+
+	// Every row: an icon, a column with a title and a subtitle, and a badge
+	for (size_t i = 0; i < rowCount; i++)
+	{
+		size_t row = firstRow + i;
+		BenchmarkRandom rowRandom(isRepeated ? seed : seed + (unsigned int)i);
+
+		tree.flexDirection[row] = kBlokFlexDirectionRow;
+		tree.justifyContent[row] = kBlokJustifySpaceBetween;
+		tree.alignItems[row] = kBlokAlignCenter;
+		tree.styleWidth[row] = 400.0;
+		tree.paddingTop[row] = tree.paddingBottom[row] = 4.0;
+
+		size_t first = tree.Append(3);
+		tree.SetChildren(row, first, 3);
+
+		tree.styleWidth[first] = tree.styleHeight[first] = 32.0;
+		tree.styleWidth[first + 2] = rowRandom.Range(16.0, 40.0);
+		tree.styleHeight[first + 2] = 16.0;
+
+		size_t text = first + 1;
+		tree.flexDirection[text] = kBlokFlexDirectionColumn;
+		tree.gap[text] = 2.0;
+
+		size_t firstLine = tree.Append(2);
+		tree.SetChildren(text, firstLine, 2);
+
+		tree.styleWidth[firstLine] = rowRandom.Range(120.0, 240.0);
+		tree.styleHeight[firstLine] = 18.0;
+		tree.styleWidth[firstLine + 1] = rowRandom.Range(80.0, 200.0);
+		tree.styleHeight[firstLine + 1] = 14.0;
+	}
+}
+
+/** The largest difference between two solved trees, 0 if they match exactly */
+static double GetLayoutError(const BlokLayoutTree& a, const BlokLayoutTree& b)
+{
+	double error = 0.0;
+
+	for (size_t i = 0; i < a.Size(); i++)
+	{
+		error = std::max(error, std::fabs(a.layoutLeft[i] - b.layoutLeft[i]));
+		error = std::max(error, std::fabs(a.layoutTop[i] - b.layoutTop[i]));
+		error = std::max(error, std::fabs(a.layoutWidth[i] - b.layoutWidth[i]));
+		error = std::max(error, std::fabs(a.layoutHeight[i] - b.layoutHeight[i]));
+	}
+
+	return error;
+}
+
+/**	Time solving a set of trees serially with every kernel level this CPU
+	supports, and write a scenario to json. The vector kernels add in a
+	different order, so report how far they drift from scalar instead of
+	requiring an exact match.
+*/
+static void RunKernelScenario(std::ostringstream& json, const char* name, std::vector<BlokLayoutTree>& trees)
+{
+	static const char* kLevelNames[] = { "scalar", "sse2", "avx2" };
+
+	BlokKernelLevel maxLevel = BlokGetMaxKernelLevel();
+	BlokKernelLevel activeLevel = BlokGetLayoutKernels().level;
+	size_t nodes = 0;
+
+	for (size_t i = 0; i < trees.size(); i++)
+	{
+		nodes += trees[i].Size();
+	}
+
+	json << "{\"name\":\"" << name << "\""
+		<< ",\"trees\":" << trees.size()
+		<< ",\"nodes\":" << nodes
+		<< ",\"kernels\":[";
+
+	std::vector<BlokLayoutTree> expected;
+	double scalarMs = 0.0;
+
+	for (int level = kBlokKernelScalar; level <= maxLevel; level++)
+	{
+		BlokSetKernelLevel((BlokKernelLevel)level);
+
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			ClearLayout(trees[i]);
+		}
+
+		double ms = TimeMedian([&trees]
+		{
+			for (size_t i = 0; i < trees.size(); i++)
+			{
+				trees[i].ClearCache();
+				BlokLayoutSolve(trees[i]);
+			}
+		});
+
+		double error = 0.0;
+
+		if (level == kBlokKernelScalar)
+		{
+			expected = trees;
+			scalarMs = ms;
+		}
+		else
+		{
+			for (size_t i = 0; i < trees.size(); i++)
+			{
+				error = std::max(error, GetLayoutError(trees[i], expected[i]));
+			}
+		}
+
+		json << (level > kBlokKernelScalar ? "," : "")
+			<< "{\"level\":\"" << kLevelNames[level] << "\""
+			<< ",\"ms\":" << ms
+			<< ",\"speedup\":" << (ms > 0.0 ? scalarMs / ms : 0.0)
+			<< ",\"maxError\":" << error
+			<< "}";
+	}
+
+	BlokSetKernelLevel(activeLevel);
+
+	json << "]}";
+}
+
+/**	Time solving a set of trees serially, once with the solver specialized per
+	axis and once with the runtime-branching one, and write a scenario to json.
+*/
+static void RunDispatchScenario(std::ostringstream& json, const char* name, std::vector<BlokLayoutTree>& trees)
+{
+	size_t nodes = 0;
+
+	for (size_t i = 0; i < trees.size(); i++)
+	{
+		nodes += trees[i].Size();
+	}
+
+	double runtimeMs = TimeMedian([&trees]
+	{
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			trees[i].ClearCache();
+			BlokLayoutSolveRuntime(trees[i]);
+		}
+	});
+
+	std::vector<BlokLayoutTree> expected = trees;
+
+	for (size_t i = 0; i < trees.size(); i++)
+	{
+		ClearLayout(trees[i]);
+	}
+
+	double specializedMs = TimeMedian([&trees]
+	{
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			trees[i].ClearCache();
+			BlokLayoutSolve(trees[i]);
+		}
+	});
+
+	bool isIdentical = true;
+
+	for (size_t i = 0; i < trees.size(); i++)
+	{
+		isIdentical = isIdentical && IsLayoutIdentical(trees[i], expected[i]);
+	}
+
+	json << "{\"name\":\"" << name << "\""
+		<< ",\"trees\":" << trees.size()
+		<< ",\"nodes\":" << nodes
+		<< ",\"runtimeMs\":" << runtimeMs
+		<< ",\"specializedMs\":" << specializedMs
+		<< ",\"speedup\":" << (specializedMs > 0.0 ? runtimeMs / specializedMs : 0.0)
+		<< ",\"identical\":" << (isIdentical ? "true" : "false")
+		<< "}";
+}
+
+/** Time a single solve of tree in milliseconds */
+static double TimeSolve(BlokLayoutTree& tree)
+{
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	BlokLayoutSolve(tree);
+
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+/**	Solve a tree cold, again while clean, and again after dirtying a single
+	leaf, writing the time and cache counters of each solve to json.
+*/
+static void RunCacheScenario(std::ostringstream& json, const char* name, BlokLayoutTree& tree)
+{
+	static const char* kPassNames[] = { "cold", "clean", "leafDirty" };
+
+	json << "{\"name\":\"" << name << "\""
+		<< ",\"trees\":1"
+		<< ",\"nodes\":" << tree.Size()
+		<< ",\"passes\":[";
+
+	ClearLayout(tree);
+
+	BlokLayoutTree expected;
+
+	for (size_t pass = 0; pass < 3; pass++)
+	{
+		if (pass == 2)
+		{
+			tree.MarkDirty(tree.Size() - 1);
+		}
+
+		double ms = TimeSolve(tree);
+
+		if (pass == 0)
+		{
+			expected = tree;
+		}
+
+		json << (pass > 0 ? "," : "")
+			<< "{\"pass\":\"" << kPassNames[pass] << "\""
+			<< ",\"ms\":" << ms
+			<< ",\"hits\":" << tree.cacheHits
+			<< ",\"misses\":" << tree.cacheMisses
+			<< ",\"identical\":" << (IsLayoutIdentical(tree, expected) ? "true" : "false")
+			<< "}";
+	}
+
+	json << "]}";
+}
+
+/**	Time solving a list whose rows are all the same against one whose rows
+	all differ slightly, and write a scenario to json with how much of each
+	was copied instead of solved.
+*/
+static void RunDedupScenario(std::ostringstream& json, const char* name, size_t rowCount)
+{
+	static const char* kListNames[] = { "uniqueRows", "repeatedRows" };
+
+	json << "{\"name\":\"" << name << "\""
+		<< ",\"rows\":" << rowCount
+		<< ",\"lists\":[";
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		BlokLayoutTree tree;
+		BlokBenchmarkBuildListTree(tree, rowCount, i == 1, 11);
+
+		double ms = TimeMedian([&tree]
+		{
+			tree.ClearCache();
+			BlokLayoutSolve(tree);
+		});
+
+		json << (i > 0 ? "," : "")
+			<< "{\"name\":\"" << kListNames[i] << "\""
+			<< ",\"nodes\":" << tree.Size()
+			<< ",\"ms\":" << ms
+			<< ",\"dedupHits\":" << tree.dedupHits
+			<< ",\"dedupRatio\":" << (double)tree.dedupNodes / (double)tree.Size()
+			<< "}";
+	}
+
+	json << "]}";
+}
+
+/**	Resize the root of a tree a little at a time, like the Bloks Resize
+	tool does on every drag event, and write a scenario to json with how long
+	each frame's solve took against budgetMs.
+*/
+static void RunDragScenario(std::ostringstream& json, const char* name, BlokLayoutTree& tree, size_t frames, double budgetMs)
+{
+	// Only a fixed size follows the drag, so make sure the root has one
+	double width = std::isnan(tree.styleWidth[0]) ? 600.0 : tree.styleWidth[0];
+	double height = std::isnan(tree.styleHeight[0]) ? 600.0 : tree.styleHeight[0];
+
+	ClearLayout(tree);
+	tree.styleWidth[0] = width;
+	tree.styleHeight[0] = height;
+
+	// Capturing solves the tree once before the drag starts
+	double coldMs = TimeSolve(tree);
+
+	std::vector<double> times;
+	size_t overBudget = 0;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < frames; i++)
+	{
+		tree.styleWidth[0] = width + 2.0 * (double)(i + 1);
+		tree.styleHeight[0] = height + 1.0 * (double)(i + 1);
+		tree.MarkDirty(0);
+
+		double ms = TimeSolve(tree);
+		times.push_back(ms);
+		misses += tree.cacheMisses;
+
+		if (ms > budgetMs)
+		{
+			overBudget++;
+		}
+	}
+
+	std::sort(times.begin(), times.end());
+
+	json << "{\"name\":\"" << name << "\""
+		<< ",\"trees\":1"
+		<< ",\"nodes\":" << tree.Size()
+		<< ",\"frames\":" << frames
+		<< ",\"budgetMs\":" << budgetMs
+		<< ",\"coldMs\":" << coldMs
+		<< ",\"medianMs\":" << times[times.size() / 2]
+		<< ",\"maxMs\":" << times.back()
+		<< ",\"overBudget\":" << overBudget
+		<< ",\"missesPerFrame\":" << (double)misses / (double)frames
+		<< "}";
+}
+
+std::string BlokRunBenchmark()
+{
+	size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::ostringstream json;
+	json.imbue(std::locale::classic());
+
+	json << "{\"cores\":" << cores << ",\"scenarios\":[";
+
+	// A relayout-all over a typical document: lots of small, unrelated roots
+	{
+		std::vector<BlokLayoutTree> trees(200);
+
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			BlokBenchmarkBuildTree(trees[i], 3, 6, (unsigned int)i + 1);
+		}
+
+		RunScenario(json, "manyRoots", trees, cores);
+	}
+
+	json << ",";
+
+	// A full page template: one root with many nested containers
+	{
+		std::vector<BlokLayoutTree> trees(1);
+		BlokBenchmarkBuildTree(trees[0], 5, 8, 7);
+
+		RunScenario(json, "largeTree", trees, cores);
+	}
+
+	json << ",";
+
+	// Generated lists and icon grids: a few containers with thousands of children
+	{
+		std::vector<BlokLayoutTree> trees(4);
+
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			BlokBenchmarkBuildWideTree(trees[i], 4096, (unsigned int)i + 1);
+		}
+
+		RunKernelScenario(json, "wideList", trees);
+	}
+
+	json << ",";
+
+	// Rows and columns mixed at random, with some flex and stretch, to compare
+	// the solver specialized per axis with the one that branches at every node
+	{
+		std::vector<BlokLayoutTree> trees(200);
+
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			BlokBenchmarkBuildTree(trees[i], 3, 6, (unsigned int)i + 1000);
+		}
+
+		RunDispatchScenario(json, "mixedDirections", trees);
+	}
+
+	json << ",";
+
+	// Re-solving the page template, both untouched and after a single edit
+	{
+		BlokLayoutTree tree;
+		BlokBenchmarkBuildTree(tree, 5, 8, 7);
+
+		RunCacheScenario(json, "measureCache", tree);
+	}
+
+	json << ",";
+
+	// A generated list, like sample-files/variable-list.ai
+	RunDedupScenario(json, "structuralDedup", 500);
+
+	json << ",";
+
+	// Dragging the Bloks Resize tool across a 1,111 node tree, each frame has
+	// to fit in a 60Hz frame
+	{
+		BlokLayoutTree tree;
+		BlokBenchmarkBuildTree(tree, 3, 10, 5);
+
+		RunDragScenario(json, "resizeDrag", tree, 120, 16.0);
+	}
+
+	json << "]}";
+
+	return json.str();
+}
@@ -0,0 +1,50 @@
+#ifndef __BlokBenchmark_h__
+#define __BlokBenchmark_h__
+
+#include "BlokLayout.h"
+
+#include <cstddef>
+#include <string>
+
+// Note: like BlokLayout.h, nothing in here may call into Illustrator. The
+// benchmark works on generated trees so it can run without a document.
+
+/**	Generate a random tree shaped like a real Bloks document, following the
+	same style rules BlokSnapshot::Capture() applies (space-between, stretch and
+	flex all fix the container's dims).
+@param tree OUT tree to fill, cleared first.
+@param depth IN number of container levels below the root.
+@param fanout IN children per container.
+@param seed IN the same seed always generates the same tree.
+*/
+void BlokBenchmarkBuildTree(BlokLayoutTree& tree, size_t depth, size_t fanout, unsigned int seed);
+
+/**	Generate a single space-between row with a fixed width and childCount
+	leaves, about a quarter of them flexible, like a generated list or icon grid.
+@param tree OUT tree to fill, cleared first.
+@param childCount IN number of children of the root.
+@param seed IN the same seed always generates the same tree.
+*/
+void BlokBenchmarkBuildWideTree(BlokLayoutTree& tree, size_t childCount, unsigned int seed);
+
+/**	Generate a column of rows, each an icon, two lines of text and a badge.
+@param tree OUT tree to fill, cleared first.
+@param rowCount IN number of rows.
+@param isRepeated IN true for every row to be the same, false for every row to differ.
+@param seed IN the same seed always generates the same tree.
+*/
+void BlokBenchmarkBuildListTree(BlokLayoutTree& tree, size_t rowCount, bool isRepeated, unsigned int seed);
+
+/**	Time the native solver on generated trees, serially and with every thread
+	count up to the number of cores, and check that every run matches the
+	serial result. Wide containers are also timed with every SIMD kernel level,
+	and mixed trees with both the axis-specialized and runtime-branching solver.
+	Finally a large tree is re-solved to show what the measure cache saves,
+	lists of repeated and unique rows show what structural dedup saves, and
+	a 1,111 node tree is resized frame by frame like a resize drag, against a
+	16ms budget per frame.
+@return a JSON report.
+*/
+std::string BlokRunBenchmark();
+
+#endif
@@ -0,0 +1,365 @@
+#include "IllustratorSDK.h"
+#include "BlokDebugOverlay.h"
+#include "BloksAIPluginSuites.h"
+
+#include <algorithm>
+
+/** Colors of each kind of box, drawn in this order so dirty ones end up on top */
+static const AIRGBColor kBlokDebugBlokColor = { 0x8080, 0x8080, 0x8080 };
+static const AIRGBColor kBlokDebugContainerColor = { 0x9999, 0x3333, 0xcccc };
+static const AIRGBColor kBlokDebugPaddingColor = { 0x2222, 0xaaaa, 0x5555 };
+static const AIRGBColor kBlokDebugFlexColor = { 0xffff, 0x8888, 0x0000 };
+static const AIRGBColor kBlokDebugDirtyColor = { 0xeeee, 0x2222, 0x2222 };
+
+/** View pixels around a box that its outline can draw into */
+#define kBlokDebugOutline 2
+
+static bool RectsEqual(const BlokRect& rect1, const BlokRect& rect2)
+{
+	return BlokNearlyEqual(rect1.left, rect2.left) &&
+		BlokNearlyEqual(rect1.top, rect2.top) &&
+		BlokNearlyEqual(rect1.width, rect2.width) &&
+		BlokNearlyEqual(rect1.height, rect2.height);
+}
+
+static bool ViewRectsIntersect(const AIRect& rect1, const AIRealRect& rect2)
+{
+	return rect1.left - kBlokDebugOutline <= rect2.right &&
+		rect2.left <= rect1.right + kBlokDebugOutline &&
+		rect1.top - kBlokDebugOutline <= rect2.bottom &&
+		rect2.top <= rect1.bottom + kBlokDebugOutline;
+}
+
+bool BlokDebugBox::operator==(const BlokDebugBox& other) const
+{
+	return RectsEqual(rect, other.rect) &&
+		RectsEqual(content, other.content) &&
+		isContainer == other.isContainer &&
+		hasPadding == other.hasPadding &&
+		isFlex == other.isFlex &&
+		isDirty == other.isDirty;
+}
+
+BlokDebugOverlay::BlokDebugOverlay() :
+	fAnnotator(NULL),
+	fIsVisible(false),
+	fDocument(NULL)
+{
+}
+
+AIErr BlokDebugOverlay::Startup(SPPluginRef plugin)
+{
+	AIErr error = sAIAnnotator->AddAnnotator(plugin, kBlokDebugOverlayName, &fAnnotator);
+
+	if (!error)
+	{
+		// Off until the panel turns it on
+		error = sAIAnnotator->SetAnnotatorActive(fAnnotator, false);
+	}
+
+	return error;
+}
+
+AIErr BlokDebugOverlay::SetVisible(bool isVisible)
+{
+	AIErr error = kNoErr;
+
+	if (!fAnnotator || isVisible == fIsVisible)
+	{
+		return error;
+	}
+
+	// Erase what's there before forgetting it
+	if (!isVisible)
+	{
+		Clear();
+	}
+
+	fIsVisible = isVisible;
+	error = sAIAnnotator->SetAnnotatorActive(fAnnotator, isVisible);
+
+	return error;
+}
+
+void BlokDebugOverlay::Update(const BlokSnapshot& snapshot, const std::vector<BlokRect>& bounds)
+{
+	const BlokLayoutTree& tree = snapshot.tree;
+	size_t size = tree.Size();
+
+	if (!fIsVisible || size == 0 || bounds.size() != size || !MatchDocument())
+	{
+		return;
+	}
+
+	std::vector<BlokDebugBox> boxes(size);
+
+	// Same sweep as BlokApplier::Diff(), parents come before their children
+	for (size_t node = 0; node < size; node++)
+	{
+		BlokDebugBox& box = boxes[node];
+
+		if (node == 0)
+		{
+			box.rect.left = snapshot.rect[0].left;
+			box.rect.top = snapshot.rect[0].top;
+		}
+		else
+		{
+			const BlokRect& parentRect = boxes[tree.parent[node]].rect;
+
+			box.rect.left = parentRect.left + tree.layoutLeft[node];
+			box.rect.top = parentRect.top + tree.layoutTop[node];
+		}
+
+		box.rect.width = tree.layoutWidth[node];
+		box.rect.height = tree.layoutHeight[node];
+
+		box.content.left = box.rect.left + tree.paddingLeft[node];
+		box.content.top = box.rect.top + tree.paddingTop[node];
+		box.content.width = std::max(box.rect.width - tree.paddingLeft[node] - tree.paddingRight[node], (AIReal)0.0);
+		box.content.height = std::max(box.rect.height - tree.paddingTop[node] - tree.paddingBottom[node], (AIReal)0.0);
+
+		box.isContainer = snapshot.isContainer[node];
+		box.hasPadding = !RectsEqual(box.rect, box.content);
+		box.isFlex = node > 0 && tree.flex[node] > 0.0;
+		box.isDirty = !RectsEqual(bounds[node], snapshot.rect[node]);
+	}
+
+	std::vector<BlokDebugBox>& last = fRoots[snapshot.root];
+	std::vector<size_t> changed;
+
+	if (last.size() != size)
+	{
+		// Different tree, redraw all of it
+		changed.resize(size);
+
+		for (size_t node = 0; node < size; node++)
+		{
+			changed[node] = node;
+		}
+	}
+	else
+	{
+		for (size_t node = 0; node < size; node++)
+		{
+			if (boxes[node] != last[node])
+			{
+				changed.push_back(node);
+			}
+		}
+	}
+
+	// Where the changed boxes were and where they are now
+	Invalidate(last, changed);
+	last.swap(boxes);
+	Invalidate(last, changed);
+}
+
+void BlokDebugOverlay::Clear()
+{
+	AIDocumentHandle document = NULL;
+	std::vector<size_t> all;
+
+	// Only erase from the document the boxes are drawn in, if it's still open
+	if (sAIDocument->GetDocument(&document) != kNoErr || document != fDocument)
+	{
+		fRoots.clear();
+	}
+
+	for (auto it = fRoots.begin(); it != fRoots.end(); ++it)
+	{
+		all.resize(it->second.size());
+
+		for (size_t node = 0; node < all.size(); node++)
+		{
+			all[node] = node;
+		}
+
+		Invalidate(it->second, all);
+	}
+
+	fRoots.clear();
+	fDocument = NULL;
+}
+
+void BlokDebugOverlay::DocumentClosed()
+{
+	if (fDocument && !BlokIsDocumentOpen(fDocument))
+	{
+		// Its view is gone, nothing to invalidate
+		fRoots.clear();
+		fDocument = NULL;
+	}
+}
+
+AIErr BlokDebugOverlay::Draw(const AIAnnotatorMessage& message)
+{
+	AIErr error = kNoErr;
+
+	if (!fIsVisible || !message.drawer || fRoots.empty() || !MatchDocument())
+	{
+		return error;
+	}
+
+	AIAnnotatorDrawer* drawer = message.drawer;
+	sAIAnnotatorDrawer->SetOpacity(drawer, 0.8);
+	sAIAnnotatorDrawer->SetLineWidth(drawer, 1.0);
+
+	// Only what Illustrator is redrawing, no rects means all of the view
+	std::vector<const BlokDebugBox*> boxes;
+
+	for (auto it = fRoots.begin(); it != fRoots.end(); ++it)
+	{
+		// Undo or a script can delete a root without a relayout
+		if (!sAIArt->ValidArt(it->first, true))
+		{
+			continue;
+		}
+
+		for (size_t node = 0; node < it->second.size(); node++)
+		{
+			const BlokDebugBox& box = it->second[node];
+			AIRect rect;
+
+			if (BlokGetViewRect(message.view, box.rect, rect) != kNoErr)
+			{
+				continue;
+			}
+
+			bool isInvalid = message.numInvalidationRects == 0 || !message.invalidationRects;
+
+			for (ai::int32 i = 0; !isInvalid && i < message.numInvalidationRects; i++)
+			{
+				isInvalid = ViewRectsIntersect(rect, message.invalidationRects[i]);
+			}
+
+			if (isInvalid)
+			{
+				boxes.push_back(&box);
+			}
+		}
+	}
+
+	// Layout boxes, containers dashed
+	for (size_t i = 0; !error && i < boxes.size(); i++)
+	{
+		AIRect rect;
+
+		if (!boxes[i]->isFlex && !boxes[i]->isDirty && BlokGetViewRect(message.view, boxes[i]->rect, rect) == kNoErr)
+		{
+			sAIAnnotatorDrawer->SetColor(drawer, boxes[i]->isContainer ? kBlokDebugContainerColor : kBlokDebugBlokColor);
+			sAIAnnotatorDrawer->SetLineDashed(drawer, boxes[i]->isContainer);
+
+			error = sAIAnnotatorDrawer->DrawRect(drawer, rect, false);
+		}
+	}
+
+	// What's left inside a container's padding
+	sAIAnnotatorDrawer->SetColor(drawer, kBlokDebugPaddingColor);
+	sAIAnnotatorDrawer->SetLineDashed(drawer, true);
+
+	for (size_t i = 0; !error && i < boxes.size(); i++)
+	{
+		AIRect rect;
+
+		if (boxes[i]->hasPadding && BlokGetViewRect(message.view, boxes[i]->content, rect) == kNoErr)
+		{
+			error = sAIAnnotatorDrawer->DrawRect(drawer, rect, false);
+		}
+	}
+
+	// Bloks that got a share of the free space
+	sAIAnnotatorDrawer->SetColor(drawer, kBlokDebugFlexColor);
+	sAIAnnotatorDrawer->SetLineDashed(drawer, false);
+
+	for (size_t i = 0; !error && i < boxes.size(); i++)
+	{
+		AIRect rect;
+
+		if (boxes[i]->isFlex && !boxes[i]->isDirty && BlokGetViewRect(message.view, boxes[i]->rect, rect) == kNoErr)
+		{
+			error = sAIAnnotatorDrawer->DrawRect(drawer, rect, false);
+		}
+	}
+
+	// Bloks the last pass moved or resized, thicker and on top
+	sAIAnnotatorDrawer->SetColor(drawer, kBlokDebugDirtyColor);
+	sAIAnnotatorDrawer->SetLineWidth(drawer, 2.0);
+
+	for (size_t i = 0; !error && i < boxes.size(); i++)
+	{
+		AIRect rect;
+
+		if (boxes[i]->isDirty && BlokGetViewRect(message.view, boxes[i]->rect, rect) == kNoErr)
+		{
+			error = sAIAnnotatorDrawer->DrawRect(drawer, rect, false);
+		}
+	}
+
+	return error;
+}
+
+/**	Have Illustrator redraw the changed boxes and nowhere else. They're merged
+	into a single rect, so a pass that changes a few neighbouring Bloks
+	doesn't make thousands of calls.
+*/
+void BlokDebugOverlay::Invalidate(const std::vector<BlokDebugBox>& boxes, const std::vector<size_t>& changed)
+{
+	AIRect invalid;
+	bool isEmpty = true;
+
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		AIRect rect;
+
+		if (changed[i] >= boxes.size() || BlokGetViewRect(NULL, boxes[changed[i]].rect, rect) != kNoErr)
+		{
+			continue;
+		}
+
+		if (isEmpty)
+		{
+			invalid = rect;
+			isEmpty = false;
+		}
+		else
+		{
+			invalid.left = std::min(invalid.left, rect.left);
+			invalid.top = std::min(invalid.top, rect.top);
+			invalid.right = std::max(invalid.right, rect.right);
+			invalid.bottom = std::max(invalid.bottom, rect.bottom);
+		}
+	}
+
+	if (!isEmpty)
+	{
+		invalid.left -= kBlokDebugOutline;
+		invalid.top -= kBlokDebugOutline;
+		invalid.right += kBlokDebugOutline;
+		invalid.bottom += kBlokDebugOutline;
+
+		sAIAnnotator->InvalAnnotationRect(NULL, &invalid);
+	}
+}
+
+/**	True if the boxes belong to the current document. A different document
+	means they're stale, so they're dropped.
+*/
+bool BlokDebugOverlay::MatchDocument()
+{
+	AIDocumentHandle document = NULL;
+
+	if (sAIDocument->GetDocument(&document) != kNoErr || !document)
+	{
+		return false;
+	}
+
+	if (document != fDocument)
+	{
+		// The old document's view is gone, nothing to invalidate
+		fRoots.clear();
+		fDocument = document;
+	}
+
+	return true;
+}
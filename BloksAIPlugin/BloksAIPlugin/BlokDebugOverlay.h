@@ -0,0 +1,108 @@
+#ifndef __BlokDebugOverlay_h__
+#define __BlokDebugOverlay_h__
+
+#include "IllustratorSDK.h"
+#include "BlokArt.h"
+#include "BlokSnapshot.h"
+
+#include <unordered_map>
+#include <vector>
+
+/** Unique name of the annotator that draws the overlay */
+#define kBlokDebugOverlayName "Bloks Debug Overlay"
+
+/** One node of a laid out tree, as the overlay draws it */
+struct BlokDebugBox
+{
+	/** The layout box, what the solver gave the node */
+	BlokRect rect;
+
+	/** Inside the padding from the .bg's name, the same as rect without padding */
+	BlokRect content;
+
+	bool isContainer;
+	bool hasPadding;
+
+	/** True if the node has flex, it got a share of its container's free space */
+	bool isFlex;
+
+	/**	True if the last pass moved or resized the node's art. Boxes from
+		BlokEngine::RefreshDebugOverlay() are dirty if the next pass would.
+	*/
+	bool isDirty;
+
+	bool operator==(const BlokDebugBox& other) const;
+	bool operator!=(const BlokDebugBox& other) const { return !(*this == other); }
+};
+
+/**	An optional overlay, drawn with an annotator, that shows how the native
+	layout last laid out each root: every Blok's layout box, the padding .bg
+	directives add, which Bloks flex, and which ones the last pass changed.
+	Each is drawn in its own color.
+
+	Every root keeps the boxes of its last layout. Only the parts of the view
+	where a box changed between passes are invalidated, and drawing skips
+	boxes outside of what Illustrator asks to redraw, so leaving the overlay
+	on doesn't slow down large documents.
+
+	Only call from the main thread.
+*/
+class BlokDebugOverlay
+{
+public:
+	BlokDebugOverlay();
+
+	/**	Register our annotator, inactive until the overlay is shown.
+	@param plugin IN our plugin, the annotator's messages go to its Message().
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Startup(SPPluginRef plugin);
+
+	/**	True if an annotator message is for the overlay.
+	@param annotator IN AIAnnotatorMessage::annotator.
+	*/
+	bool IsAnnotator(AIAnnotatorHandle annotator) const { return annotator && annotator == fAnnotator; }
+
+	/**	Show or hide the overlay. Hiding it forgets every box, roots show up
+		again once they're laid out.
+	@param isVisible IN true to show it.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr SetVisible(bool isVisible);
+
+	bool IsVisible() const { return fIsVisible; }
+
+	/**	Remember how a root was just laid out, and have Illustrator redraw
+		where that's different from last time. Does nothing while hidden.
+	@param snapshot IN a solved snapshot.
+	@param bounds IN bounds of each node's art after the layout, from BlokApplier::Diff().
+	*/
+	void Update(const BlokSnapshot& snapshot, const std::vector<BlokRect>& bounds);
+
+	/** Forget every box */
+	void Clear();
+
+	/** Forget every box if they're for a document that was just closed */
+	void DocumentClosed();
+
+	/**	Draw the boxes inside what Illustrator asks to redraw.
+	@param message IN the draw message.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Draw(const AIAnnotatorMessage& message);
+
+private:
+	void Invalidate(const std::vector<BlokDebugBox>& boxes, const std::vector<size_t>& changed);
+	bool MatchDocument();
+
+	AIAnnotatorHandle fAnnotator;
+	bool fIsVisible;
+
+	// Document the boxes belong to
+	AIDocumentHandle fDocument;
+
+	// Boxes of every root, in node order
+	std::unordered_map<AIArtHandle, std::vector<BlokDebugBox>> fRoots;
+};
+
+#endif
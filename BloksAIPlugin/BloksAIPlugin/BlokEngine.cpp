@@ -0,0 +1,992 @@
+#include "IllustratorSDK.h"
+#include "BlokEngine.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <unordered_set>
+
+typedef std::chrono::steady_clock BlokClock;
+
+static double MillisecondsSince(BlokClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BlokClock::now() - start).count();
+}
+
+/** Sorts art from back to front */
+static bool IsBehind(AIArtHandle art1, AIArtHandle art2)
+{
+	short order = kUnknownOrder;
+	sAIArt->GetArtOrder(art1, art2, &order);
+
+	return order == kFirstAfterSecond;
+}
+
+/** Write art as a JSON array of UUIDs */
+static void WriteUUIDs(std::ostringstream& json, const std::vector<AIArtHandle>& art)
+{
+	bool isFirst = true;
+
+	json << "[";
+
+	for (size_t i = 0; i < art.size(); i++)
+	{
+		ai::uuid uuid;
+		ai::UnicodeString uuidString;
+
+		if (sAIUUID->GetArtUUID(art[i], uuid) == kNoErr &&
+			sAIUUID->UUIDToString(uuid, uuidString) == kNoErr)
+		{
+			json << (isFirst ? "" : ",") << "\"" << uuidString.as_UTF8() << "\"";
+			isFirst = false;
+		}
+	}
+
+	json << "]";
+}
+
+/** True if both trees were solved to exactly the same numbers */
+static bool IsLayoutIdentical(const BlokLayoutTree& a, const BlokLayoutTree& b)
+{
+	return a.layoutLeft == b.layoutLeft &&
+		a.layoutTop == b.layoutTop &&
+		a.layoutWidth == b.layoutWidth &&
+		a.layoutHeight == b.layoutHeight;
+}
+
+BlokEngineStats::BlokEngineStats() :
+	roots(0),
+	nodes(0),
+	threads(0),
+	cacheHits(0),
+	cacheMisses(0),
+	dedupHits(0),
+	dedupNodes(0),
+	textHits(0),
+	textMisses(0),
+	historyHits(0),
+	snapshotMs(0.0),
+	solveMs(0.0),
+	applyMs(0.0),
+	changed(0),
+	applyCalls(0)
+{
+}
+
+std::string BlokEngineStats::ToJSON() const
+{
+	std::ostringstream json;
+	json.imbue(std::locale::classic());
+
+	json << "{\"roots\":" << roots
+		<< ",\"nodes\":" << nodes
+		<< ",\"threads\":" << threads
+		<< ",\"cacheHits\":" << cacheHits
+		<< ",\"cacheMisses\":" << cacheMisses
+		<< ",\"dedupHits\":" << dedupHits
+		<< ",\"dedupRatio\":" << (nodes > 0 ? (double)dedupNodes / (double)nodes : 0.0)
+		<< ",\"textHits\":" << textHits
+		<< ",\"textMisses\":" << textMisses
+		<< ",\"historyHits\":" << historyHits
+		<< ",\"snapshotMs\":" << snapshotMs
+		<< ",\"solveMs\":" << solveMs
+		<< ",\"applyMs\":" << applyMs
+		<< ",\"changed\":" << changed
+		<< ",\"applyCalls\":" << applyCalls
+		<< ",\"applyCallsPerNode\":" << (nodes > 0 ? (double)applyCalls / (double)nodes : 0.0)
+		<< ",\"applyMsPerNode\":" << (nodes > 0 ? applyMs / (double)nodes : 0.0)
+		<< ",\"skipped\":";
+
+	WriteUUIDs(json, skipped);
+
+	json << ",\"mismatched\":";
+
+	WriteUUIDs(json, mismatched);
+
+	json << "}";
+
+	return json.str();
+}
+
+BlokPass::BlokPass() :
+	phase(kBlokPassIdle),
+	nextRoot(0),
+	isCapturing(false),
+	hasAppliedVisible(false),
+	nextDeferred(0),
+	undoTag(0),
+	capturedNodes(0),
+	expectedNodes(0),
+	isStale(false),
+	overrideArt(NULL),
+	overrideWidth(0.0),
+	overrideHeight(0.0),
+	restarts(0),
+	textHits(0),
+	textMisses(0),
+	textEdits(0),
+	wasModified(false),
+	hasMeasureEdits(false)
+{
+}
+
+double BlokPass::GetProgress() const
+{
+	// Solve is always a single step, capture and off-screen changes spread out
+	switch (phase)
+	{
+	case kBlokPassCapture:
+		return 0.7 * (double)capturedNodes / (double)std::max(std::max(expectedNodes, capturedNodes), (size_t)1);
+	case kBlokPassSolve:
+		return 0.7;
+	case kBlokPassApply:
+		return 0.85 + 0.15 * (double)nextDeferred / (double)std::max(deferred.size(), (size_t)1);
+	default:
+		return 1.0;
+	}
+}
+
+std::string BlokPass::ToJSON() const
+{
+	static const char* phaseNames[] = { "idle", "capture", "solve", "apply" };
+
+	std::ostringstream json;
+	json.imbue(std::locale::classic());
+
+	json << "{\"phase\":\"" << phaseNames[phase] << "\""
+		<< ",\"roots\":" << roots.size()
+		<< ",\"nodes\":" << capturedNodes
+		<< ",\"expectedNodes\":" << expectedNodes
+		<< ",\"deferred\":" << deferred.size() - nextDeferred
+		<< ",\"restarts\":" << restarts
+		<< ",\"progress\":" << GetProgress()
+		<< "}";
+
+	return json.str();
+}
+
+BlokResize::BlokResize() :
+	container(NULL),
+	node(0),
+	isWidthFixed(false),
+	isHeightFixed(false),
+	solveMs(0.0),
+	textEdits(0),
+	wasModified(false)
+{
+}
+
+BlokEngine::BlokEngine() :
+	fOverlay(NULL)
+{
+}
+
+AIErr BlokEngine::RelayoutRoots(const std::vector<AIArtHandle>& art, BlokEngineStats& stats)
+{
+	BlokPass pass;
+	bool isDone = false;
+
+	BeginPass(pass, art);
+
+	// All of it happens in the caller's undo context. Tag that step now, so whatever
+	// the caller changed itself, like panel settings, is a layout step to merge with
+	// even if nothing moves
+	if (!pass.roots.empty())
+	{
+		pass.undoTag = fUndo.BeginStep(pass.roots);
+	}
+
+	AIErr error = ContinuePass(pass, std::numeric_limits<double>::infinity(), isDone);
+
+	if (!error)
+	{
+		stats = pass.stats;
+	}
+
+	return error;
+}
+
+AIErr BlokEngine::ResizeContainer(AIArtHandle container, AIReal width, AIReal height, BlokEngineStats& stats)
+{
+	BlokPass pass;
+	bool isDone = false;
+
+	BeginPass(pass, std::vector<AIArtHandle>(1, container));
+	pass.overrideArt = container;
+	pass.overrideWidth = width;
+	pass.overrideHeight = height;
+
+	AIErr error = ContinuePass(pass, std::numeric_limits<double>::infinity(), isDone);
+
+	if (!error && !pass.stats.skipped.empty())
+	{
+		// Same thing BlokContainer.checkForRelayout() saves, its invalidate() picks it up
+		BlokTagData tag;
+		error = BlokReadTag(container, tag);
+
+		if (!error)
+		{
+			tag.SetNumber("overrideWidth", width);
+			tag.SetNumber("overrideHeight", height);
+
+			error = BlokWriteTag(container, tag);
+		}
+	}
+
+	if (!error)
+	{
+		stats = pass.stats;
+	}
+
+	return error;
+}
+
+AIErr BlokEngine::BeginResize(AIArtHandle container, BlokResize& resize)
+{
+	resize = BlokResize();
+
+	AIArtHandle root = BlokGetRootContainer(container);
+	BlokClock::time_point start = BlokClock::now();
+
+	if (!root)
+	{
+		return kBadParameterErr;
+	}
+
+	// Every drag frame measures in the tool's one undo context, see DiscardResize()
+	resize.textEdits = fTextMeasurer.GetEditCount();
+	sAIDocument->GetDocumentModified(&resize.wasModified);
+
+	AIErr error = resize.snapshot.Capture(root, &fTextMeasurer);
+
+	if (!error)
+	{
+		std::vector<AIArtHandle>::const_iterator found = std::find(resize.snapshot.art.begin(), resize.snapshot.art.end(), container);
+
+		if (found == resize.snapshot.art.end())
+		{
+			error = kBadParameterErr;
+		}
+		else
+		{
+			resize.container = container;
+			resize.node = found - resize.snapshot.art.begin();
+			resize.isWidthFixed = !std::isnan(resize.snapshot.tree.styleWidth[resize.node]);
+			resize.isHeightFixed = !std::isnan(resize.snapshot.tree.styleHeight[resize.node]);
+		}
+	}
+
+	resize.solveMs = MillisecondsSince(start);
+
+	return error;
+}
+
+void BlokEngine::UpdateResize(BlokResize& resize, AIReal width, AIReal height)
+{
+	if (!resize.IsActive())
+	{
+		return;
+	}
+
+	BlokClock::time_point start = BlokClock::now();
+	BlokSnapshot& snapshot = resize.snapshot;
+	BlokLayoutTree& tree = snapshot.tree;
+
+	if (resize.isWidthFixed)
+	{
+		tree.styleWidth[resize.node] = width;
+	}
+
+	if (resize.isHeightFixed)
+	{
+		tree.styleHeight[resize.node] = height;
+	}
+
+	tree.MarkDirty(resize.node);
+
+	// Measuring autoHeight text only works on this thread
+	snapshot.AttachMeasure();
+
+	if (snapshot.measuredCount > 0)
+	{
+		BlokLayoutSolve(tree);
+	}
+	else
+	{
+		fPool.Start();
+		BlokLayoutSolve(tree, &fPool);
+	}
+
+	BlokApplier::Diff(snapshot, resize.changes, resize.bounds);
+
+	resize.solveMs += MillisecondsSince(start);
+}
+
+AIErr BlokEngine::CommitResize(BlokResize& resize, AIReal width, AIReal height, BlokEngineStats& stats)
+{
+	if (!resize.IsActive())
+	{
+		return resize.container ? ResizeContainer(resize.container, width, height, stats) : kNoErr;
+	}
+
+	UpdateResize(resize, width, height);
+
+	BlokClock::time_point start = BlokClock::now();
+	BlokApplier applier;
+
+	AIErr error = applier.ApplyChanges(resize.changes);
+
+	if (!error)
+	{
+		error = applier.SaveTags(resize.snapshot, resize.bounds);
+	}
+
+	if (!error && fOverlay)
+	{
+		fOverlay->Update(resize.snapshot, resize.bounds);
+	}
+
+	if (!error && !applier.HasWritten())
+	{
+		DiscardResize(resize);
+	}
+
+	if (!error)
+	{
+		stats = BlokEngineStats();
+		stats.roots = 1;
+		stats.nodes = resize.snapshot.tree.Size();
+		stats.threads = resize.snapshot.measuredCount > 0 ? 1 : fPool.GetConcurrency();
+		stats.cacheHits = resize.snapshot.tree.cacheHits;
+		stats.cacheMisses = resize.snapshot.tree.cacheMisses;
+		stats.solveMs = resize.solveMs;
+		stats.applyMs = MillisecondsSince(start);
+		stats.changed = applier.GetChangeCount();
+		stats.applyCalls = applier.GetCallCount();
+	}
+
+	return error;
+}
+
+void BlokEngine::DiscardResize(const BlokResize& resize)
+{
+	if (resize.container && fTextMeasurer.GetEditCount() > resize.textEdits)
+	{
+		ForgetMeasureEdits(resize.wasModified);
+	}
+}
+
+void BlokEngine::BeginPass(BlokPass& pass, const std::vector<AIArtHandle>& art)
+{
+	pass = BlokPass();
+
+	// Don't lay out the same root twice, that's wasted work
+	for (size_t i = 0; i < art.size(); i++)
+	{
+		AIArtHandle root = BlokGetRootContainer(art[i]);
+
+		if (root && pass.rootSet.insert(root).second)
+		{
+			pass.roots.push_back(root);
+		}
+	}
+
+	RestartPass(pass);
+	pass.restarts = 0;
+}
+
+AIErr BlokEngine::ContinuePass(BlokPass& pass, double budgetMs, bool& isDone)
+{
+	AIErr error = kNoErr;
+	BlokClock::time_point start = BlokClock::now();
+	isDone = false;
+
+	if (pass.isStale)
+	{
+		RestartPass(pass);
+	}
+
+	if (pass.phase == kBlokPassCapture)
+	{
+		error = CaptureSome(pass, budgetMs);
+	}
+
+	if (!error && pass.phase == kBlokPassSolve && MillisecondsSince(start) < budgetMs)
+	{
+		Solve(pass);
+	}
+
+	// Frames stretched to measure text have to be in the undo context of
+	// the first apply, even if the solve used up the budget
+	bool mustApply = pass.hasMeasureEdits && !pass.hasAppliedVisible;
+
+	if (!error && pass.phase == kBlokPassApply && (mustApply || MillisecondsSince(start) < budgetMs))
+	{
+		error = Apply(pass, std::max(budgetMs - MillisecondsSince(start), 0.0));
+	}
+
+	if (error && !pass.isStale)
+	{
+		// Whatever was captured can't be trusted anymore
+		pass.phase = kBlokPassIdle;
+	}
+
+	isDone = !error && !pass.IsActive();
+
+	return error;
+}
+
+/**	Throw away everything captured and go back to the start of capture. Roots
+	are looked up again, in case art was deleted or regrouped.
+*/
+void BlokEngine::RestartPass(BlokPass& pass)
+{
+	std::vector<AIArtHandle> roots;
+	pass.rootSet.clear();
+
+	for (size_t i = 0; i < pass.roots.size(); i++)
+	{
+		AIArtHandle root = sAIArt->ValidArt(pass.roots[i], true) ? BlokGetRootContainer(pass.roots[i]) : NULL;
+
+		if (root && pass.rootSet.insert(root).second)
+		{
+			roots.push_back(root);
+		}
+	}
+
+	std::sort(roots.begin(), roots.end(), IsBehind);
+
+	pass.phase = roots.empty() ? kBlokPassIdle : kBlokPassCapture;
+	pass.roots.swap(roots);
+	pass.nextRoot = 0;
+	pass.current = BlokSnapshot();
+	pass.isCapturing = false;
+	pass.snapshots.clear();
+	pass.changes.clear();
+	pass.bounds.clear();
+	pass.capturedNodes = 0;
+	pass.expectedNodes = 0;
+	pass.hasAppliedVisible = false;
+	pass.deferred.clear();
+	pass.nextDeferred = 0;
+	pass.undoTag = 0;
+	pass.applier = BlokApplier();
+	pass.isStale = false;
+	pass.restarts++;
+	pass.textHits = fTextMeasurer.GetHitCount();
+	pass.textMisses = fTextMeasurer.GetMissCount();
+	pass.hasMeasureEdits = false;
+	pass.stats = BlokEngineStats();
+
+	for (size_t i = 0; i < pass.roots.size(); i++)
+	{
+		std::unordered_map<AIArtHandle, size_t>::const_iterator found = fNodeCounts.find(pass.roots[i]);
+
+		if (found != fNodeCounts.end())
+		{
+			pass.expectedNodes += found->second;
+		}
+	}
+}
+
+/**	Capture, a container at a time until budgetMs runs out. Illustrator can
+	only be called from this thread.
+*/
+AIErr BlokEngine::CaptureSome(BlokPass& pass, double budgetMs)
+{
+	AIErr error = kNoErr;
+	BlokClock::time_point start = BlokClock::now();
+
+	while (!error && pass.phase == kBlokPassCapture && MillisecondsSince(start) < budgetMs)
+	{
+		if (pass.nextRoot >= pass.roots.size())
+		{
+			pass.stats.roots = pass.snapshots.size();
+			pass.phase = kBlokPassSolve;
+		}
+		else if (!pass.isCapturing)
+		{
+			pass.current.overrideArt = pass.overrideArt;
+			pass.current.overrideWidth = pass.overrideWidth;
+			pass.current.overrideHeight = pass.overrideHeight;
+
+			error = pass.current.BeginCapture(pass.roots[pass.nextRoot], &fTextMeasurer);
+			pass.isCapturing = true;
+		}
+		else if (!pass.current.IsCaptured())
+		{
+			size_t size = pass.current.tree.Size();
+			error = pass.current.CaptureNext();
+
+			pass.capturedNodes += pass.current.tree.Size() - size;
+		}
+		else
+		{
+			AIArtHandle root = pass.roots[pass.nextRoot];
+			fNodeCounts[root] = pass.current.tree.Size();
+
+			if (pass.current.supported)
+			{
+				pass.stats.nodes += pass.current.tree.Size();
+				pass.snapshots.push_back(std::move(pass.current));
+			}
+			else
+			{
+				pass.stats.skipped.push_back(root);
+			}
+
+			pass.current = BlokSnapshot();
+			pass.isCapturing = false;
+			pass.nextRoot++;
+		}
+	}
+
+	pass.stats.snapshotMs += MillisecondsSince(start);
+
+	return error;
+}
+
+/**	Solve every snapshot and diff it. Snapshots are independent of each other
+	so this is safe to spread out.
+*/
+void BlokEngine::Solve(BlokPass& pass)
+{
+	std::vector<BlokSnapshot>& snapshots = pass.snapshots;
+	std::vector<std::vector<BlokChange>>& changes = pass.changes;
+	std::vector<std::vector<BlokRect>>& bounds = pass.bounds;
+	BlokEngineStats& stats = pass.stats;
+
+	fPool.Start();
+	stats.threads = std::min(fPool.GetConcurrency(), std::max(snapshots.size(), (size_t)1));
+
+	BlokClock::time_point start = BlokClock::now();
+
+	BlokThreadPool* pool = &fPool;
+
+	pass.textEdits = fTextMeasurer.GetEditCount();
+	sAIDocument->GetDocumentModified(&pass.wasModified);
+
+	changes.resize(snapshots.size());
+	bounds.resize(snapshots.size());
+
+	// Roots with autoHeight text measure it through ATE, which only works
+	// on this thread. Everything else goes to the pool. A tree that was
+	// solved before, like one undo put back, isn't solved at all.
+	std::vector<size_t> parallel;
+	std::vector<size_t> solved;
+
+	for (size_t i = 0; i < snapshots.size(); i++)
+	{
+		if (fHistory.Restore(snapshots[i]))
+		{
+			BlokApplier::Diff(snapshots[i], changes[i], bounds[i]);
+			stats.historyHits++;
+		}
+		else if (snapshots[i].measuredCount > 0)
+		{
+			snapshots[i].AttachMeasure();
+			BlokLayoutSolve(snapshots[i].tree);
+			BlokApplier::Diff(snapshots[i], changes[i], bounds[i]);
+			solved.push_back(i);
+		}
+		else
+		{
+			parallel.push_back(i);
+			solved.push_back(i);
+		}
+	}
+
+	stats.textHits = fTextMeasurer.GetHitCount() - pass.textHits;
+	stats.textMisses = fTextMeasurer.GetMissCount() - pass.textMisses;
+	pass.hasMeasureEdits = fTextMeasurer.GetEditCount() > pass.textEdits;
+
+	// Big roots also split their own subtrees across the pool. Diffing doesn't
+	// touch Illustrator either, so the change list is built here too.
+	fPool.ParallelFor(parallel.size(), [&snapshots, &changes, &bounds, &parallel, pool](size_t j)
+	{
+		size_t i = parallel[j];
+
+		BlokLayoutSolve(snapshots[i].tree, pool);
+		BlokApplier::Diff(snapshots[i], changes[i], bounds[i]);
+	});
+
+	for (size_t i = 0; i < solved.size(); i++)
+	{
+		fHistory.Store(snapshots[solved[i]]);
+	}
+
+	stats.solveMs = MillisecondsSince(start);
+
+	for (size_t i = 0; i < snapshots.size(); i++)
+	{
+		stats.cacheHits += snapshots[i].tree.cacheHits;
+		stats.cacheMisses += snapshots[i].tree.cacheMisses;
+		stats.dedupHits += snapshots[i].tree.dedupHits;
+		stats.dedupNodes += snapshots[i].tree.dedupNodes;
+	}
+
+	pass.phase = kBlokPassApply;
+}
+
+/**	Apply what's on screen, then as many off-screen changes as fit in
+	budgetMs. Tags are saved along with the last change.
+*/
+AIErr BlokEngine::Apply(BlokPass& pass, double budgetMs)
+{
+	AIErr error = kNoErr;
+	BlokClock::time_point start = BlokClock::now();
+	size_t changeCount = pass.applier.GetChangeCount();
+	bool isFirstCall = !pass.hasAppliedVisible;
+
+	// Earlier calls are in the undo step for good, see AbortApply()
+	pass.applier.Commit();
+
+	if (isFirstCall)
+	{
+		bool hasChanges = false;
+
+		for (size_t i = 0; !hasChanges && i < pass.changes.size(); i++)
+		{
+			hasChanges = !pass.changes[i].empty();
+		}
+
+		// A resize is its own step, the tool names it. RelayoutRoots() tags its step up front
+		if (hasChanges && !pass.undoTag)
+		{
+			pass.undoTag = fUndo.BeginStep(pass.roots, pass.overrideArt == NULL);
+		}
+
+		error = ApplyVisible(pass);
+	}
+	else if (!ResumeApply(pass))
+	{
+		return error;
+	}
+
+	while (!error && pass.nextDeferred < pass.deferred.size() && MillisecondsSince(start) < budgetMs)
+	{
+		error = pass.applier.ApplyChange(pass.deferred[pass.nextDeferred]);
+
+		if (!error)
+		{
+			pass.nextDeferred++;
+		}
+	}
+
+	if (!error && pass.nextDeferred == pass.deferred.size())
+	{
+		for (size_t i = 0; !error && i < pass.snapshots.size(); i++)
+		{
+			error = pass.applier.SaveTags(pass.snapshots[i], pass.bounds[i]);
+
+			if (!error && fOverlay)
+			{
+				fOverlay->Update(pass.snapshots[i], pass.bounds[i]);
+			}
+		}
+
+		// Nothing moved and no tag changed, the only edits were measuring
+		if (!error && pass.hasMeasureEdits && !pass.applier.HasWritten())
+		{
+			ForgetMeasureEdits(pass.wasModified);
+		}
+
+		pass.phase = kBlokPassIdle;
+	}
+
+	// One redraw for everything this call changed
+	if (pass.applier.GetChangeCount() > changeCount)
+	{
+		sAIDocument->RedrawDocument();
+	}
+
+	pass.stats.applyMs += MillisecondsSince(start);
+	pass.stats.changed = pass.applier.GetChangeCount();
+	pass.stats.applyCalls = pass.applier.GetCallCount();
+
+	if (error)
+	{
+		AbortApply(pass, isFirstCall);
+	}
+
+	return error;
+}
+
+/**	Apply the changes to art the user can see, back to front like the z-order
+	they were captured in. The rest wait in pass.deferred. Changes don't depend
+	on each other, so splitting them up doesn't change the result.
+*/
+AIErr BlokEngine::ApplyVisible(BlokPass& pass)
+{
+	AIErr error = kNoErr;
+	std::vector<BlokRect> visible;
+
+	BlokGetVisibleRects(visible);
+	pass.hasAppliedVisible = true;
+
+	for (size_t i = 0; !error && i < pass.snapshots.size(); i++)
+	{
+		const std::vector<BlokChange>& changes = pass.changes[i];
+
+		for (size_t j = 0; !error && j < changes.size(); j++)
+		{
+			// If we can't tell what's on screen, all of it is
+			bool isVisible = visible.empty();
+
+			for (size_t k = 0; !isVisible && k < visible.size(); k++)
+			{
+				isVisible = BlokRectsIntersect(changes[j].from, visible[k]) || BlokRectsIntersect(changes[j].to, visible[k]);
+			}
+
+			if (isVisible)
+			{
+				error = pass.applier.ApplyChange(changes[j]);
+			}
+			else
+			{
+				pass.deferred.push_back(changes[j]);
+			}
+		}
+	}
+
+	return error;
+}
+
+/**	Pick up off-screen changes in a later call. They can only join our undo
+	step if it's still the latest one.
+@return true to go on applying, false if the pass was dropped or restarted.
+*/
+bool BlokEngine::ResumeApply(BlokPass& pass)
+{
+	if (fUndo.IsOnTop(pass.undoTag))
+	{
+		sAIUndo->SetKind(kAIAppendUndoContext);
+		return true;
+	}
+
+	if (fUndo.IsUndone(pass.undoTag))
+	{
+		// They undid the on-screen half, which leaves the art like it was before
+		pass.phase = kBlokPassIdle;
+	}
+	else
+	{
+		// They did something since, which can't share an undo step with us.
+		// What's left may not fit anymore either, so work it all out again.
+		RestartPass(pass);
+	}
+
+	return false;
+}
+
+/**	Measuring text stretches frames and puts them back exactly as they
+	were, see BlokTextMeasurer::Compose(). If that's all the current undo
+	context did, keep it out of the undo history and leave the document as
+	clean as it was. Illustrator ignores SetSilent() in a nested context,
+	like a script's, where the script's own changes make the step anyway.
+@param wasModified IN whether the document was modified before measuring.
+*/
+void BlokEngine::ForgetMeasureEdits(AIBoolean wasModified)
+{
+	sAIUndo->SetSilent(true);
+	sAIDocument->SetDocumentModified(wasModified);
+}
+
+/**	Take back what this call applied, so the art and its saved tags never
+	disagree. Only the applier's own writes are replayed backwards, anything
+	else in the undo context, like the panel's settings, stays. Changes from
+	earlier calls are in the undo step for good, so a pass that has them
+	starts over from the art as it is now.
+@param isFirstCall IN true if nothing was applied before this call.
+*/
+void BlokEngine::AbortApply(BlokPass& pass, bool isFirstCall)
+{
+	pass.applier.Rollback();
+
+	if (isFirstCall)
+	{
+		pass.phase = kBlokPassIdle;
+	}
+	else
+	{
+		pass.isStale = true;
+	}
+}
+
+void BlokEngine::BeginUndoStep(const std::vector<AIArtHandle>& art)
+{
+	std::vector<AIArtHandle> roots;
+	std::unordered_set<AIArtHandle> rootSet;
+
+	for (size_t i = 0; i < art.size(); i++)
+	{
+		AIArtHandle root = BlokGetRootContainer(art[i]);
+
+		if (root && rootSet.insert(root).second)
+		{
+			roots.push_back(root);
+		}
+	}
+
+	if (!roots.empty())
+	{
+		fUndo.BeginStep(roots);
+	}
+}
+
+AIErr BlokEngine::RelayoutAll(BlokEngineStats& stats)
+{
+	std::vector<AIArtHandle> roots;
+	AIErr error = BlokGetRootContainers(roots);
+
+	if (!error)
+	{
+		error = RelayoutRoots(roots, stats);
+	}
+
+	return error;
+}
+
+AIErr BlokEngine::CheckRoots(const std::vector<AIArtHandle>& art, BlokEngineStats& stats)
+{
+	AIErr error = kNoErr;
+	BlokPass pass;
+	BeginPass(pass, art);
+
+	std::vector<BlokSnapshot> snapshots(pass.roots.size());
+	std::vector<BlokLayoutTree> expected(pass.roots.size());
+	std::vector<size_t> parallel;
+	BlokThreadPool* pool = &fPool;
+
+	stats = BlokEngineStats();
+
+	fPool.Start();
+	stats.threads = fPool.GetConcurrency();
+	fTextMeasurer.SetCanEdit(false);
+
+	for (size_t i = 0; !error && i < snapshots.size(); i++)
+	{
+		error = snapshots[i].Capture(pass.roots[i], &fTextMeasurer);
+	}
+
+	for (size_t i = 0; !error && i < snapshots.size(); i++)
+	{
+		BlokSnapshot& snapshot = snapshots[i];
+
+		if (!snapshot.supported)
+		{
+			stats.skipped.push_back(pass.roots[i]);
+			continue;
+		}
+
+		// The snapshots don't move anymore, the measure context can point at them
+		snapshot.AttachMeasure();
+		stats.roots++;
+		stats.nodes += snapshot.tree.Size();
+
+		expected[i] = snapshot.tree;
+		BlokLayoutSolveReference(expected[i]);
+
+		if (snapshot.measuredCount > 0)
+		{
+			BlokLayoutSolve(snapshot.tree);
+		}
+		else
+		{
+			parallel.push_back(i);
+		}
+	}
+
+	if (!error)
+	{
+		fPool.ParallelFor(parallel.size(), [&snapshots, &parallel, pool](size_t j)
+		{
+			BlokLayoutSolve(snapshots[parallel[j]].tree, pool, 1);
+		});
+	}
+
+	for (size_t i = 0; !error && i < snapshots.size(); i++)
+	{
+		BlokLayoutTree& tree = snapshots[i].tree;
+
+		if (!snapshots[i].supported)
+		{
+			continue;
+		}
+
+		stats.dedupHits += tree.dedupHits;
+		stats.dedupNodes += tree.dedupNodes;
+
+		bool isIdentical = IsLayoutIdentical(tree, expected[i]);
+
+		// Nothing changed, so only the dirty leaf and its ancestors are laid out again
+		tree.MarkDirty(tree.Size() - 1);
+		BlokLayoutSolve(tree, snapshots[i].measuredCount > 0 ? NULL : pool, 1);
+
+		stats.cacheHits += tree.cacheHits;
+		stats.cacheMisses += tree.cacheMisses;
+
+		if (!isIdentical || !IsLayoutIdentical(tree, expected[i]))
+		{
+			stats.mismatched.push_back(pass.roots[i]);
+		}
+	}
+
+	fTextMeasurer.SetCanEdit(true);
+
+	return error;
+}
+
+AIErr BlokEngine::RefreshDebugOverlay()
+{
+	std::vector<AIArtHandle> roots;
+	AIErr error = kNoErr;
+
+	if (!fOverlay || !fOverlay->IsVisible())
+	{
+		return error;
+	}
+
+	error = BlokGetRootContainers(roots);
+
+	fPool.Start();
+	fTextMeasurer.SetCanEdit(false);
+
+	for (size_t i = 0; !error && i < roots.size(); i++)
+	{
+		BlokSnapshot snapshot;
+		std::vector<BlokChange> changes;
+		std::vector<BlokRect> bounds;
+
+		error = snapshot.Capture(roots[i], &fTextMeasurer);
+
+		if (error || !snapshot.supported)
+		{
+			continue;
+		}
+
+		// Not stored in the history, text that couldn't be measured may be off
+		if (!fHistory.Restore(snapshot))
+		{
+			snapshot.AttachMeasure();
+			BlokLayoutSolve(snapshot.tree, snapshot.measuredCount > 0 ? NULL : &fPool);
+		}
+
+		BlokApplier::Diff(snapshot, changes, bounds);
+		fOverlay->Update(snapshot, bounds);
+	}
+
+	fTextMeasurer.SetCanEdit(true);
+
+	return error;
+}
+
+void BlokEngine::Shutdown()
+{
+	fPool.Stop();
+}
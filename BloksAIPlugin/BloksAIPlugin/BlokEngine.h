@@ -0,0 +1,396 @@
+#ifndef __BlokEngine_h__
+#define __BlokEngine_h__
+
+#include "IllustratorSDK.h"
+#include "BlokApply.h"
+#include "BlokDebugOverlay.h"
+#include "BlokHistory.h"
+#include "BlokSnapshot.h"
+#include "BlokText.h"
+#include "BlokThreadPool.h"
+#include "BlokUndo.h"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/** What happened during a relayout, reported back to the panel */
+struct BlokEngineStats
+{
+	BlokEngineStats();
+
+	/** Number of root BlokContainers laid out natively */
+	size_t roots;
+
+	/** Number of Bloks across all of those roots */
+	size_t nodes;
+
+	/** Number of threads the solve was spread across */
+	size_t threads;
+
+	/** Nodes the solver answered from the measure cache, and nodes it had to lay out */
+	size_t cacheHits;
+	size_t cacheMisses;
+
+	/**	Subtrees that copied the layout of an identical sibling instead of being
+		solved, and how many nodes that covered. Written out as dedupRatio, the
+		fraction of all nodes.
+	*/
+	size_t dedupHits;
+	size_t dedupNodes;
+
+	/** Text heights and baselines answered from the cache, and ones ATE had to work out */
+	size_t textHits;
+	size_t textMisses;
+
+	/** Roots whose layout came from an earlier solve of the same tree, like after undo */
+	size_t historyHits;
+
+	/** Time spent in each phase, in milliseconds */
+	double snapshotMs;
+	double solveMs;
+	double applyMs;
+
+	/** Number of art that actually moved or resized, everything else wasn't touched */
+	size_t changed;
+
+	/** Number of SDK calls the apply phase made, also written out per node */
+	size_t applyCalls;
+
+	/** Roots we couldn't lay out natively, TypeScript has to invalidate() them */
+	std::vector<AIArtHandle> skipped;
+
+	/** Roots that solved differently than a plain serial solve, only filled by BlokEngine::CheckRoots() */
+	std::vector<AIArtHandle> mismatched;
+
+	/**	Write ourselves out as a JSON object. Skipped and mismatched roots are listed by UUID.
+	*/
+	std::string ToJSON() const;
+};
+
+/** Where a BlokPass is, see BlokEngine::ContinuePass() */
+enum BlokPassPhase
+{
+	/** Nothing to do, or done */
+	kBlokPassIdle = 0,
+
+	/** Reading art, a container at a time */
+	kBlokPassCapture = 1,
+
+	/** Solving and diffing every snapshot, in one go */
+	kBlokPassSolve = 2,
+
+	/**	Changing art. What's on screen goes first, the rest can follow in later
+		calls, appended to the same undo step
+	*/
+	kBlokPassApply = 3
+};
+
+/**	A layout of some roots that can be spread over several calls to
+	BlokEngine::ContinuePass(), like one per idle tick, for trees too big to
+	lay out without blocking Illustrator. Capture only reads the art. The
+	solve only touches it to measure autoHeight text, which stretches frames
+	and puts them back, see BlokTextMeasurer::Measure(). A pass that does
+	that applies in the same call, so the edits join its undo step. Apply
+	is the only phase that leaves changes behind.
+
+	Apply changes the art inside the document view and active artboard right
+	away. Off-screen art follows in later calls, each appended to the undo step
+	of the first, so undo always takes back the whole layout. That step may
+	itself be merged with an earlier layout, see BlokUndoMerger. If the user
+	undoes that step first the rest is dropped, if they make a step of their
+	own the pass starts over.
+
+	If the art changes between calls before apply, set isStale and the pass
+	starts over from capture the next time it continues. If a change fails
+	to apply, what that call changed is undone. A pass that applied nothing
+	before ends there. One that already changed art in earlier calls starts
+	over from the art as it is now, so tags are never saved for a half
+	applied root.
+*/
+struct BlokPass
+{
+	BlokPass();
+
+	BlokPassPhase phase;
+
+	/** Roots being laid out, back to front */
+	std::vector<AIArtHandle> roots;
+	std::unordered_set<AIArtHandle> rootSet;
+
+	/** Index into roots of the next one to capture */
+	size_t nextRoot;
+
+	/** Root being captured, valid while isCapturing */
+	BlokSnapshot current;
+	bool isCapturing;
+
+	/** Captured roots we can lay out, and the diff of each once solved */
+	std::vector<BlokSnapshot> snapshots;
+	std::vector<std::vector<BlokChange>> changes;
+	std::vector<std::vector<BlokRect>> bounds;
+
+	/** True once apply made its first changes, the on-screen ones */
+	bool hasAppliedVisible;
+
+	/** Off-screen changes, and the index of the next one to apply */
+	std::vector<BlokChange> deferred;
+	size_t nextDeferred;
+
+	/** Tag of the undo step of the first apply, so later ones know it's still on top */
+	ai::int32 undoTag;
+
+	/** Counts changes and calls across every apply */
+	BlokApplier applier;
+
+	/** Nodes captured so far, and how many the roots had last time they were laid out */
+	size_t capturedNodes;
+	size_t expectedNodes;
+
+	/** Set when the art changes under the pass, it's captured again */
+	bool isStale;
+
+	/** Container being resized and its new size, see BlokSnapshot::overrideArt */
+	AIArtHandle overrideArt;
+	double overrideWidth;
+	double overrideHeight;
+
+	/** Number of times the pass started over */
+	size_t restarts;
+
+	/** Text measure counts when capture started, stats only count this pass */
+	size_t textHits;
+	size_t textMisses;
+
+	/**	Text measure edits when the solve started and whether the document was
+		modified then, see BlokEngine::ForgetMeasureEdits()
+	*/
+	size_t textEdits;
+	AIBoolean wasModified;
+
+	/** True if measuring text during the solve stretched frames and put them back */
+	bool hasMeasureEdits;
+
+	/** Added to as the pass goes, complete once it's done */
+	BlokEngineStats stats;
+
+	bool IsActive() const { return phase != kBlokPassIdle; }
+
+	/**	True if root is one of the roots being laid out.
+	@param root IN a root BlokContainer.
+	*/
+	bool Contains(AIArtHandle root) const { return rootSet.count(root) > 0; }
+
+	/** Roughly how far along the pass is, 0.0 to 1.0 */
+	double GetProgress() const;
+
+	/** Write out the phase and progress as a JSON object, for the panel */
+	std::string ToJSON() const;
+};
+
+/**	A resize of a container that's still being dragged. The root is captured
+	once when the drag starts, then solved again for every size the drag
+	passes through without touching the art, see BlokEngine::BeginResize().
+	Between frames only the container and its ancestors are dirty, so the
+	measure cache answers for everything that didn't change.
+*/
+struct BlokResize
+{
+	BlokResize();
+
+	/** Container being resized, NULL if there's no resize */
+	AIArtHandle container;
+
+	/** The container's node in snapshot */
+	size_t node;
+
+	/**	True if the container's width or height is fixed by its style. Only
+		those follow the drag, like overrideWidth and overrideHeight in
+		BlokSnapshot::CaptureChildren().
+	*/
+	bool isWidthFixed;
+	bool isHeightFixed;
+
+	/** The container's root, captured once. Only usable if snapshot.supported */
+	BlokSnapshot snapshot;
+
+	/** Layout at the last size, what the preview draws and what's applied */
+	std::vector<BlokChange> changes;
+	std::vector<BlokRect> bounds;
+
+	/** Time spent solving and diffing, over every size so far */
+	double solveMs;
+
+	/** Text measure edits when the drag started, and whether the document was modified then */
+	size_t textEdits;
+	AIBoolean wasModified;
+
+	/** True if there's a layout to preview and apply */
+	bool IsActive() const { return container != NULL && snapshot.supported; }
+};
+
+/**	Lays out many unrelated root BlokContainers at once. Every root is captured
+	on the main thread, solved on a pool of worker threads, then applied back on
+	the main thread in z-order. Roots with autoHeight text are solved on the
+	main thread too, since measuring it calls into Illustrator.
+*/
+class BlokEngine
+{
+public:
+	BlokEngine();
+
+	/**	Lay out the root BlokContainer above each art object. Art that shares a
+		root is only laid out once. The caller's undo context becomes a layout
+		step, see BlokUndoMerger, so changes the caller made before share it.
+	@param art IN any art in a Blok tree.
+	@param stats OUT what happened.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr RelayoutRoots(const std::vector<AIArtHandle>& art, BlokEngineStats& stats);
+
+	/**	Lay out every root BlokContainer in the current document.
+	@param stats OUT what happened.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr RelayoutAll(BlokEngineStats& stats);
+
+	/**	Lay out the tree of a container as if it were resized, without
+		scaling anything in it. The container's children stretch, flex and
+		space out to fill the new size, then the whole root is laid out and
+		applied in a single undo step. If the tree can't be laid out natively
+		the size is saved on the container for BlokContainer.invalidate().
+	@param container IN any BlokContainer, root or nested.
+	@param width IN new width of the container.
+	@param height IN new height of the container.
+	@param stats OUT what happened, the root is in skipped if it wasn't laid out.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr ResizeContainer(AIArtHandle container, AIReal width, AIReal height, BlokEngineStats& stats);
+
+	/**	Capture the tree of a container at the start of a resize drag.
+	@param container IN any BlokContainer, root or nested.
+	@param resize OUT the resize. Not active if the tree can't be laid out natively.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr BeginResize(AIArtHandle container, BlokResize& resize);
+
+	/**	Solve an active resize at a new size of its container. Doesn't call into
+		Illustrator unless the tree has autoHeight text.
+	@param resize IN/OUT the resize, its changes and bounds are updated.
+	@param width IN new width of the container.
+	@param height IN new height of the container.
+	*/
+	void UpdateResize(BlokResize& resize, AIReal width, AIReal height);
+
+	/**	Apply a resize at its final size as a single batch of changes. A resize
+		that isn't active goes through ResizeContainer() instead.
+	@param resize IN/OUT the resize, from BeginResize().
+	@param width IN final width of the container.
+	@param height IN final height of the container.
+	@param stats OUT what happened.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr CommitResize(BlokResize& resize, AIReal width, AIReal height, BlokEngineStats& stats);
+
+	/**	Drop a resize without applying it, like a click that didn't drag.
+		Call in the tool's undo context, the same one as BeginResize().
+	@param resize IN the resize, from BeginResize().
+	*/
+	void DiscardResize(const BlokResize& resize);
+
+	/**	Start laying out the root BlokContainer above each art object, like
+		RelayoutRoots(), but through ContinuePass(). Replaces whatever pass was
+		in progress without touching its art.
+	@param pass OUT the pass to start.
+	@param art IN any art in a Blok tree.
+	*/
+	void BeginPass(BlokPass& pass, const std::vector<AIArtHandle>& art);
+
+	/**	Work on a pass until it's done or budgetMs runs out, whichever comes
+		first. Capture stops between containers and apply between off-screen
+		changes. Solve and the on-screen changes each happen in a single call
+		once they start, so a call can run over budgetMs.
+	@param pass IN/OUT a pass from BeginPass().
+	@param budgetMs IN milliseconds to spend, infinity to finish.
+	@param isDone OUT true if the pass finished, its stats are complete.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr ContinuePass(BlokPass& pass, double budgetMs, bool& isDone);
+
+	/**	Stop the worker threads. They restart the next time there is work.
+	*/
+	void Shutdown();
+
+	/**	Hand every root that's laid out and applied to an overlay.
+	@param overlay IN the overlay, NULL for none. Must outlive the engine.
+	*/
+	void SetDebugOverlay(BlokDebugOverlay* overlay) { fOverlay = overlay; }
+
+	/**	Capture and solve every root in the current document and hand them to
+		the overlay, without applying anything. Dirty boxes are the ones the
+		next relayout would change. Never writes to the document: text that
+		ATE would have to compose again to measure keeps its current height.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr RefreshDebugOverlay();
+
+	/**	Forget the last undo step if it was in a document that was just
+		closed. Remembered solves are keyed by their inputs alone, so they
+		stay good for every other document.
+	*/
+	void DocumentClosed() { fUndo.DocumentClosed(); }
+
+	/**	Solve the root BlokContainer above each art object the way a relayout
+		would, with the measure cache, sibling copies and the thread pool, and
+		check each against BlokLayoutSolveReference(). Roots are split down to
+		single nodes so even small ones run in parallel, then solved again
+		with one leaf dirty so the rest comes from the cache. Only reads the
+		art, text that would have to be edited to measure keeps its height.
+	@param art IN any art in a Blok tree.
+	@param stats OUT roots that didn't match are in mismatched.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr CheckRoots(const std::vector<AIArtHandle>& art, BlokEngineStats& stats);
+
+	/**	Have the changes a script is about to make share an undo step with
+		the layout of the art's roots that follows, see BlokUndoMerger. Call
+		from a script message, before anything is laid out.
+	@param art IN any art in a Blok tree.
+	*/
+	void BeginUndoStep(const std::vector<AIArtHandle>& art);
+
+	/**	Start or end a panel edit session, every layout during one shares
+		an undo step.
+	@param isInSession IN true to start one.
+	*/
+	void SetUndoSession(bool isInSession) { fUndo.SetSession(isInSession); }
+
+private:
+	void RestartPass(BlokPass& pass);
+	AIErr CaptureSome(BlokPass& pass, double budgetMs);
+	void Solve(BlokPass& pass);
+	AIErr Apply(BlokPass& pass, double budgetMs);
+	AIErr ApplyVisible(BlokPass& pass);
+	bool ResumeApply(BlokPass& pass);
+	void AbortApply(BlokPass& pass, bool isFirstCall);
+	void ForgetMeasureEdits(AIBoolean wasModified);
+
+	// Names our undo steps and merges the ones that follow each other
+	BlokUndoMerger fUndo;
+
+	BlokThreadPool fPool;
+
+	// Kept between relayouts, so text that didn't change isn't reflowed again
+	BlokTextMeasurer fTextMeasurer;
+
+	// Node count of each root the last time it was captured, for progress
+	std::unordered_map<AIArtHandle, size_t> fNodeCounts;
+
+	// Recent solves, so undo and redo don't solve again
+	BlokLayoutHistory fHistory;
+
+	BlokDebugOverlay* fOverlay;
+};
+
+#endif
@@ -0,0 +1,307 @@
+#include "IllustratorSDK.h"
+#include "BlokHistory.h"
+
+#include <algorithm>
+#include <cstring>
+
+/** Values per node in Block::layout */
+#define kBlokHistoryLayoutValues 5
+
+/** Same mix as the solver's, FNV-1a a word at a time */
+static inline uint64_t HashMix(uint64_t hash, uint64_t value)
+{
+	return (hash ^ value) * 0x100000001b3ull;
+}
+
+static inline uint64_t HashMix(uint64_t hash, double value)
+{
+	uint64_t bits = 0;
+
+	// Every NaN is "undefined"
+	if (value == value)
+	{
+		std::memcpy(&bits, &value, sizeof(bits));
+	}
+	else
+	{
+		bits = 0x7ff8000000000000ull;
+	}
+
+	return HashMix(hash, bits);
+}
+
+size_t BlokLayoutHistory::Block::GetByteCount() const
+{
+	return sizeof(Block) + inputs.size() * sizeof(uint64_t) + layout.size() * sizeof(double);
+}
+
+bool BlokLayoutHistory::Block::operator==(const Block& other) const
+{
+	// Bitwise, so undefined baselines compare equal
+	return hash == other.hash &&
+		inputs == other.inputs &&
+		layout.size() == other.layout.size() &&
+		std::memcmp(layout.data(), other.layout.data(), layout.size() * sizeof(double)) == 0;
+}
+
+BlokLayoutHistory::BlokLayoutHistory(size_t maxBytes) :
+	fMaxBytes(maxBytes),
+	fBytes(0),
+	fClock(0)
+{
+}
+
+bool BlokLayoutHistory::Restore(BlokSnapshot& snapshot)
+{
+	if (fEntries.empty() || snapshot.tree.Size() == 0)
+	{
+		return false;
+	}
+
+	std::vector<uint64_t> inputs;
+	uint64_t key = 0;
+	HashInputs(snapshot, inputs, key);
+
+	Entry* entry = Find(key, inputs);
+
+	if (!entry)
+	{
+		return false;
+	}
+
+	BlokLayoutTree& tree = snapshot.tree;
+	size_t node = 0;
+
+	for (size_t i = 0; i < entry->blocks.size(); i++)
+	{
+		const std::vector<double>& layout = entry->blocks[i]->layout;
+
+		for (size_t j = 0; j < layout.size(); j += kBlokHistoryLayoutValues, node++)
+		{
+			tree.layoutLeft[node] = layout[j];
+			tree.layoutTop[node] = layout[j + 1];
+			tree.layoutWidth[node] = layout[j + 2];
+			tree.layoutHeight[node] = layout[j + 3];
+			tree.layoutBaseline[node] = layout[j + 4];
+		}
+	}
+
+	tree.cacheHits = 0;
+	tree.cacheMisses = 0;
+	tree.dedupHits = 0;
+	tree.dedupNodes = 0;
+
+	entry->lastUsed = ++fClock;
+
+	return true;
+}
+
+void BlokLayoutHistory::Store(const BlokSnapshot& snapshot)
+{
+	const BlokLayoutTree& tree = snapshot.tree;
+	size_t size = tree.Size();
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	std::vector<uint64_t> inputs;
+	uint64_t key = 0;
+	HashInputs(snapshot, inputs, key);
+
+	Entry* found = Find(key, inputs);
+
+	if (found)
+	{
+		// Solved the same thing again, the layout can't have changed
+		found->lastUsed = ++fClock;
+		return;
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.size = size;
+	entry.lastUsed = ++fClock;
+
+	for (size_t first = 0; first < size; first += kBlokHistoryBlockSize)
+	{
+		size_t last = std::min(first + kBlokHistoryBlockSize, size);
+		Block block;
+
+		block.inputs.assign(inputs.begin() + first, inputs.begin() + last);
+		block.layout.reserve((last - first) * kBlokHistoryLayoutValues);
+		block.hash = 0xcbf29ce484222325ull;
+
+		for (size_t node = first; node < last; node++)
+		{
+			block.layout.push_back(tree.layoutLeft[node]);
+			block.layout.push_back(tree.layoutTop[node]);
+			block.layout.push_back(tree.layoutWidth[node]);
+			block.layout.push_back(tree.layoutHeight[node]);
+			block.layout.push_back(tree.layoutBaseline[node]);
+
+			block.hash = HashMix(block.hash, inputs[node]);
+		}
+
+		for (size_t i = 0; i < block.layout.size(); i++)
+		{
+			block.hash = HashMix(block.hash, block.layout[i]);
+		}
+
+		entry.blocks.push_back(Share(block));
+	}
+
+	fEntries.push_back(std::move(entry));
+	Trim();
+}
+
+void BlokLayoutHistory::Clear()
+{
+	fEntries.clear();
+	fBlocks.clear();
+	fBytes = 0;
+}
+
+/**	Hash what decides each node's layout: where it is in the tree, its style,
+	and for measured text what ATE measures it by.
+@param inputs OUT one hash per node.
+@param key OUT hash of the whole tree.
+*/
+void BlokLayoutHistory::HashInputs(const BlokSnapshot& snapshot, std::vector<uint64_t>& inputs, uint64_t& key)
+{
+	const BlokLayoutTree& tree = snapshot.tree;
+	size_t size = tree.Size();
+
+	inputs.resize(size);
+	key = HashMix(0xcbf29ce484222325ull, (uint64_t)size);
+
+	for (size_t node = 0; node < size; node++)
+	{
+		uint64_t hash = HashMix(0xcbf29ce484222325ull, (uint64_t)(int64_t)tree.parent[node]);
+		hash = HashMix(hash, (uint64_t)tree.firstChild[node]);
+		hash = HashMix(hash, (uint64_t)tree.childCount[node]);
+		hash = HashMix(hash, tree.styleWidth[node]);
+		hash = HashMix(hash, tree.styleHeight[node]);
+		hash = HashMix(hash, tree.flex[node]);
+		hash = HashMix(hash, (uint64_t)(int64_t)tree.alignSelf[node]);
+		hash = HashMix(hash, (uint64_t)(int64_t)tree.flexDirection[node]);
+		hash = HashMix(hash, (uint64_t)(int64_t)tree.justifyContent[node]);
+		hash = HashMix(hash, (uint64_t)(int64_t)tree.alignItems[node]);
+		hash = HashMix(hash, tree.paddingTop[node]);
+		hash = HashMix(hash, tree.paddingRight[node]);
+		hash = HashMix(hash, tree.paddingBottom[node]);
+		hash = HashMix(hash, tree.paddingLeft[node]);
+		hash = HashMix(hash, tree.gap[node]);
+		hash = HashMix(hash, (uint64_t)tree.isMeasured[node]);
+		hash = HashMix(hash, tree.styleBaseline[node]);
+
+		// Without a measurer measured leaves keep their style dims
+		if (tree.isMeasured[node] && snapshot.textMeasurer && node < snapshot.textKeys.size())
+		{
+			hash = HashMix(hash, snapshot.textKeys[node].contentHash);
+			hash = HashMix(hash, snapshot.textKeys[node].styleHash);
+		}
+
+		inputs[node] = hash;
+		key = HashMix(key, hash);
+	}
+}
+
+/**	The entry solved from exactly these inputs. Keys are only a quick filter,
+	every node's hash is compared before an entry is used.
+*/
+BlokLayoutHistory::Entry* BlokLayoutHistory::Find(uint64_t key, const std::vector<uint64_t>& inputs)
+{
+	for (size_t i = 0; i < fEntries.size(); i++)
+	{
+		Entry& entry = fEntries[i];
+
+		if (entry.key != key || entry.size != inputs.size())
+		{
+			continue;
+		}
+
+		bool isSame = true;
+		size_t node = 0;
+
+		for (size_t j = 0; isSame && j < entry.blocks.size(); j++)
+		{
+			const std::vector<uint64_t>& blockInputs = entry.blocks[j]->inputs;
+
+			isSame = std::equal(blockInputs.begin(), blockInputs.end(), inputs.begin() + node);
+			node += blockInputs.size();
+		}
+
+		if (isSame)
+		{
+			return &entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**	The block some entry already holds that's identical to this one, or this
+	one if there isn't any.
+@param block IN the block, moved from if it's kept.
+*/
+std::shared_ptr<const BlokLayoutHistory::Block> BlokLayoutHistory::Share(Block& block)
+{
+	auto range = fBlocks.equal_range(block.hash);
+
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		std::shared_ptr<const Block> shared = it->second.lock();
+
+		if (shared && *shared == block)
+		{
+			return shared;
+		}
+	}
+
+	std::shared_ptr<const Block> shared = std::make_shared<Block>(std::move(block));
+	fBlocks.insert(std::make_pair(shared->hash, std::weak_ptr<const Block>(shared)));
+	fBytes += shared->GetByteCount();
+
+	return shared;
+}
+
+/**	Drop the least recently used entries until the history fits. The newest
+	one always stays, even if it's bigger than fMaxBytes on its own.
+*/
+void BlokLayoutHistory::Trim()
+{
+	while (fEntries.size() > 1 && (fEntries.size() > kBlokHistoryMaxEntries || fBytes > fMaxBytes))
+	{
+		size_t oldest = 0;
+
+		for (size_t i = 1; i < fEntries.size(); i++)
+		{
+			if (fEntries[i].lastUsed < fEntries[oldest].lastUsed)
+			{
+				oldest = i;
+			}
+		}
+
+		fEntries.erase(fEntries.begin() + oldest);
+
+		// Blocks only that entry held are gone now
+		fBytes = 0;
+
+		for (auto it = fBlocks.begin(); it != fBlocks.end();)
+		{
+			std::shared_ptr<const Block> shared = it->second.lock();
+
+			if (shared)
+			{
+				fBytes += shared->GetByteCount();
+				++it;
+			}
+			else
+			{
+				it = fBlocks.erase(it);
+			}
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#ifndef __BlokHistory_h__
+#define __BlokHistory_h__
+
+#include "IllustratorSDK.h"
+#include "BlokSnapshot.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/** Most memory the history's blocks take up before the oldest solves are dropped */
+#define kBlokHistoryMaxBytes (16 * 1024 * 1024)
+
+/** Most solves the history remembers */
+#define kBlokHistoryMaxEntries 64
+
+/** Nodes per block, what solves share when only part of a tree changed */
+#define kBlokHistoryBlockSize 64
+
+/**	Remembers recent solves by what went into them, so a tree that comes back
+	to an earlier state isn't solved again. Undo and redo put art back exactly
+	as it was, so the next relayout captures the same tree it solved before
+	and gets that layout back instead.
+
+	Solves are keyed by their inputs, every node's style and the text of
+	measured ones, not by art or document. Illustrator's timestamps only move
+	forward, so a state undo brings back never matches its old one.
+
+	A solve is stored as blocks of kBlokHistoryBlockSize nodes. Blocks are
+	immutable and shared between every solve they're identical in, so the
+	history of a big tree where each edit touched a few Bloks costs little
+	more than one copy of it. Once blocks take more than maxBytes the least
+	recently used solves are dropped.
+
+	Only call from the main thread.
+*/
+class BlokLayoutHistory
+{
+public:
+	BlokLayoutHistory(size_t maxBytes = kBlokHistoryMaxBytes);
+
+	/**	Fill in a captured tree's layout from an earlier solve of the same inputs.
+	@param snapshot IN/OUT a captured snapshot, its layout is written on success.
+	@return true if it was found, false if the tree still has to be solved.
+	*/
+	bool Restore(BlokSnapshot& snapshot);
+
+	/**	Remember a solved tree.
+	@param snapshot IN a solved snapshot.
+	*/
+	void Store(const BlokSnapshot& snapshot);
+
+	/** Forget every solve */
+	void Clear();
+
+	/** Bytes the blocks take up, shared ones counted once */
+	size_t GetByteCount() const { return fBytes; }
+
+	size_t GetEntryCount() const { return fEntries.size(); }
+
+private:
+	/** kBlokHistoryBlockSize nodes of a solve, the last one of a tree can be shorter */
+	struct Block
+	{
+		/** Hash of each node's inputs */
+		std::vector<uint64_t> inputs;
+
+		/** Left, top, width, height and baseline of each node */
+		std::vector<double> layout;
+
+		/** Hash of all of the above, for sharing */
+		uint64_t hash;
+
+		size_t GetByteCount() const;
+		bool operator==(const Block& other) const;
+	};
+
+	struct Entry
+	{
+		/** Hash of every node's inputs */
+		uint64_t key;
+
+		size_t size;
+		std::vector<std::shared_ptr<const Block>> blocks;
+
+		/** When it was last stored or restored, the smallest is dropped first */
+		uint64_t lastUsed;
+	};
+
+	static void HashInputs(const BlokSnapshot& snapshot, std::vector<uint64_t>& inputs, uint64_t& key);
+	Entry* Find(uint64_t key, const std::vector<uint64_t>& inputs);
+	std::shared_ptr<const Block> Share(Block& block);
+	void Trim();
+
+	size_t fMaxBytes;
+	size_t fBytes;
+	uint64_t fClock;
+
+	std::vector<Entry> fEntries;
+
+	// Every block some entry still holds, by hash
+	std::unordered_multimap<uint64_t, std::weak_ptr<const Block>> fBlocks;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "IllustratorSDK.h"
+#include "BlokInvalidation.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+void BlokInvalidationQueue::Push(AIArtHandle art)
+{
+	AIArtHandle root = BlokGetRootContainer(art);
+
+	if (root && fQueued.insert(root).second)
+	{
+		fOrder.push_back(root);
+	}
+}
+
+void BlokInvalidationQueue::Take(std::vector<AIArtHandle>& roots)
+{
+	std::unordered_set<AIArtHandle> taken;
+	roots.clear();
+	roots.reserve(fOrder.size());
+
+	for (size_t i = 0; i < fOrder.size(); i++)
+	{
+		// Art can be deleted while it waits
+		if (!sAIArt->ValidArt(fOrder[i], true))
+		{
+			continue;
+		}
+
+		AIArtHandle root = BlokGetRootContainer(fOrder[i]);
+
+		if (root && taken.insert(root).second)
+		{
+			roots.push_back(root);
+		}
+	}
+
+	fQueued.clear();
+	fOrder.clear();
+}
@@ -0,0 +1,38 @@
+#ifndef __BlokInvalidation_h__
+#define __BlokInvalidation_h__
+
+#include "IllustratorSDK.h"
+
+#include <unordered_set>
+#include <vector>
+
+/**	Root BlokContainers waiting to be laid out once Illustrator lets us, like
+	after leaving Symbol Editing Mode. Each root is queued once no matter how
+	many of its Bloks were pushed, and comes back out in the order it was
+	first pushed.
+
+	Only call from the main thread.
+*/
+class BlokInvalidationQueue
+{
+public:
+	/**	Queue the root container of art.
+	@param art IN any art in a Blok tree. Art outside of one is ignored.
+	*/
+	void Push(AIArtHandle art);
+
+	/**	Take every queued root and empty the queue. Roots are looked up
+		again first, in case art was regrouped while it waited, so each one
+		is outermost and none is nested in another.
+	@param roots OUT valid roots, once each, in the order they were queued.
+	*/
+	void Take(std::vector<AIArtHandle>& roots);
+
+	bool IsEmpty() const { return fOrder.empty(); }
+
+private:
+	std::unordered_set<AIArtHandle> fQueued;
+	std::vector<AIArtHandle> fOrder;
+};
+
+#endif
@@ -0,0 +1,882 @@
+#include "BlokLayout.h"
+#include "BlokLayoutKernels.h"
+#include "BlokThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+static const double kUndefined = std::numeric_limits<double>::quiet_NaN();
+
+static inline bool IsDefined(double value)
+{
+	return !std::isnan(value);
+}
+
+void BlokLayoutTree::Clear()
+{
+	parent.clear();
+	firstChild.clear();
+	childCount.clear();
+
+	styleWidth.clear();
+	styleHeight.clear();
+	flex.clear();
+	alignSelf.clear();
+	flexDirection.clear();
+	justifyContent.clear();
+	alignItems.clear();
+	paddingTop.clear();
+	paddingRight.clear();
+	paddingBottom.clear();
+	paddingLeft.clear();
+	gap.clear();
+	isMeasured.clear();
+	styleBaseline.clear();
+
+	layoutLeft.clear();
+	layoutTop.clear();
+	layoutWidth.clear();
+	layoutHeight.clear();
+	layoutBaseline.clear();
+
+	cachedForcedWidth.clear();
+	cachedForcedHeight.clear();
+	cachedWidth.clear();
+	cachedHeight.clear();
+	cacheValid.clear();
+	subtreeSize.clear();
+	subtreeHash.clear();
+
+	cacheHits = 0;
+	cacheMisses = 0;
+	dedupHits = 0;
+	dedupNodes = 0;
+}
+
+size_t BlokLayoutTree::Append(size_t count)
+{
+	size_t first = Size();
+	size_t size = first + count;
+
+	parent.resize(size, -1);
+	firstChild.resize(size, 0);
+	childCount.resize(size, 0);
+
+	styleWidth.resize(size, kUndefined);
+	styleHeight.resize(size, kUndefined);
+	flex.resize(size, 0.0);
+	alignSelf.resize(size, kBlokAlignUnset);
+	flexDirection.resize(size, kBlokFlexDirectionRow);
+	justifyContent.resize(size, kBlokJustifyFlexStart);
+	alignItems.resize(size, kBlokAlignFlexStart);
+	paddingTop.resize(size, 0.0);
+	paddingRight.resize(size, 0.0);
+	paddingBottom.resize(size, 0.0);
+	paddingLeft.resize(size, 0.0);
+	gap.resize(size, 0.0);
+	isMeasured.resize(size, 0);
+	styleBaseline.resize(size, kUndefined);
+
+	layoutLeft.resize(size, 0.0);
+	layoutTop.resize(size, 0.0);
+	layoutWidth.resize(size, 0.0);
+	layoutHeight.resize(size, 0.0);
+	layoutBaseline.resize(size, kUndefined);
+
+	cachedForcedWidth.resize(size, kUndefined);
+	cachedForcedHeight.resize(size, kUndefined);
+	cachedWidth.resize(size, 0.0);
+	cachedHeight.resize(size, 0.0);
+	cacheValid.resize(size, 0);
+	subtreeSize.resize(size, 1);
+	subtreeHash.resize(size, 0);
+
+	return first;
+}
+
+void BlokLayoutTree::SetChildren(size_t node, size_t first, size_t count)
+{
+	firstChild[node] = first;
+	childCount[node] = count;
+
+	for (size_t i = first; i < first + count; i++)
+	{
+		parent[i] = (int)node;
+	}
+
+	MarkDirty(node);
+}
+
+void BlokLayoutTree::MarkDirty(size_t node)
+{
+	for (int i = (int)node; i >= 0 && (size_t)i < Size(); i = parent[i])
+	{
+		cacheValid[i] = 0;
+	}
+}
+
+void BlokLayoutTree::ClearCache()
+{
+	std::fill(cacheValid.begin(), cacheValid.end(), 0);
+}
+
+/** Equality for constraints, where NaN (undefined) matches NaN */
+static inline bool IsSameConstraint(double a, double b)
+{
+	return a == b || (!IsDefined(a) && !IsDefined(b));
+}
+
+/** Equality for style values, where NaN (undefined) matches NaN */
+static inline bool IsSameValue(double a, double b)
+{
+	return IsSameConstraint(a, b);
+}
+
+/**	Mix a value into a running 64 bit hash (FNV-1a a word at a time). It's
+	weak, but it only has to be quick, matches are always checked.
+*/
+static inline uint64_t HashMix(uint64_t hash, uint64_t value)
+{
+	return (hash ^ value) * 0x100000001b3ull;
+}
+
+static inline uint64_t HashMix(uint64_t hash, double value)
+{
+	uint64_t bits = 0;
+
+	if (IsDefined(value))
+	{
+		std::memcpy(&bits, &value, sizeof(bits));
+	}
+	else
+	{
+		// Every NaN is "undefined"
+		bits = 0x7ff8000000000000ull;
+	}
+
+	return HashMix(hash, bits);
+}
+
+/** The alignment that applies to a child, taking align-self over align-items */
+static inline int GetChildAlignment(const BlokLayoutTree& tree, size_t node, size_t child)
+{
+	return tree.alignSelf[child] != kBlokAlignUnset ? tree.alignSelf[child] : tree.alignItems[node];
+}
+
+/**	Axis traits. The solver is written once in terms of the main and cross axis
+	and Pick() maps that onto width/height, left/top etc. RowAxis and ColumnAxis
+	answer at compile time, so every container gets a copy of the solver with no
+	direction branches. RuntimeAxis answers per node, like blok-container.ts.
+*/
+struct RowAxis
+{
+	template <typename T>
+	T& Pick(T& row, T& /*column*/) const { return row; }
+};
+
+struct ColumnAxis
+{
+	template <typename T>
+	T& Pick(T& /*row*/, T& column) const { return column; }
+};
+
+struct RuntimeAxis
+{
+	bool isRow;
+
+	template <typename T>
+	T& Pick(T& row, T& column) const { return isRow ? row : column; }
+};
+
+/** Bits returned by GetChildFlags */
+#define kChildrenHaveFlex 1
+#define kChildrenHaveStretch 2
+
+/**	Child traits, saying which of the flex and stretch passes a container
+	needs. ChildTraits knows at compile time, so containers without flexible or
+	stretched children don't even test for them. RuntimeChildren always checks.
+*/
+template <bool kHasFlex, bool kHasStretch>
+struct ChildTraits
+{
+	bool HasFlex() const { return kHasFlex; }
+	bool HasStretch() const { return kHasStretch; }
+};
+
+struct RuntimeChildren
+{
+	bool HasFlex() const { return true; }
+	bool HasStretch() const { return true; }
+};
+
+/** Shared state for one call to BlokLayoutSolve */
+struct SolveContext
+{
+	BlokLayoutTree& tree;
+	const BlokLayoutKernels& kernels;
+	BlokThreadPool* pool;
+	size_t grainSize;
+	bool isSpecialized;
+
+	// False to lay out every node from scratch, without the cache or copies
+	bool canReuse;
+
+	// Subtrees can be solved on any thread
+	std::atomic<size_t> cacheHits;
+	std::atomic<size_t> cacheMisses;
+	std::atomic<size_t> dedupHits;
+	std::atomic<size_t> dedupNodes;
+
+	SolveContext(BlokLayoutTree& t, BlokThreadPool* p, size_t grain, bool specialized, bool reuse) :
+		tree(t),
+		kernels(BlokGetLayoutKernels()),
+		pool(p),
+		grainSize(grain),
+		isSpecialized(specialized),
+		canReuse(reuse),
+		cacheHits(0),
+		cacheMisses(0),
+		dedupHits(0),
+		dedupNodes(0)
+	{
+	}
+};
+
+/** A child to lay out, with the dims its container forces on it */
+struct ChildRequest
+{
+	size_t child;
+	double forcedWidth;
+	double forcedHeight;
+};
+
+static void LayoutNode(SolveContext& context, size_t node, double forcedWidth, double forcedHeight);
+
+/** True if node's last layout was for these constraints and nothing changed since */
+static inline bool IsCached(const BlokLayoutTree& tree, size_t node, double forcedWidth, double forcedHeight)
+{
+	return tree.cacheValid[node] &&
+		IsSameConstraint(tree.cachedForcedWidth[node], forcedWidth) &&
+		IsSameConstraint(tree.cachedForcedHeight[node], forcedHeight);
+}
+
+/**	Style of a node that its own subtree's layout depends on. A node's flex
+	and align-self only matter to its parent, so they're left out.
+*/
+static uint64_t HashNode(const BlokLayoutTree& tree, size_t node)
+{
+	uint64_t hash = HashMix(0xcbf29ce484222325ull, (uint64_t)tree.childCount[node]);
+	hash = HashMix(hash, tree.styleWidth[node]);
+	hash = HashMix(hash, tree.styleHeight[node]);
+	hash = HashMix(hash, (uint64_t)tree.flexDirection[node]);
+	hash = HashMix(hash, (uint64_t)tree.justifyContent[node]);
+	hash = HashMix(hash, (uint64_t)tree.alignItems[node]);
+	hash = HashMix(hash, tree.paddingTop[node]);
+	hash = HashMix(hash, tree.paddingRight[node]);
+	hash = HashMix(hash, tree.paddingBottom[node]);
+	hash = HashMix(hash, tree.paddingLeft[node]);
+	hash = HashMix(hash, tree.gap[node]);
+	hash = HashMix(hash, (uint64_t)tree.isMeasured[node]);
+	hash = HashMix(hash, tree.styleBaseline[node]);
+
+	return hash;
+}
+
+/**	The same comparison HashNode hashes. Measured leaves size themselves from
+	content the tree knows nothing about, so they never match.
+*/
+static bool IsSameNode(const BlokLayoutTree& tree, size_t a, size_t b)
+{
+	return !tree.isMeasured[a] && !tree.isMeasured[b] &&
+		tree.childCount[a] == tree.childCount[b] &&
+		IsSameValue(tree.styleWidth[a], tree.styleWidth[b]) &&
+		IsSameValue(tree.styleHeight[a], tree.styleHeight[b]) &&
+		tree.flexDirection[a] == tree.flexDirection[b] &&
+		tree.justifyContent[a] == tree.justifyContent[b] &&
+		tree.alignItems[a] == tree.alignItems[b] &&
+		tree.paddingTop[a] == tree.paddingTop[b] &&
+		tree.paddingRight[a] == tree.paddingRight[b] &&
+		tree.paddingBottom[a] == tree.paddingBottom[b] &&
+		tree.paddingLeft[a] == tree.paddingLeft[b] &&
+		tree.gap[a] == tree.gap[b] &&
+		IsSameValue(tree.styleBaseline[a], tree.styleBaseline[b]);
+}
+
+/**	True if two subtrees would lay out the same way given the same constraints.
+	Equal hashes nearly always mean yes, this makes sure.
+*/
+static bool IsSameSubtree(const BlokLayoutTree& tree, size_t a, size_t b)
+{
+	if (!IsSameNode(tree, a, b))
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < tree.childCount[a]; i++)
+	{
+		size_t childA = tree.firstChild[a] + i;
+		size_t childB = tree.firstChild[b] + i;
+
+		if (tree.flex[childA] != tree.flex[childB] ||
+			tree.alignSelf[childA] != tree.alignSelf[childB] ||
+			!IsSameSubtree(tree, childA, childB))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**	Give target the layout source's subtree already has. Positions are
+	relative to the parent, so they copy over as they are, and the target's
+	own position is left for its parent to set.
+@return number of nodes copied.
+*/
+static size_t CopySubtreeLayout(BlokLayoutTree& tree, size_t source, size_t target)
+{
+	tree.layoutWidth[target] = tree.layoutWidth[source];
+	tree.layoutHeight[target] = tree.layoutHeight[source];
+	tree.layoutBaseline[target] = tree.layoutBaseline[source];
+
+	// Target is now in the same state as if it had been solved
+	tree.cachedForcedWidth[target] = tree.cachedForcedWidth[source];
+	tree.cachedForcedHeight[target] = tree.cachedForcedHeight[source];
+	tree.cachedWidth[target] = tree.cachedWidth[source];
+	tree.cachedHeight[target] = tree.cachedHeight[source];
+	tree.cacheValid[target] = tree.cacheValid[source];
+
+	size_t copied = 1;
+
+	for (size_t i = 0; i < tree.childCount[source]; i++)
+	{
+		size_t sourceChild = tree.firstChild[source] + i;
+		size_t targetChild = tree.firstChild[target] + i;
+
+		tree.layoutLeft[targetChild] = tree.layoutLeft[sourceChild];
+		tree.layoutTop[targetChild] = tree.layoutTop[sourceChild];
+
+		copied += CopySubtreeLayout(tree, sourceChild, targetChild);
+	}
+
+	return copied;
+}
+
+/** Number of earlier siblings LayoutChildren compares a subtree against */
+#define kDedupWindow 4
+
+/**	Look for an earlier request that lays out exactly like request.
+@param tree IN tree being solved.
+@param requests IN all of the siblings being laid out.
+@param recent IN indices into requests to compare against.
+@param recentCount IN number of entries in recent.
+@param request IN request to find a match for.
+@return the child to copy from, or request.child if there isn't one.
+*/
+static size_t FindSameRequest(const BlokLayoutTree& tree, const std::vector<ChildRequest>& requests,
+	const size_t* recent, size_t recentCount, const ChildRequest& request)
+{
+	for (size_t i = 0; i < recentCount; i++)
+	{
+		const ChildRequest& other = requests[recent[i]];
+
+		if (tree.subtreeHash[other.child] == tree.subtreeHash[request.child] &&
+			IsSameConstraint(other.forcedWidth, request.forcedWidth) &&
+			IsSameConstraint(other.forcedHeight, request.forcedHeight) &&
+			IsSameSubtree(tree, other.child, request.child))
+		{
+			return other.child;
+		}
+	}
+
+	return request.child;
+}
+
+/**	Lay out a set of siblings. Siblings never read each other's results, so any
+	big enough subtree is handed to the pool while the small ones run here.
+
+	Repeated rows and cards are common, so a sibling that is structurally the
+	same as one of the last few solved and gets the same constraints isn't
+	solved, it gets a copy of that one's layout.
+@param context IN/OUT solve in progress.
+@param requests IN children to lay out.
+*/
+static void LayoutChildren(SolveContext& context, const std::vector<ChildRequest>& requests)
+{
+	BlokLayoutTree& tree = context.tree;
+	BlokTaskGroup group;
+	bool isSpawned = false;
+
+	// The last few distinct subtrees that were solved, to copy from
+	size_t recent[kDedupWindow];
+	size_t recentCount = 0;
+
+	// Requests to fill from the one that was solved
+	std::vector<std::pair<size_t, size_t>> copies;
+
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		const ChildRequest& request = requests[i];
+
+		// Leaves aren't worth it, and a cache hit is cheaper than a copy
+		if (context.canReuse &&
+			tree.childCount[request.child] > 0 &&
+			!IsCached(tree, request.child, request.forcedWidth, request.forcedHeight))
+		{
+			size_t source = FindSameRequest(tree, requests, recent, std::min(recentCount, (size_t)kDedupWindow), request);
+
+			if (source != request.child)
+			{
+				copies.push_back(std::make_pair(source, request.child));
+				continue;
+			}
+
+			recent[recentCount++ % kDedupWindow] = i;
+		}
+
+		if (context.pool && tree.subtreeSize[request.child] >= context.grainSize)
+		{
+			SolveContext* shared = &context;
+
+			context.pool->Spawn(group, [shared, request]
+			{
+				LayoutNode(*shared, request.child, request.forcedWidth, request.forcedHeight);
+			});
+
+			isSpawned = true;
+		}
+		else
+		{
+			LayoutNode(context, request.child, request.forcedWidth, request.forcedHeight);
+		}
+	}
+
+	if (isSpawned)
+	{
+		context.pool->Wait(group);
+	}
+
+	for (size_t i = 0; i < copies.size(); i++)
+	{
+		size_t copied = CopySubtreeLayout(tree, copies[i].first, copies[i].second);
+
+		context.dedupHits.fetch_add(1, std::memory_order_relaxed);
+		context.dedupNodes.fetch_add(copied, std::memory_order_relaxed);
+	}
+}
+
+/** Distance from the top of a laid out node to its first baseline */
+static inline double GetBaseline(const BlokLayoutTree& tree, size_t node)
+{
+	return IsDefined(tree.layoutBaseline[node]) ? tree.layoutBaseline[node] : tree.layoutHeight[node];
+}
+
+/** True if a child is stretched across the container's cross axis */
+template <class Axis, class Children>
+static inline bool IsChildStretched(const BlokLayoutTree& tree, size_t node, size_t child,
+	const Axis& axis, const Children& children)
+{
+	return children.HasStretch() &&
+		GetChildAlignment(tree, node, child) == kBlokAlignStretch &&
+		!IsDefined(axis.Pick(tree.styleHeight, tree.styleWidth)[child]);
+}
+
+/**	Lay out a single node and its subtree.
+@param context IN/OUT solve in progress.
+@param node IN index of the node.
+@param forcedWidth IN width the parent requires (stretch/flex), or NaN.
+@param forcedHeight IN height the parent requires (stretch/flex), or NaN.
+@param axis IN the node's flex-direction.
+@param children IN which passes the node's children need.
+*/
+template <class Axis, class Children>
+static void LayoutContainer(SolveContext& context, size_t node, double forcedWidth, double forcedHeight,
+	const Axis& axis, const Children& children)
+{
+	BlokLayoutTree& tree = context.tree;
+	const BlokLayoutKernels& kernels = context.kernels;
+
+	double width = IsDefined(forcedWidth) ? forcedWidth : tree.styleWidth[node];
+	double height = IsDefined(forcedHeight) ? forcedHeight : tree.styleHeight[node];
+
+	// Everything below is written in terms of the main and cross axis
+	std::vector<double>& childMain = axis.Pick(tree.layoutWidth, tree.layoutHeight);
+	std::vector<double>& childCross = axis.Pick(tree.layoutHeight, tree.layoutWidth);
+	std::vector<double>& childMainPos = axis.Pick(tree.layoutLeft, tree.layoutTop);
+	std::vector<double>& childCrossPos = axis.Pick(tree.layoutTop, tree.layoutLeft);
+	const std::vector<double>& childPaddingMainLeading = axis.Pick(tree.paddingLeft, tree.paddingTop);
+	const std::vector<double>& childPaddingMainTrailing = axis.Pick(tree.paddingRight, tree.paddingBottom);
+	const std::vector<double>& childPaddingCrossLeading = axis.Pick(tree.paddingTop, tree.paddingLeft);
+	const std::vector<double>& childPaddingCrossTrailing = axis.Pick(tree.paddingBottom, tree.paddingRight);
+
+	double paddingMainLeading = childPaddingMainLeading[node];
+	double paddingMain = paddingMainLeading + childPaddingMainTrailing[node];
+	double paddingCrossLeading = childPaddingCrossLeading[node];
+	double paddingCross = paddingCrossLeading + childPaddingCrossTrailing[node];
+
+	double mainSize = axis.Pick(width, height);
+	double crossSize = axis.Pick(height, width);
+	double innerCross = IsDefined(crossSize) ? std::max(crossSize - paddingCross, 0.0) : kUndefined;
+
+	size_t first = tree.firstChild[node];
+	size_t last = first + tree.childCount[node];
+	size_t count = last - first;
+	double gaps = count > 1 ? tree.gap[node] * (double)(count - 1) : 0.0;
+
+	// Flexible children are only sized separately if we have a main size
+	bool isFlexing = children.HasFlex() && IsDefined(mainSize);
+
+	// Baselines only line up across a row
+	bool isRowValue = true;
+	bool isColumnValue = false;
+	bool isRow = axis.Pick(isRowValue, isColumnValue);
+	bool hasBaseline = false;
+
+	// Pass 1: size every child that isn't flexible at its natural main size
+	double fixedMain = 0.0;
+	double totalFlex = 0.0;
+	std::vector<ChildRequest> requests;
+	requests.reserve(count);
+
+	for (size_t child = first; child < last; child++)
+	{
+		double forcedMain = kUndefined;
+		double forcedCross = kUndefined;
+
+		hasBaseline = hasBaseline || (isRow && GetChildAlignment(tree, node, child) == kBlokAlignBaseline);
+
+		if (IsChildStretched(tree, node, child, axis, children) && IsDefined(innerCross))
+		{
+			forcedCross = innerCross;
+		}
+
+		if (isFlexing && tree.flex[child] > 0.0)
+		{
+			// Sized in pass 2, once we know what's left over
+			totalFlex += tree.flex[child];
+			childCross[child] = forcedCross;
+			continue;
+		}
+
+		ChildRequest request = { child, axis.Pick(forcedMain, forcedCross), axis.Pick(forcedCross, forcedMain) };
+		requests.push_back(request);
+	}
+
+	LayoutChildren(context, requests);
+
+	fixedMain = isFlexing ?
+		kernels.SumInflexible(childMain.data() + first, tree.flex.data() + first, count) :
+		kernels.Sum(childMain.data() + first, count);
+
+	double remaining = IsDefined(mainSize) ? mainSize - paddingMain - gaps - fixedMain : 0.0;
+
+	// Pass 2: distribute what's left to flexible children by weight
+	if (totalFlex > 0.0)
+	{
+		double perFlex = std::max(remaining, 0.0) / totalFlex;
+
+		// Every child's share plus its own padding, the inflexible ones are ignored
+		std::vector<double> forcedMains(count);
+		kernels.DistributeFlex(
+			tree.flex.data() + first,
+			childPaddingMainLeading.data() + first,
+			childPaddingMainTrailing.data() + first,
+			perFlex,
+			forcedMains.data(),
+			count);
+
+		requests.clear();
+
+		for (size_t child = first; child < last; child++)
+		{
+			if (tree.flex[child] > 0.0)
+			{
+				double forcedMain = forcedMains[child - first];
+				double forcedCross = childCross[child];
+
+				ChildRequest request = { child, axis.Pick(forcedMain, forcedCross), axis.Pick(forcedCross, forcedMain) };
+				requests.push_back(request);
+			}
+		}
+
+		LayoutChildren(context, requests);
+
+		remaining = 0.0;
+	}
+
+	// Size ourselves from our children if the style didn't
+	if (!IsDefined(mainSize))
+	{
+		mainSize = paddingMain + gaps + kernels.Sum(childMain.data() + first, count);
+	}
+
+	// Children aligned to their baselines hang from the lowest one, which can
+	// push the bottom of the row further down than the tallest child
+	double maxBaseline = 0.0;
+	double baselineCross = 0.0;
+
+	if (hasBaseline)
+	{
+		for (size_t child = first; child < last; child++)
+		{
+			if (GetChildAlignment(tree, node, child) == kBlokAlignBaseline)
+			{
+				maxBaseline = std::max(maxBaseline, GetBaseline(tree, child));
+			}
+		}
+
+		for (size_t child = first; child < last; child++)
+		{
+			if (GetChildAlignment(tree, node, child) == kBlokAlignBaseline)
+			{
+				baselineCross = std::max(baselineCross, maxBaseline - GetBaseline(tree, child) + childCross[child]);
+			}
+		}
+	}
+
+	if (!IsDefined(crossSize))
+	{
+		double maxCross = std::max(kernels.Max(childCross.data() + first, count), baselineCross);
+
+		crossSize = maxCross + paddingCross;
+		innerCross = maxCross;
+
+		// Now that there is a cross size, stretch children that asked for it
+		if (children.HasStretch())
+		{
+			requests.clear();
+
+			for (size_t child = first; child < last; child++)
+			{
+				if (IsChildStretched(tree, node, child, axis, children) && childCross[child] != innerCross)
+				{
+					double forcedMain = totalFlex > 0.0 && tree.flex[child] > 0.0 ? childMain[child] : kUndefined;
+
+					ChildRequest request = { child, axis.Pick(forcedMain, innerCross), axis.Pick(innerCross, forcedMain) };
+					requests.push_back(request);
+				}
+			}
+
+			LayoutChildren(context, requests);
+		}
+	}
+
+	// Position along the main axis
+	double between = tree.gap[node];
+
+	if (tree.justifyContent[node] == kBlokJustifySpaceBetween && count > 1)
+	{
+		between += std::max(remaining, 0.0) / (double)(count - 1);
+	}
+
+	kernels.Positions(childMain.data() + first, paddingMainLeading, between, childMainPos.data() + first, count);
+
+	// Position along the cross axis
+	for (size_t child = first; child < last; child++)
+	{
+		double offset = 0.0;
+
+		switch (GetChildAlignment(tree, node, child))
+		{
+		case kBlokAlignCenter:
+			offset = (innerCross - childCross[child]) / 2.0;
+			break;
+		case kBlokAlignFlexEnd:
+			offset = innerCross - childCross[child];
+			break;
+		case kBlokAlignBaseline:
+			offset = isRow ? maxBaseline - GetBaseline(tree, child) : 0.0;
+			break;
+		default:
+			break;
+		}
+
+		childCrossPos[child] = paddingCrossLeading + offset;
+	}
+
+	tree.layoutWidth[node] = axis.Pick(mainSize, crossSize);
+	tree.layoutHeight[node] = axis.Pick(crossSize, mainSize);
+	tree.layoutBaseline[node] = count > 0 ? tree.layoutTop[first] + GetBaseline(tree, first) : tree.styleBaseline[node];
+}
+
+/**	Lay out a leaf that measures itself. Dims forced on it or set by its
+	style win, measure() only fills in the ones that are left undefined.
+*/
+static void LayoutMeasured(BlokLayoutTree& tree, size_t node, double forcedWidth, double forcedHeight)
+{
+	double width = IsDefined(forcedWidth) ? forcedWidth : tree.styleWidth[node];
+	double height = IsDefined(forcedHeight) ? forcedHeight : tree.styleHeight[node];
+
+	if (!IsDefined(width) || !IsDefined(height))
+	{
+		double measuredWidth = 0.0;
+		double measuredHeight = 0.0;
+
+		tree.measure(tree.measureContext, node, width, measuredWidth, measuredHeight);
+
+		width = IsDefined(width) ? width : measuredWidth;
+		height = IsDefined(height) ? height : measuredHeight;
+	}
+
+	tree.layoutWidth[node] = width;
+	tree.layoutHeight[node] = height;
+	tree.layoutBaseline[node] = tree.styleBaseline[node];
+}
+
+typedef void (*SpecializedLayout)(SolveContext& context, size_t node, double forcedWidth, double forcedHeight);
+
+template <class Axis, bool kHasFlex, bool kHasStretch>
+static void LayoutSpecialized(SolveContext& context, size_t node, double forcedWidth, double forcedHeight)
+{
+	LayoutContainer(context, node, forcedWidth, forcedHeight, Axis(), ChildTraits<kHasFlex, kHasStretch>());
+}
+
+/** Every instantiation of the solver, indexed by kChildrenHave* bits */
+static const SpecializedLayout kRowLayouts[] =
+{
+	LayoutSpecialized<RowAxis, false, false>,
+	LayoutSpecialized<RowAxis, true, false>,
+	LayoutSpecialized<RowAxis, false, true>,
+	LayoutSpecialized<RowAxis, true, true>
+};
+
+static const SpecializedLayout kColumnLayouts[] =
+{
+	LayoutSpecialized<ColumnAxis, false, false>,
+	LayoutSpecialized<ColumnAxis, true, false>,
+	LayoutSpecialized<ColumnAxis, false, true>,
+	LayoutSpecialized<ColumnAxis, true, true>
+};
+
+/** The kChildrenHave* bits for a node's children */
+static inline int GetChildFlags(const BlokLayoutTree& tree, size_t node)
+{
+	int flags = 0;
+	size_t first = tree.firstChild[node];
+	size_t last = first + tree.childCount[node];
+
+	for (size_t child = first; child < last; child++)
+	{
+		flags |= tree.flex[child] > 0.0 ? kChildrenHaveFlex : 0;
+		flags |= GetChildAlignment(tree, node, child) == kBlokAlignStretch ? kChildrenHaveStretch : 0;
+	}
+
+	return flags;
+}
+
+static void LayoutNode(SolveContext& context, size_t node, double forcedWidth, double forcedHeight)
+{
+	BlokLayoutTree& tree = context.tree;
+
+	if (context.canReuse && IsCached(tree, node, forcedWidth, forcedHeight))
+	{
+		// Our parent may have scribbled on our size while deciding what to ask
+		tree.layoutWidth[node] = tree.cachedWidth[node];
+		tree.layoutHeight[node] = tree.cachedHeight[node];
+
+		context.cacheHits.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	context.cacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+	bool isRow = tree.flexDirection[node] == kBlokFlexDirectionRow;
+
+	if (tree.isMeasured[node] && tree.measure && tree.childCount[node] == 0)
+	{
+		LayoutMeasured(tree, node, forcedWidth, forcedHeight);
+	}
+	else if (context.isSpecialized)
+	{
+		// The only direction branch a node pays for
+		const SpecializedLayout* layouts = isRow ? kRowLayouts : kColumnLayouts;
+		layouts[GetChildFlags(tree, node)](context, node, forcedWidth, forcedHeight);
+	}
+	else
+	{
+		RuntimeAxis axis = { isRow };
+		LayoutContainer(context, node, forcedWidth, forcedHeight, axis, RuntimeChildren());
+	}
+
+	tree.cachedForcedWidth[node] = forcedWidth;
+	tree.cachedForcedHeight[node] = forcedHeight;
+	tree.cachedWidth[node] = tree.layoutWidth[node];
+	tree.cachedHeight[node] = tree.layoutHeight[node];
+	tree.cacheValid[node] = 1;
+}
+
+/** Shared by BlokLayoutSolve, BlokLayoutSolveRuntime and BlokLayoutSolveReference */
+static void Solve(BlokLayoutTree& tree, BlokThreadPool* pool, size_t grainSize, bool isSpecialized, bool canReuse)
+{
+	if (tree.Size() == 0)
+	{
+		return;
+	}
+
+	if (canReuse && IsCached(tree, 0, kUndefined, kUndefined))
+	{
+		// Nothing changed since the last solve
+		tree.cacheHits = 1;
+		tree.cacheMisses = 0;
+		tree.dedupHits = 0;
+		tree.dedupNodes = 0;
+		return;
+	}
+
+	SolveContext context(tree, pool, grainSize, isSpecialized, canReuse);
+
+	// Descendants always come after their ancestors, so one backwards sweep
+	// sees every child before its parent. A clean node's subtree hasn't
+	// changed since its hash was last computed.
+	for (size_t i = tree.Size(); i-- > 0;)
+	{
+		if (tree.cacheValid[i])
+		{
+			continue;
+		}
+
+		uint64_t hash = HashNode(tree, i);
+		size_t size = 1;
+
+		for (size_t child = tree.firstChild[i]; child < tree.firstChild[i] + tree.childCount[i]; child++)
+		{
+			hash = HashMix(hash, tree.subtreeHash[child]);
+			hash = HashMix(hash, tree.flex[child]);
+			hash = HashMix(hash, (uint64_t)(int64_t)tree.alignSelf[child]);
+
+			size += tree.subtreeSize[child];
+		}
+
+		tree.subtreeHash[i] = hash;
+		tree.subtreeSize[i] = size;
+	}
+
+	tree.layoutLeft[0] = 0.0;
+	tree.layoutTop[0] = 0.0;
+
+	LayoutNode(context, 0, kUndefined, kUndefined);
+
+	tree.cacheHits = context.cacheHits.load();
+	tree.cacheMisses = context.cacheMisses.load();
+	tree.dedupHits = context.dedupHits.load();
+	tree.dedupNodes = context.dedupNodes.load();
+}
+
+void BlokLayoutSolve(BlokLayoutTree& tree, BlokThreadPool* pool, size_t grainSize)
+{
+	Solve(tree, pool, grainSize, true, true);
+}
+
+void BlokLayoutSolveRuntime(BlokLayoutTree& tree, BlokThreadPool* pool, size_t grainSize)
+{
+	Solve(tree, pool, grainSize, false, true);
+}
+
+void BlokLayoutSolveReference(BlokLayoutTree& tree)
+{
+	Solve(tree, NULL, kBlokLayoutGrainSize, true, false);
+}
@@ -0,0 +1,193 @@
+#ifndef __BlokLayout_h__
+#define __BlokLayout_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Note: nothing in this file may call into Illustrator. Trees are solved on
+// worker threads, which have no AppContext.
+
+/** Mirrors Css.FlexDirections in css.ts */
+enum BlokFlexDirection
+{
+	kBlokFlexDirectionRow = 0,
+	kBlokFlexDirectionColumn = 1
+};
+
+/** Mirrors Css.Justifications in css.ts */
+enum BlokJustification
+{
+	kBlokJustifyFlexStart = 0,
+	kBlokJustifySpaceBetween = 1
+};
+
+/** Mirrors Css.Alignments in css.ts. kBlokAlignUnset is used for a Blok without an align-self */
+enum BlokAlignment
+{
+	kBlokAlignUnset = -1,
+	kBlokAlignFlexStart = 0,
+	kBlokAlignCenter = 1,
+	kBlokAlignFlexEnd = 2,
+	kBlokAlignStretch = 3,
+	kBlokAlignBaseline = 4
+};
+
+/**	Measures a leaf whose size comes from its content instead of its style,
+	like area text whose height follows its width.
+@param context IN BlokLayoutTree::measureContext.
+@param node IN index of the leaf.
+@param width IN width the leaf has to fit in, or NaN for its natural width.
+@param measuredWidth OUT width the content needs.
+@param measuredHeight OUT height the content needs at that width.
+*/
+typedef void (*BlokMeasureFunc)(void* context, size_t node, double width, double& measuredWidth, double& measuredHeight);
+
+/**	A flattened Blok tree, stored as a struct of arrays. Index 0 is the root.
+	The children of a node always occupy a contiguous range of indices starting
+	at firstChild, ordered from low z-index to high z-index (the same order
+	BlokContainer.getChildren() returns). Children are always appended after
+	their parent, so every descendant of a node has a higher index than it.
+
+	Style arrays are the input and mirror what BlokContainer.computeCssNode()
+	hands to css-layout. A NaN width or height means "undefined". The layout
+	arrays are the output, with left/top relative to the parent node.
+
+	Every node remembers the width/height it was last forced to (NaN when it
+	was free to size itself) and the size that produced. Asked for the same
+	again, it answers from the cache without touching its subtree, which is
+	still laid out from last time. Call MarkDirty() after changing a node's
+	style so it and its ancestors are measured again.
+
+	Leaves with isMeasured set and an undefined width or height get it from
+	measure(), called on whichever thread solves the leaf.
+
+	Baseline alignment only applies in rows, in columns it's flex-start. A
+	leaf's first baseline is styleBaseline below its top, or its bottom edge
+	when that's NaN. A container's is its first child's.
+
+	A container's gap is the space between each pair of its children along the
+	main axis. space-between spreads what's left over on top of it.
+*/
+struct BlokLayoutTree
+{
+	BlokLayoutTree() : measure(NULL), measureContext(NULL), cacheHits(0), cacheMisses(0), dedupHits(0), dedupNodes(0) {}
+
+	// Structure
+	std::vector<int> parent;
+	std::vector<size_t> firstChild;
+	std::vector<size_t> childCount;
+
+	// Style
+	std::vector<double> styleWidth;
+	std::vector<double> styleHeight;
+	std::vector<double> flex;
+	std::vector<int> alignSelf;
+	std::vector<int> flexDirection;
+	std::vector<int> justifyContent;
+	std::vector<int> alignItems;
+	std::vector<double> paddingTop;
+	std::vector<double> paddingRight;
+	std::vector<double> paddingBottom;
+	std::vector<double> paddingLeft;
+	std::vector<double> gap;
+	std::vector<char> isMeasured;
+	std::vector<double> styleBaseline;
+
+	/** Sizes leaves with isMeasured set, NULL to leave them at their style dims */
+	BlokMeasureFunc measure;
+	void* measureContext;
+
+	// Layout
+	std::vector<double> layoutLeft;
+	std::vector<double> layoutTop;
+	std::vector<double> layoutWidth;
+	std::vector<double> layoutHeight;
+	std::vector<double> layoutBaseline;
+
+	// Measure cache
+	std::vector<double> cachedForcedWidth;
+	std::vector<double> cachedForcedHeight;
+	std::vector<double> cachedWidth;
+	std::vector<double> cachedHeight;
+	std::vector<char> cacheValid;
+
+	// Number of nodes under each node (itself included) and a hash of
+	// everything that decides how that subtree lays itself out. Brought up
+	// to date for every dirty node at the start of a solve.
+	std::vector<size_t> subtreeSize;
+	std::vector<uint64_t> subtreeHash;
+
+	/** Nodes answered from the cache and nodes laid out during the last solve */
+	size_t cacheHits;
+	size_t cacheMisses;
+
+	/** Subtrees that copied an identical sibling's layout during the last solve, and their nodes */
+	size_t dedupHits;
+	size_t dedupNodes;
+
+	/** Number of nodes in the tree */
+	size_t Size() const { return parent.size(); }
+
+	/** Remove all nodes */
+	void Clear();
+
+	/**	Append count default nodes (undefined dims, no flex, row, flex-start).
+	@param count IN number of nodes to add.
+	@return index of the first new node.
+	*/
+	size_t Append(size_t count);
+
+	/**	Make the range [first, first + count) the children of node.
+	@param node IN index of the parent.
+	@param first IN index of the first child, as returned by Append.
+	@param count IN number of children.
+	*/
+	void SetChildren(size_t node, size_t first, size_t count);
+
+	/**	Throw away the cached layout of node and all of its ancestors.
+	@param node IN index of the node whose style changed.
+	*/
+	void MarkDirty(size_t node);
+
+	/** Throw away every cached layout, the next solve starts from scratch */
+	void ClearCache();
+};
+
+class BlokThreadPool;
+
+/** Smallest subtree, in nodes, that BlokLayoutSolve will hand to another thread */
+#define kBlokLayoutGrainSize 64
+
+/**	Compute layout for the whole tree, matching what css-layout produces for the
+	subset of flexbox that Bloks supports. Safe to call from any thread as long as
+	no other thread touches the same tree.
+
+	With a pool, sibling subtrees of at least grainSize nodes are solved as
+	separate tasks. The result is identical to a serial solve. Subtrees that
+	are clean and asked for the same constraints as last time are skipped, see
+	BlokLayoutTree::MarkDirty(). Siblings with the same structure and
+	constraints are solved once and the rest copy that layout.
+
+	If the tree's measure function can only be called from one thread, solve
+	it without a pool.
+@param tree IN/OUT tree to solve. Only the layout arrays are written.
+@param pool IN workers to split large subtrees across, NULL to solve serially.
+@param grainSize IN subtrees smaller than this stay on the current thread.
+*/
+void BlokLayoutSolve(BlokLayoutTree& tree, BlokThreadPool* pool = NULL, size_t grainSize = kBlokLayoutGrainSize);
+
+/**	Same as BlokLayoutSolve(), but through a single copy of the solver that
+	branches on flex-direction, flex and stretch at every node the way
+	blok-container.ts does. Only kept so the benchmark can compare the two.
+*/
+void BlokLayoutSolveRuntime(BlokLayoutTree& tree, BlokThreadPool* pool = NULL, size_t grainSize = kBlokLayoutGrainSize);
+
+/**	Same as BlokLayoutSolve(), but serially and without the measure cache or
+	copying identical siblings. Every node is laid out from scratch, so it's
+	what BlokLayoutSolve() has to match, see BlokEngine::CheckRoots().
+@param tree IN/OUT tree to solve. The cache is written but never read.
+*/
+void BlokLayoutSolveReference(BlokLayoutTree& tree);
+
+#endif
@@ -0,0 +1,372 @@
+#include "BlokLayoutKernels.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define BLOK_KERNELS_X86 1
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+// GCC and clang only allow AVX2 intrinsics in functions built for it, MSVC allows them anywhere
+#if defined(BLOK_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+	#define BLOK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define BLOK_TARGET_AVX2
+#endif
+
+// Scalar
+
+static double SumScalar(const double* values, size_t count)
+{
+	double sum = 0.0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		sum += values[i];
+	}
+
+	return sum;
+}
+
+static double SumInflexibleScalar(const double* values, const double* flex, size_t count)
+{
+	double sum = 0.0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!(flex[i] > 0.0))
+		{
+			sum += values[i];
+		}
+	}
+
+	return sum;
+}
+
+static double MaxScalar(const double* values, size_t count)
+{
+	double max = 0.0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		max = std::max(max, values[i]);
+	}
+
+	return max;
+}
+
+static void DistributeFlexScalar(const double* flex, const double* paddingLeading, const double* paddingTrailing,
+	double perFlex, double* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = perFlex * flex[i] + (paddingLeading[i] + paddingTrailing[i]);
+	}
+}
+
+static void PositionsScalar(const double* sizes, double start, double between, double* positions, size_t count)
+{
+	double position = start;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		positions[i] = position;
+		position += sizes[i] + between;
+	}
+}
+
+#if defined(BLOK_KERNELS_X86)
+
+// SSE2, two doubles at a time. Always there on x64
+
+static double HorizontalSum(__m128d v)
+{
+	return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double SumSSE2(const double* values, size_t count)
+{
+	__m128d sum = _mm_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		sum = _mm_add_pd(sum, _mm_loadu_pd(values + i));
+	}
+
+	return HorizontalSum(sum) + SumScalar(values + i, count - i);
+}
+
+static double SumInflexibleSSE2(const double* values, const double* flex, size_t count)
+{
+	__m128d sum = _mm_setzero_pd();
+	__m128d zero = _mm_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d isFlexible = _mm_cmpgt_pd(_mm_loadu_pd(flex + i), zero);
+		sum = _mm_add_pd(sum, _mm_andnot_pd(isFlexible, _mm_loadu_pd(values + i)));
+	}
+
+	return HorizontalSum(sum) + SumInflexibleScalar(values + i, flex + i, count - i);
+}
+
+static double MaxSSE2(const double* values, size_t count)
+{
+	__m128d max = _mm_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		// maxpd returns the second operand when either is NaN, which keeps max
+		max = _mm_max_pd(_mm_loadu_pd(values + i), max);
+	}
+
+	double result = std::max(_mm_cvtsd_f64(max), _mm_cvtsd_f64(_mm_unpackhi_pd(max, max)));
+
+	return std::max(result, MaxScalar(values + i, count - i));
+}
+
+static void DistributeFlexSSE2(const double* flex, const double* paddingLeading, const double* paddingTrailing,
+	double perFlex, double* out, size_t count)
+{
+	__m128d scale = _mm_set1_pd(perFlex);
+	size_t i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d padding = _mm_add_pd(_mm_loadu_pd(paddingLeading + i), _mm_loadu_pd(paddingTrailing + i));
+		_mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(scale, _mm_loadu_pd(flex + i)), padding));
+	}
+
+	DistributeFlexScalar(flex + i, paddingLeading + i, paddingTrailing + i, perFlex, out + i, count - i);
+}
+
+static void PositionsSSE2(const double* sizes, double start, double between, double* positions, size_t count)
+{
+	__m128d gap = _mm_set1_pd(between);
+	__m128d zero = _mm_setzero_pd();
+	__m128d carry = _mm_set1_pd(start);
+	size_t i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d step = _mm_add_pd(_mm_loadu_pd(sizes + i), gap); // [a, b]
+		__m128d shifted = _mm_unpacklo_pd(zero, step); // [0, a]
+
+		_mm_storeu_pd(positions + i, _mm_add_pd(carry, shifted));
+
+		__m128d inclusive = _mm_add_pd(step, shifted); // [a, a + b]
+		carry = _mm_add_pd(carry, _mm_unpackhi_pd(inclusive, inclusive));
+	}
+
+	PositionsScalar(sizes + i, _mm_cvtsd_f64(carry), between, positions + i, count - i);
+}
+
+// AVX2, four doubles at a time
+
+BLOK_TARGET_AVX2 static double HorizontalSum(__m256d v)
+{
+	__m128d low = _mm256_castpd256_pd128(v);
+	__m128d high = _mm256_extractf128_pd(v, 1);
+
+	return HorizontalSum(_mm_add_pd(low, high));
+}
+
+BLOK_TARGET_AVX2 static double SumAVX2(const double* values, size_t count)
+{
+	__m256d sum = _mm256_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		sum = _mm256_add_pd(sum, _mm256_loadu_pd(values + i));
+	}
+
+	return HorizontalSum(sum) + SumScalar(values + i, count - i);
+}
+
+BLOK_TARGET_AVX2 static double SumInflexibleAVX2(const double* values, const double* flex, size_t count)
+{
+	__m256d sum = _mm256_setzero_pd();
+	__m256d zero = _mm256_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d isFlexible = _mm256_cmp_pd(_mm256_loadu_pd(flex + i), zero, _CMP_GT_OQ);
+		sum = _mm256_add_pd(sum, _mm256_andnot_pd(isFlexible, _mm256_loadu_pd(values + i)));
+	}
+
+	return HorizontalSum(sum) + SumInflexibleScalar(values + i, flex + i, count - i);
+}
+
+BLOK_TARGET_AVX2 static double MaxAVX2(const double* values, size_t count)
+{
+	__m256d max = _mm256_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		max = _mm256_max_pd(_mm256_loadu_pd(values + i), max);
+	}
+
+	__m128d half = _mm_max_pd(_mm256_castpd256_pd128(max), _mm256_extractf128_pd(max, 1));
+	double result = std::max(_mm_cvtsd_f64(half), _mm_cvtsd_f64(_mm_unpackhi_pd(half, half)));
+
+	return std::max(result, MaxScalar(values + i, count - i));
+}
+
+BLOK_TARGET_AVX2 static void DistributeFlexAVX2(const double* flex, const double* paddingLeading, const double* paddingTrailing,
+	double perFlex, double* out, size_t count)
+{
+	__m256d scale = _mm256_set1_pd(perFlex);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d padding = _mm256_add_pd(_mm256_loadu_pd(paddingLeading + i), _mm256_loadu_pd(paddingTrailing + i));
+		_mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(scale, _mm256_loadu_pd(flex + i)), padding));
+	}
+
+	DistributeFlexScalar(flex + i, paddingLeading + i, paddingTrailing + i, perFlex, out + i, count - i);
+}
+
+BLOK_TARGET_AVX2 static void PositionsAVX2(const double* sizes, double start, double between, double* positions, size_t count)
+{
+	__m256d gap = _mm256_set1_pd(between);
+	__m256d zero = _mm256_setzero_pd();
+	__m256d carry = _mm256_set1_pd(start);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d step = _mm256_add_pd(_mm256_loadu_pd(sizes + i), gap); // [a, b, c, d]
+
+		// Inclusive prefix sum in two shift-and-add steps
+		__m256d shift1 = _mm256_blend_pd(_mm256_permute4x64_pd(step, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1); // [0, a, b, c]
+		__m256d partial = _mm256_add_pd(step, shift1); // [a, a+b, b+c, c+d]
+		__m256d shift2 = _mm256_blend_pd(_mm256_permute4x64_pd(partial, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x3); // [0, 0, a, a+b]
+		__m256d inclusive = _mm256_add_pd(partial, shift2); // [a, a+b, a+b+c, a+b+c+d]
+
+		// Each position is everything before it
+		__m256d exclusive = _mm256_blend_pd(_mm256_permute4x64_pd(inclusive, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1);
+
+		_mm256_storeu_pd(positions + i, _mm256_add_pd(carry, exclusive));
+
+		carry = _mm256_add_pd(carry, _mm256_permute4x64_pd(inclusive, _MM_SHUFFLE(3, 3, 3, 3)));
+	}
+
+	PositionsScalar(sizes + i, _mm_cvtsd_f64(_mm256_castpd256_pd128(carry)), between, positions + i, count - i);
+}
+
+static bool IsAVX2Supported()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS has to save the YMM registers too
+	__cpuid(info, 1);
+	bool isOSXSAVE = (info[2] & (1 << 27)) != 0;
+	bool isAVX = (info[2] & (1 << 28)) != 0;
+
+	if (!isOSXSAVE || !isAVX || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+static const BlokLayoutKernels kScalarKernels =
+{
+	kBlokKernelScalar,
+	SumScalar,
+	SumInflexibleScalar,
+	MaxScalar,
+	DistributeFlexScalar,
+	PositionsScalar
+};
+
+#if defined(BLOK_KERNELS_X86)
+
+static const BlokLayoutKernels kSSE2Kernels =
+{
+	kBlokKernelSSE2,
+	SumSSE2,
+	SumInflexibleSSE2,
+	MaxSSE2,
+	DistributeFlexSSE2,
+	PositionsSSE2
+};
+
+static const BlokLayoutKernels kAVX2Kernels =
+{
+	kBlokKernelAVX2,
+	SumAVX2,
+	SumInflexibleAVX2,
+	MaxAVX2,
+	DistributeFlexAVX2,
+	PositionsAVX2
+};
+
+#endif
+
+static const BlokLayoutKernels* GetKernelsForLevel(BlokKernelLevel level)
+{
+#if defined(BLOK_KERNELS_X86)
+	if (level >= kBlokKernelAVX2)
+	{
+		return &kAVX2Kernels;
+	}
+	else if (level >= kBlokKernelSSE2)
+	{
+		return &kSSE2Kernels;
+	}
+#endif
+
+	return &kScalarKernels;
+}
+
+BlokKernelLevel BlokGetMaxKernelLevel()
+{
+#if defined(BLOK_KERNELS_X86)
+	static const BlokKernelLevel sMaxLevel = IsAVX2Supported() ? kBlokKernelAVX2 : kBlokKernelSSE2;
+	return sMaxLevel;
+#else
+	return kBlokKernelScalar;
+#endif
+}
+
+// Read by every solving thread, so swapped atomically. Scalar adds in the same
+// order as the reference solve, the vector kernels didn't pay for giving that up
+static std::atomic<const BlokLayoutKernels*> sActiveKernels(&kScalarKernels);
+
+const BlokLayoutKernels& BlokGetLayoutKernels()
+{
+	return *sActiveKernels.load();
+}
+
+void BlokSetKernelLevel(BlokKernelLevel level)
+{
+	sActiveKernels.store(GetKernelsForLevel(std::min(level, BlokGetMaxKernelLevel())));
+}
@@ -0,0 +1,59 @@
+#ifndef __BlokLayoutKernels_h__
+#define __BlokLayoutKernels_h__
+
+#include <cstddef>
+
+/** Instruction sets the layout kernels can run on, from slowest to fastest */
+enum BlokKernelLevel
+{
+	kBlokKernelScalar = 0,
+	kBlokKernelSSE2 = 1,
+	kBlokKernelAVX2 = 2
+};
+
+/**	The data-parallel steps of laying out a container's children. Each kernel
+	works on a contiguous range of one of BlokLayoutTree's arrays, which is
+	exactly what the children of a node are.
+
+	The vector versions add in a different order than the scalar ones, so
+	results can differ from kBlokKernelScalar in the last bits. They're also
+	no faster on the few children a real container has, so the solver uses
+	the scalar ones unless BlokSetKernelLevel() asks otherwise.
+*/
+struct BlokLayoutKernels
+{
+	BlokKernelLevel level;
+
+	/** Sum of values[0, count) */
+	double (*Sum)(const double* values, size_t count);
+
+	/** Sum of values[i] for every i where flex[i] <= 0 */
+	double (*SumInflexible)(const double* values, const double* flex, size_t count);
+
+	/** The largest of 0 and values[0, count), NaN values are ignored */
+	double (*Max)(const double* values, size_t count);
+
+	/** out[i] = perFlex * flex[i] + (paddingLeading[i] + paddingTrailing[i]) */
+	void (*DistributeFlex)(const double* flex, const double* paddingLeading, const double* paddingTrailing,
+		double perFlex, double* out, size_t count);
+
+	/** positions[i] = start + sum of (sizes[j] + between) for every j < i */
+	void (*Positions)(const double* sizes, double start, double between, double* positions, size_t count);
+};
+
+/**	The scalar kernels, unless BlokSetKernelLevel() asked for another
+	instruction set.
+*/
+const BlokLayoutKernels& BlokGetLayoutKernels();
+
+/**	The best instruction set this CPU supports.
+*/
+BlokKernelLevel BlokGetMaxKernelLevel();
+
+/**	Pick the instruction set, used by the benchmark. Levels above
+	BlokGetMaxKernelLevel() are clamped. Not safe to call while a solve is running.
+@param level IN instruction set to use from now on.
+*/
+void BlokSetKernelLevel(BlokKernelLevel level);
+
+#endif
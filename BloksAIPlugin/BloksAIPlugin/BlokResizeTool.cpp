@@ -0,0 +1,308 @@
+#include "IllustratorSDK.h"
+#include "BlokResizeTool.h"
+#include "BloksAIPluginSuites.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+/** What the Info panel shows while dragging */
+static const ai::int32 kBlokResizeInfoVars[] = { kInfoSizeX, kInfoSizeY, kInfoEndOfList };
+
+/** Color of the preview, the same blue as Illustrator's selection */
+static const AIRGBColor kBlokPreviewColor = { 0x2626, 0x8080, 0xebeb };
+
+BlokResizeTool::BlokResizeTool() :
+	fTool(NULL),
+	fAnnotator(NULL),
+	fHasPreviewRect(false)
+{
+	fStart.h = 0.0;
+	fStart.v = 0.0;
+	fStartRect.left = 0.0;
+	fStartRect.top = 0.0;
+	fStartRect.width = 0.0;
+	fStartRect.height = 0.0;
+	fPreviewRect.left = 0;
+	fPreviewRect.top = 0;
+	fPreviewRect.right = 0;
+	fPreviewRect.bottom = 0;
+}
+
+AIErr BlokResizeTool::Startup(SPPluginRef plugin)
+{
+	AIAddToolData data;
+	data.title = ai::UnicodeString("Bloks Resize");
+	data.tooltip = ai::UnicodeString("Bloks Resize Tool");
+	data.sameToolsetAs = kNoTool;
+
+	// Its own toolset, in the same group as the Selection tool
+	AIErr error = sAITool->GetToolNumberFromName(kSelectTool, &data.sameGroupAs);
+
+	if (!error)
+	{
+		error = sAITool->AddTool(plugin, kBlokResizeToolName, data, 0, &fTool);
+	}
+
+	if (!error)
+	{
+		error = sAITool->SetToolInfoVars(fTool, kBlokResizeInfoVars);
+	}
+
+	if (!error)
+	{
+		error = sAIAnnotator->AddAnnotator(plugin, kBlokResizeAnnotatorName, &fAnnotator);
+	}
+
+	if (!error)
+	{
+		// Only draws while dragging
+		error = sAIAnnotator->SetAnnotatorActive(fAnnotator, false);
+	}
+
+	return error;
+}
+
+AIErr BlokResizeTool::MouseDown(const AIToolMessage& message, BlokEngine& engine)
+{
+	AIArtHandle** matches = NULL;
+	ai::int32 numMatches = 0;
+	AIArtHandle found = NULL;
+	fResize = BlokResize();
+
+	AIErr error = sAIMatchingArt->GetSelectedArt(&matches, &numMatches);
+
+	if (!error && matches)
+	{
+		// A selected group comes back along with everything in it, only the
+		// outermost art counts. Like checkForRelayout(), that has to be a
+		// single BlokContainer
+		std::unordered_set<AIArtHandle> selected((*matches), (*matches) + numMatches);
+		AIArtHandle container = NULL;
+		size_t outermost = 0;
+
+		for (ai::int32 i = 0; i < numMatches; i++)
+		{
+			AIArtHandle art = (*matches)[i];
+			AIArtHandle parent = NULL;
+
+			if (sAIArt->GetArtParent(art, &parent) != kNoErr || selected.count(parent) == 0)
+			{
+				container = art;
+				outermost++;
+			}
+		}
+
+		if (outermost == 1 && BlokIsContainer(container))
+		{
+			found = container;
+		}
+
+		sAIMdMemory->MdMemoryDisposeHandle((AIMdMemoryHandle)matches);
+	}
+
+	if (!error && found)
+	{
+		error = BlokGetArtRect(found, fStartRect);
+	}
+
+	if (!error && found)
+	{
+		fStart = message.cursor;
+
+		// A tree we can't lay out natively still resizes, just without a preview
+		error = engine.BeginResize(found, fResize);
+	}
+
+	if (!error && fResize.IsActive())
+	{
+		error = sAIAnnotator->SetAnnotatorActive(fAnnotator, true);
+	}
+
+	return error;
+}
+
+AIErr BlokResizeTool::MouseDrag(const AIToolMessage& message, BlokEngine& engine)
+{
+	AIErr error = kNoErr;
+
+	if (fResize.container)
+	{
+		AIReal width = 0.0;
+		AIReal height = 0.0;
+		GetSize(message, width, height);
+
+		if (fResize.IsActive())
+		{
+			engine.UpdateResize(fResize, width, height);
+			InvalidatePreview();
+		}
+
+		void* values[] = { &width, &height };
+		error = sAITool->SetToolInfoVarValues(kBlokResizeInfoVars, values);
+	}
+
+	return error;
+}
+
+AIErr BlokResizeTool::MouseUp(const AIToolMessage& message, BlokEngine& engine, BlokEngineStats& stats)
+{
+	AIErr error = kNoErr;
+	BlokResize resize;
+	std::swap(resize, fResize);
+
+	if (fAnnotator)
+	{
+		sAIAnnotator->SetAnnotatorActive(fAnnotator, false);
+	}
+
+	// The preview is gone, erase it
+	InvalidatePreview();
+
+	if (!resize.container || !sAIArt->ValidArt(resize.container, true))
+	{
+		engine.DiscardResize(resize);
+		return error;
+	}
+
+	AIReal width = 0.0;
+	AIReal height = 0.0;
+	GetSize(message, width, height);
+
+	// A click without a drag shouldn't lay anything out
+	if (BlokNearlyEqual(width, fStartRect.width) && BlokNearlyEqual(height, fStartRect.height))
+	{
+		engine.DiscardResize(resize);
+		return error;
+	}
+
+	error = engine.CommitResize(resize, width, height, stats);
+
+	if (!error)
+	{
+		error = sAIUndo->SetUndoTextUS(ai::UnicodeString("Undo Bloks Resize"), ai::UnicodeString("Redo Bloks Resize"));
+	}
+
+	return error;
+}
+
+AIErr BlokResizeTool::Draw(const AIAnnotatorMessage& message)
+{
+	AIErr error = kNoErr;
+
+	if (!fResize.IsActive() || !message.drawer)
+	{
+		return error;
+	}
+
+	const BlokSnapshot& snapshot = fResize.snapshot;
+	AIAnnotatorDrawer* drawer = message.drawer;
+
+	sAIAnnotatorDrawer->SetColor(drawer, kBlokPreviewColor);
+	error = sAIAnnotatorDrawer->SetOpacity(drawer, 0.75);
+
+	// Containers dashed and Bloks solid, the one being resized on top and thicker
+	for (size_t i = 0; !error && i < fResize.bounds.size(); i++)
+	{
+		AIRect rect;
+
+		if (i != fResize.node && BlokGetViewRect(message.view, fResize.bounds[i], rect) == kNoErr)
+		{
+			sAIAnnotatorDrawer->SetLineWidth(drawer, 1.0);
+			sAIAnnotatorDrawer->SetLineDashed(drawer, snapshot.isContainer[i]);
+
+			error = sAIAnnotatorDrawer->DrawRect(drawer, rect, false);
+		}
+	}
+
+	if (!error && fResize.node < fResize.bounds.size())
+	{
+		AIRect rect;
+
+		if (BlokGetViewRect(message.view, fResize.bounds[fResize.node], rect) == kNoErr)
+		{
+			sAIAnnotatorDrawer->SetLineWidth(drawer, 2.0);
+			sAIAnnotatorDrawer->SetLineDashed(drawer, false);
+
+			error = sAIAnnotatorDrawer->DrawRect(drawer, rect, false);
+		}
+	}
+
+	return error;
+}
+
+/**	Have Illustrator redraw where the preview was and where it is now, and
+	nowhere else.
+*/
+void BlokResizeTool::InvalidatePreview()
+{
+	if (fHasPreviewRect)
+	{
+		sAIAnnotator->InvalAnnotationRect(NULL, &fPreviewRect);
+		fHasPreviewRect = false;
+	}
+
+	if (!fResize.IsActive())
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < fResize.bounds.size(); i++)
+	{
+		AIRect rect;
+
+		if (BlokGetViewRect(NULL, fResize.bounds[i], rect) != kNoErr)
+		{
+			continue;
+		}
+
+		if (!fHasPreviewRect)
+		{
+			fPreviewRect = rect;
+			fHasPreviewRect = true;
+		}
+		else
+		{
+			fPreviewRect.left = std::min(fPreviewRect.left, rect.left);
+			fPreviewRect.top = std::min(fPreviewRect.top, rect.top);
+			fPreviewRect.right = std::max(fPreviewRect.right, rect.right);
+			fPreviewRect.bottom = std::max(fPreviewRect.bottom, rect.bottom);
+		}
+	}
+
+	if (fHasPreviewRect)
+	{
+		// Room for the thick outline
+		fPreviewRect.left -= 2;
+		fPreviewRect.top -= 2;
+		fPreviewRect.right += 2;
+		fPreviewRect.bottom += 2;
+
+		sAIAnnotator->InvalAnnotationRect(NULL, &fPreviewRect);
+	}
+}
+
+/**	The container's size if the mouse were let go now. The bottom right follows
+	the mouse, Shift keeps whichever dimension moved least.
+*/
+void BlokResizeTool::GetSize(const AIToolMessage& message, AIReal& width, AIReal& height) const
+{
+	// Page coordinates point up, ours down
+	AIReal dx = message.cursor.h - fStart.h;
+	AIReal dy = fStart.v - message.cursor.v;
+
+	if (message.event && (message.event->modifiers & aiEventModifiers_shiftKey))
+	{
+		if (std::fabs(dx) >= std::fabs(dy))
+		{
+			dy = 0.0;
+		}
+		else
+		{
+			dx = 0.0;
+		}
+	}
+
+	width = std::max(fStartRect.width + dx, (AIReal)0.0);
+	height = std::max(fStartRect.height + dy, (AIReal)0.0);
+}
@@ -0,0 +1,99 @@
+#ifndef __BlokResizeTool_h__
+#define __BlokResizeTool_h__
+
+#include "IllustratorSDK.h"
+#include "BlokArt.h"
+#include "BlokEngine.h"
+
+/** Unique name of the tool, see AIToolSuite::AddTool() */
+#define kBlokResizeToolName "Bloks Resize Tool"
+
+/** Unique name of the annotator that draws the drag preview */
+#define kBlokResizeAnnotatorName "Bloks Resize Preview"
+
+/**	A tool for resizing a selected BlokGroup without scaling what's in it.
+	Dragging the Selection tool's handles scales the group, text included,
+	which BlokContainer.checkForRelayout() then has to undo. This tool never
+	touches the art while dragging. Every drag event solves the tree at the
+	new size and draws where each Blok would go as an annotation. On mouse up
+	that layout is applied in one batch, a single undo step.
+
+	The drag sizes the container from its top left corner, like the rest of
+	layout does. Shift keeps the other dimension as it was.
+
+	Only call from the main thread.
+*/
+class BlokResizeTool
+{
+public:
+	BlokResizeTool();
+
+	/**	Add the tool to the Tools panel, next to the Selection tool, and the
+		annotator for its preview.
+	@param plugin IN our plugin, the tool's messages go to its ToolMouseDown() and friends.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Startup(SPPluginRef plugin);
+
+	/**	True if a tool message is for this tool.
+	@param tool IN AIToolMessage::tool.
+	*/
+	bool IsTool(AIToolHandle tool) const { return tool && tool == fTool; }
+
+	/**	True if an annotator message is for our preview.
+	@param annotator IN AIAnnotatorMessage::annotator.
+	*/
+	bool IsAnnotator(AIAnnotatorHandle annotator) const { return annotator && annotator == fAnnotator; }
+
+	/**	Start a drag if a single BlokContainer is selected.
+	@param message IN the mouse down.
+	@param engine IN/OUT captures the container's tree.
+	@return kNoErr on success, other AIErr otherwise. Nothing selected is not an error.
+	*/
+	AIErr MouseDown(const AIToolMessage& message, BlokEngine& engine);
+
+	/**	Lay out the container at the size it's dragged to and redraw the
+		preview. The size also shows in the Info panel.
+	@param message IN the mouse drag.
+	@param engine IN/OUT solves the container's tree.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr MouseDrag(const AIToolMessage& message, BlokEngine& engine);
+
+	/**	Apply the layout at the final size.
+	@param message IN the mouse up.
+	@param engine IN/OUT applies the container's tree.
+	@param stats OUT what happened, empty if there was no drag.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr MouseUp(const AIToolMessage& message, BlokEngine& engine, BlokEngineStats& stats);
+
+	/**	Draw the preview, every Blok's rect at the size being dragged to.
+	@param message IN the draw message.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Draw(const AIAnnotatorMessage& message);
+
+	/** True between a MouseDown() that found a container and the MouseUp() */
+	bool IsDragging() const { return fResize.container != NULL; }
+
+private:
+	void GetSize(const AIToolMessage& message, AIReal& width, AIReal& height) const;
+	void InvalidatePreview();
+
+	AIToolHandle fTool;
+	AIAnnotatorHandle fAnnotator;
+
+	// Container being dragged and its layout, no container when there's no drag
+	BlokResize fResize;
+
+	// Where the drag started, page coordinates, and the container's bounds then
+	AIRealPoint fStart;
+	BlokRect fStartRect;
+
+	// View area the preview was last drawn in, empty if it wasn't
+	AIRect fPreviewRect;
+	bool fHasPreviewRect;
+};
+
+#endif
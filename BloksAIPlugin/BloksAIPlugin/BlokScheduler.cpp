@@ -0,0 +1,380 @@
+#include "IllustratorSDK.h"
+#include "BlokScheduler.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+typedef std::chrono::steady_clock BlokClock;
+
+static double MillisecondsSince(BlokClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BlokClock::now() - start).count();
+}
+
+BlokScheduler::BlokScheduler() :
+	fTimer(NULL),
+	fMsPerRoot(0.0)
+{
+}
+
+AIErr BlokScheduler::Startup(SPPluginRef plugin)
+{
+	AIErr error = sAITimer->AddTimer(plugin, "Bloks Scheduler", kBlokSchedulerPeriod, &fTimer);
+
+	if (!error)
+	{
+		error = sAITimer->SetTimerActive(fTimer, false);
+	}
+
+	return error;
+}
+
+void BlokScheduler::QueueRoots(const std::vector<AIArtHandle>& art)
+{
+	DocumentWork* work = GetCurrentWork(true);
+
+	for (size_t i = 0; work && i < art.size(); i++)
+	{
+		Push(*work, BlokGetRootContainer(art[i]));
+	}
+
+	UpdateTimer();
+}
+
+void BlokScheduler::QueueRelayoutAll()
+{
+	DocumentWork* work = GetCurrentWork(true);
+
+	if (work)
+	{
+		work->isRelayoutAllQueued = true;
+	}
+
+	UpdateTimer();
+}
+
+void BlokScheduler::QueueSpacerOpacity(AIReal opacity)
+{
+	DocumentWork* work = GetCurrentWork(true);
+
+	if (work)
+	{
+		work->isOpacityQueued = true;
+		work->opacity = opacity;
+	}
+
+	UpdateTimer();
+}
+
+void BlokScheduler::DocumentClosed()
+{
+	for (auto it = fWork.begin(); it != fWork.end();)
+	{
+		if (BlokIsDocumentOpen(it->first))
+		{
+			++it;
+		}
+		else
+		{
+			it = fWork.erase(it);
+		}
+	}
+
+	UpdateTimer();
+}
+
+AIErr BlokScheduler::Tick(BlokEngine& engine, BlokSpacerIndex& spacers, BlokInvalidationQueue& skipped)
+{
+	return Run(engine, spacers, skipped, kBlokSchedulerBudgetMs);
+}
+
+AIErr BlokScheduler::Flush(BlokEngine& engine, BlokSpacerIndex& spacers, BlokInvalidationQueue& skipped)
+{
+	return Run(engine, spacers, skipped, std::numeric_limits<double>::infinity());
+}
+
+/** Work through the current document's queue for budgetMs, always making some progress */
+AIErr BlokScheduler::Run(BlokEngine& engine, BlokSpacerIndex& spacers, BlokInvalidationQueue& skipped, double budgetMs)
+{
+	AIErr error = kNoErr;
+	BlokClock::time_point start = BlokClock::now();
+
+	// Illustrator refuses to change art outside of the mode, wait until it's left
+	if (sAIIsolationMode->IsInIsolationMode())
+	{
+		return error;
+	}
+
+	// Other documents' work waits until they're current again
+	DocumentWork* work = GetCurrentWork(false);
+
+	if (!work)
+	{
+		return error;
+	}
+
+	BlokPass& pass = work->pass;
+
+	if (work->isOpacityQueued)
+	{
+		// Already a single pass over an index, not worth splitting up
+		BlokSpacerStats stats;
+		work->isOpacityQueued = false;
+
+		error = spacers.SetOpacity(work->opacity, stats);
+	}
+
+	if (!error && work->isRelayoutAllQueued)
+	{
+		std::vector<AIArtHandle> roots;
+		work->isRelayoutAllQueued = false;
+
+		error = BlokGetRootContainers(roots);
+
+		for (size_t i = 0; !error && i < roots.size(); i++)
+		{
+			Push(*work, roots[i]);
+		}
+	}
+
+	if (!error && !work->roots.empty())
+	{
+		PromoteSelection(*work);
+	}
+
+	// Lay out as many roots as fit in what's left of the budget, but always make
+	// some progress. A batch too big for one tick carries on in the next.
+	bool isFirstBatch = true;
+
+	while (!error && (pass.IsActive() || !work->roots.empty()))
+	{
+		double remainingMs = budgetMs - MillisecondsSince(start);
+
+		if (remainingMs <= 0.0 && !isFirstBatch)
+		{
+			break;
+		}
+
+		if (!pass.IsActive())
+		{
+			double fits = fMsPerRoot > 0.0 ? std::min(remainingMs / fMsPerRoot, (double)work->roots.size()) : 1.0;
+			size_t batchSize = (size_t)std::max(fits, 1.0);
+			std::vector<AIArtHandle> roots;
+
+			while (roots.size() < batchSize && !work->roots.empty())
+			{
+				AIArtHandle root = work->roots.front();
+				work->roots.pop_front();
+				work->queued.erase(root);
+
+				// Art can be deleted while it waits
+				if (sAIArt->ValidArt(root, true))
+				{
+					roots.push_back(root);
+				}
+			}
+
+			if (roots.empty())
+			{
+				continue;
+			}
+
+			engine.BeginPass(pass, roots);
+		}
+
+		bool isDone = false;
+		error = engine.ContinuePass(pass, std::max(remainingMs, 1.0), isDone);
+		isFirstBatch = false;
+
+		if (!isDone)
+		{
+			break;
+		}
+
+		const BlokEngineStats& stats = pass.stats;
+
+		// Follow the document as it changes, but don't jump on a single slow batch
+		if (stats.roots > 0)
+		{
+			double msPerRoot = (stats.snapshotMs + stats.solveMs + stats.applyMs) / (double)stats.roots;
+			fMsPerRoot = fMsPerRoot > 0.0 ? (fMsPerRoot + msPerRoot) / 2.0 : msPerRoot;
+		}
+
+		for (size_t i = 0; i < stats.skipped.size(); i++)
+		{
+			skipped.Push(stats.skipped[i]);
+		}
+	}
+
+	UpdateTimer();
+
+	return error;
+}
+
+bool BlokScheduler::DocumentWork::IsBusy() const
+{
+	return pass.IsActive() || !roots.empty() || isRelayoutAllQueued || isOpacityQueued;
+}
+
+bool BlokScheduler::IsBusy() const
+{
+	bool isBusy = false;
+
+	for (auto it = fWork.begin(); !isBusy && it != fWork.end(); ++it)
+	{
+		isBusy = it->second.IsBusy();
+	}
+
+	return isBusy;
+}
+
+bool BlokScheduler::IsCurrentBusy() const
+{
+	const DocumentWork* work = GetCurrentWork();
+
+	return work && work->IsBusy();
+}
+
+void BlokScheduler::Update(const ai::ArtObjectsChangedNotifierData& data)
+{
+	DocumentWork* work = GetCurrentWork(false);
+
+	if (!work)
+	{
+		return;
+	}
+
+	BlokPass& pass = work->pass;
+
+	// Once apply starts, the changes are our own. BlokEngine finds out about
+	// the user's through the undo history instead.
+	if (!pass.IsActive() || pass.isStale || pass.phase == kBlokPassApply)
+	{
+		return;
+	}
+
+	const ai::ArtObjectsChangedData& changes = data.artObjsChangedData;
+
+	// Removed art can't be traced back to its root anymore, so any removal
+	// could have been in the pass
+	if (changes.removedObjList.GetCount() > 0)
+	{
+		pass.isStale = true;
+		return;
+	}
+
+	for (size_t i = 0; !pass.isStale && i < changes.insertedObjList.GetCount(); i++)
+	{
+		pass.isStale = IsInPass(*work, changes.insertedObjList[i]);
+	}
+
+	for (size_t i = 0; !pass.isStale && i < changes.modifiedObjList.GetCount(); i++)
+	{
+		pass.isStale = IsInPass(*work, changes.modifiedObjList[i]);
+	}
+}
+
+std::string BlokScheduler::GetProgressJSON() const
+{
+	const DocumentWork* work = GetCurrentWork();
+
+	std::ostringstream json;
+	json.imbue(std::locale::classic());
+
+	json << "{\"isBusy\":" << (IsCurrentBusy() ? "true" : "false")
+		<< ",\"queued\":" << (work ? work->roots.size() : 0)
+		<< ",\"pass\":" << (work ? work->pass.ToJSON() : BlokPass().ToJSON())
+		<< "}";
+
+	return json.str();
+}
+
+/**	The work queued for the current document.
+@param canCreate IN true to start an empty queue if it has none.
+@return NULL if there's no current document, or it has no queue and canCreate is false.
+*/
+BlokScheduler::DocumentWork* BlokScheduler::GetCurrentWork(bool canCreate)
+{
+	AIDocumentHandle document = NULL;
+
+	if (sAIDocument->GetDocument(&document) != kNoErr || !document)
+	{
+		return NULL;
+	}
+
+	auto it = fWork.find(document);
+
+	if (it != fWork.end())
+	{
+		return &it->second;
+	}
+
+	return canCreate ? &fWork[document] : NULL;
+}
+
+const BlokScheduler::DocumentWork* BlokScheduler::GetCurrentWork() const
+{
+	AIDocumentHandle document = NULL;
+
+	if (sAIDocument->GetDocument(&document) != kNoErr || !document)
+	{
+		return NULL;
+	}
+
+	auto it = fWork.find(document);
+
+	return it != fWork.end() ? &it->second : NULL;
+}
+
+void BlokScheduler::Push(DocumentWork& work, AIArtHandle root)
+{
+	if (root && work.queued.insert(root).second)
+	{
+		work.roots.push_back(root);
+	}
+}
+
+/** Move the root the user is working in to the front of the line */
+void BlokScheduler::PromoteSelection(DocumentWork& work)
+{
+	AIArtHandle** matches = NULL;
+	ai::int32 numMatches = 0;
+	AIArtHandle root = NULL;
+
+	if (sAIMatchingArt->GetSelectedArt(&matches, &numMatches) == kNoErr && matches)
+	{
+		for (ai::int32 i = 0; !root && i < numMatches; i++)
+		{
+			root = BlokGetRootContainer((*matches)[i]);
+		}
+
+		sAIMdMemory->MdMemoryDisposeHandle((AIMdMemoryHandle)matches);
+	}
+
+	if (root && work.queued.count(root) > 0)
+	{
+		work.roots.erase(std::find(work.roots.begin(), work.roots.end(), root));
+		work.roots.push_front(root);
+	}
+}
+
+/** True if the art is in one of the trees the document's pass is laying out */
+bool BlokScheduler::IsInPass(const DocumentWork& work, const ai::uuid& uuid) const
+{
+	AIArtHandle art = NULL;
+
+	return sAIUUID->GetArtHandle(uuid, art) == kNoErr && art && work.pass.Contains(BlokGetRootContainer(art));
+}
+
+void BlokScheduler::UpdateTimer()
+{
+	if (fTimer)
+	{
+		sAITimer->SetTimerActive(fTimer, IsBusy());
+	}
+}
@@ -0,0 +1,125 @@
+#ifndef __BlokScheduler_h__
+#define __BlokScheduler_h__
+
+#include "IllustratorSDK.h"
+#include "BlokEngine.h"
+#include "BlokInvalidation.h"
+#include "BlokSpacers.h"
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/** Milliseconds of layout work done per timer tick, under one 60Hz frame */
+#define kBlokSchedulerBudgetMs 12.0
+
+/** Ticks between timer messages, kTicksPerSecond is 60 */
+#define kBlokSchedulerPeriod 1
+
+/**	Runs layout work that doesn't have to happen right away, like relayout-all
+	or flushing roots queued during Symbol Editing Mode, from an AITimer once
+	Illustrator is idle. Each tick does about kBlokSchedulerBudgetMs of work
+	so clicks and drags never wait on a big layout. A batch that doesn't fit
+	in one tick is a BlokPass that picks up where it left off in the next, and
+	starts over if its art is edited in between. The root containing the
+	current selection always goes first.
+
+	Work is kept per document and only done while its document is the
+	current one. Switching to another document leaves a pass where it is,
+	it carries on once its document is current again.
+
+	The timer only runs while there's work. Only call from the main thread.
+*/
+class BlokScheduler
+{
+public:
+	BlokScheduler();
+
+	/**	Register our timer, inactive until there's work.
+	@param plugin IN our plugin, the timer's messages go to its GoTimer().
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Startup(SPPluginRef plugin);
+
+	/**	Lay out the root container above each art object, once each.
+	@param art IN any art in a Blok tree.
+	*/
+	void QueueRoots(const std::vector<AIArtHandle>& art);
+
+	/** Lay out every root in the current document */
+	void QueueRelayoutAll();
+
+	/**	Set the opacity of every spacer in the current document.
+	@param opacity IN 0.0 to 1.0, replaces an earlier one that hasn't run yet.
+	*/
+	void QueueSpacerOpacity(AIReal opacity);
+
+	/** Drop the work of documents that were closed, other documents keep theirs */
+	void DocumentClosed();
+
+	/**	Do one tick's worth of work. Call from GoTimer(), inside an AppContext.
+	@param engine IN/OUT lays out roots.
+	@param spacers IN/OUT sets spacer opacity.
+	@param skipped IN/OUT roots the engine couldn't lay out are pushed here for TypeScript.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Tick(BlokEngine& engine, BlokSpacerIndex& spacers, BlokInvalidationQueue& skipped);
+
+	/**	Do all of the current document's work now, like before it's saved
+		or exported. Same parameters as Tick().
+	*/
+	AIErr Flush(BlokEngine& engine, BlokSpacerIndex& spacers, BlokInvalidationQueue& skipped);
+
+	/** True if any document has work waiting */
+	bool IsBusy() const;
+
+	/** True if the current document has work waiting */
+	bool IsCurrentBusy() const;
+
+	/**	Start the current document's pass over if art in one of its trees changed.
+	@param data IN what changed.
+	*/
+	void Update(const ai::ArtObjectsChangedNotifierData& data);
+
+	/** Write out how much of the current document's work is left as a JSON object, for the panel */
+	std::string GetProgressJSON() const;
+
+private:
+	/** What's queued for one document */
+	struct DocumentWork
+	{
+		DocumentWork() : isRelayoutAllQueued(false), isOpacityQueued(false), opacity(1.0) {}
+
+		bool IsBusy() const;
+
+		// Batch being laid out, it can take several ticks
+		BlokPass pass;
+
+		// Roots in the order they'll be laid out
+		std::deque<AIArtHandle> roots;
+		std::unordered_set<AIArtHandle> queued;
+
+		bool isRelayoutAllQueued;
+		bool isOpacityQueued;
+		AIReal opacity;
+	};
+
+	AIErr Run(BlokEngine& engine, BlokSpacerIndex& spacers, BlokInvalidationQueue& skipped, double budgetMs);
+	DocumentWork* GetCurrentWork(bool canCreate);
+	const DocumentWork* GetCurrentWork() const;
+	void Push(DocumentWork& work, AIArtHandle root);
+	void PromoteSelection(DocumentWork& work);
+	bool IsInPass(const DocumentWork& work, const ai::uuid& uuid) const;
+	void UpdateTimer();
+
+	AITimerHandle fTimer;
+
+	// Art handles only mean something in their own document
+	std::unordered_map<AIDocumentHandle, DocumentWork> fWork;
+
+	/** Average milliseconds a root took to lay out so far, to size batches */
+	double fMsPerRoot;
+};
+
+#endif
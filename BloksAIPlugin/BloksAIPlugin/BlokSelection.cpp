@@ -0,0 +1,227 @@
+#include "IllustratorSDK.h"
+#include "BlokSelection.h"
+#include "BlokArt.h"
+#include "BlokTag.h"
+#include "BloksAIPluginSuites.h"
+
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+/** Saved properties of a Blok the panel shows, see BlokUserSettings */
+static const char* kBlokSettingNumbers[] = { "flex", "alignSelf" };
+
+/** Saved properties of a BlokContainer the panel shows, on top of a Blok's, see BlokContainerUserSettings */
+static const char* kBlokContainerSettingNumbers[] = { "flexDirection", "justifyContent", "alignItems", "flexWrap", "gap" };
+
+/** Join "name":value pairs into a JSON object */
+static std::string ToObject(const std::vector<std::string>& properties)
+{
+	std::string object = "{";
+
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		object += (i > 0 ? "," : "") + properties[i];
+	}
+
+	return object + "}";
+}
+
+/**	Add the properties of art the way getUserSettings() would. Ones that
+	aren't set are left out, like undefined is by JSON2.stringify().
+@param properties IN/OUT "name":value pairs of the object being written.
+*/
+static void AddSettings(std::vector<std::string>& properties, const BlokTagData& tag, bool isContainer)
+{
+	std::ostringstream property;
+	property.imbue(std::locale::classic());
+
+	// Every double survives the trip through JSON.parse() unchanged, the panel compares them
+	property << std::setprecision(17);
+
+	double number = 0.0;
+	bool boolean = false;
+
+	for (size_t i = 0; i < sizeof(kBlokSettingNumbers) / sizeof(kBlokSettingNumbers[0]); i++)
+	{
+		if (tag.GetNumber(kBlokSettingNumbers[i], number))
+		{
+			property.str("");
+			property << "\"" << kBlokSettingNumbers[i] << "\":" << number;
+			properties.push_back(property.str());
+		}
+	}
+
+	if (tag.GetBoolean("autoHeight", boolean))
+	{
+		properties.push_back(boolean ? "\"autoHeight\":true" : "\"autoHeight\":false");
+	}
+
+	for (size_t i = 0; isContainer && i < sizeof(kBlokContainerSettingNumbers) / sizeof(kBlokContainerSettingNumbers[0]); i++)
+	{
+		if (tag.GetNumber(kBlokContainerSettingNumbers[i], number))
+		{
+			property.str("");
+			property << "\"" << kBlokContainerSettingNumbers[i] << "\":" << number;
+			properties.push_back(property.str());
+		}
+	}
+}
+
+/**	Add the parentBlokContainer property, the settings of the container art is in.
+*/
+static AIErr AddParentSettings(std::vector<std::string>& properties, AIArtHandle parent)
+{
+	std::vector<std::string> parentProperties;
+	BlokTagData tag;
+
+	AIErr error = BlokReadTag(parent, tag);
+
+	if (!error)
+	{
+		AddSettings(parentProperties, tag, true);
+		properties.push_back("\"parentBlokContainer\":" + ToObject(parentProperties));
+	}
+
+	return error;
+}
+
+/**	The selected art that isn't inside other selected art, like
+	document.selection. A selected group comes back from GetSelectedArt()
+	along with everything in it.
+*/
+static AIErr GetOutermostSelection(std::vector<AIArtHandle>& outermost)
+{
+	AIArtHandle** matches = NULL;
+	ai::int32 numMatches = 0;
+
+	outermost.clear();
+
+	AIErr error = sAIMatchingArt->GetSelectedArt(&matches, &numMatches);
+
+	if (!error && matches)
+	{
+		std::unordered_set<AIArtHandle> selected((*matches), (*matches) + numMatches);
+
+		for (ai::int32 i = 0; i < numMatches; i++)
+		{
+			AIArtHandle art = (*matches)[i];
+			AIArtHandle parent = NULL;
+
+			if (sAIArt->GetArtParent(art, &parent) != kNoErr || selected.count(parent) == 0)
+			{
+				outermost.push_back(art);
+			}
+		}
+
+		sAIMdMemory->MdMemoryDisposeHandle((AIMdMemoryHandle)matches);
+	}
+	else if (error == kNoMatchingArtErr)
+	{
+		// Nothing selected isn't an error
+		error = kNoErr;
+	}
+
+	return error;
+}
+
+AIErr BlokGetSelectionSummary(std::string& json)
+{
+	AIErr error = kNoErr;
+	AIDocumentHandle document = NULL;
+	AIBoolean hasTextFocus = false;
+	BlokSelectionAction action = kBlokSelectionNone;
+	std::vector<AIArtHandle> selection;
+	std::vector<std::string> blok;
+
+	json.clear();
+
+	if (sAIDocument->GetDocument(&document) != kNoErr || !document)
+	{
+		// No document, no operations available
+	}
+	else if (sAIDocument->HasTextFocus(&hasTextFocus) == kNoErr && hasTextFocus)
+	{
+		// A text range, nothing to do with it
+	}
+	else
+	{
+		error = GetOutermostSelection(selection);
+	}
+
+	if (!error && selection.size() > 1)
+	{
+		action = kBlokSelectionMultiple;
+	}
+	else if (!error && selection.size() == 1)
+	{
+		AIArtHandle art = selection[0];
+		AIArtHandle parent = NULL;
+		std::string name;
+		BlokTagData tag;
+
+		sAIArt->GetArtParent(art, &parent);
+		bool isContainer = BlokIsContainer(art);
+		bool isInContainer = parent && BlokIsContainer(parent);
+
+		error = BlokGetArtName(art, name);
+
+		if (!error)
+		{
+			error = BlokReadTag(art, tag);
+		}
+
+		if (error)
+		{
+			// Nothing to summarize
+		}
+		else if (isInContainer && !isContainer && !BlokIsKeyInString(name, ".bg"))
+		{
+			// A Blok that isn't attached yet reads as all undefined, like it does from getBlok()
+			action = kBlokSelectionBlok;
+			AddSettings(blok, tag, false);
+			error = AddParentSettings(blok, parent);
+
+			if (BlokIsAreaText(art))
+			{
+				blok.push_back("\"isAreaText\":true");
+			}
+		}
+		else if (isContainer)
+		{
+			action = kBlokSelectionContainer;
+			AddSettings(blok, tag, true);
+
+			if (isInContainer)
+			{
+				blok.push_back("\"isAlsoChild\":true");
+				error = AddParentSettings(blok, parent);
+			}
+		}
+		else if (sAIIsolationMode->IsInIsolationMode())
+		{
+			// Could be the root of a symbol being edited, ExtendScript looks
+			// through its instances
+			return error;
+		}
+	}
+
+	if (!error)
+	{
+		std::ostringstream summary;
+		summary.imbue(std::locale::classic());
+		summary << "{\"action\":" << (int)action;
+
+		if (action == kBlokSelectionBlok || action == kBlokSelectionContainer)
+		{
+			summary << ",\"blok\":" << ToObject(blok);
+		}
+
+		summary << "}";
+		json = summary.str();
+	}
+
+	return error;
+}
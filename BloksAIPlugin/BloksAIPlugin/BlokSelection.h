@@ -0,0 +1,37 @@
+#ifndef __BlokSelection_h__
+#define __BlokSelection_h__
+
+#include "IllustratorSDK.h"
+
+#include <string>
+
+/** What the panel can do with the selection, see getActionsFromSelection() in index.ts */
+enum BlokSelectionAction
+{
+	/** Nothing, or the selection is text being edited */
+	kBlokSelectionNone = 0,
+
+	/** A BlokContainer is selected */
+	kBlokSelectionContainer = 1,
+
+	/** A Blok in a BlokContainer is selected */
+	kBlokSelectionBlok = 2,
+
+	/** Several objects are selected, they can be grouped into a BlokContainer */
+	kBlokSelectionMultiple = 3
+};
+
+/**	Work out what getActionsFromSelection() would return for the current
+	selection, straight from the saved properties, so the panel doesn't have
+	to ask ExtendScript on every selection change. Reading never attaches a
+	Blok or writes to the art.
+
+	Art inside Symbol Editing Mode stands in for every instance of the symbol,
+	which only ExtendScript can work out, so it has no summary.
+@param json OUT {action, blok} as a JSON object, with the same properties as
+	getActionsFromSelection(). Empty if ExtendScript has to be asked instead.
+@return kNoErr on success, other AIErr otherwise.
+*/
+AIErr BlokGetSelectionSummary(std::string& json);
+
+#endif
@@ -0,0 +1,487 @@
+#include "IllustratorSDK.h"
+#include "BlokSnapshot.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <regex>
+
+static const double kUndefined = std::numeric_limits<double>::quiet_NaN();
+
+/** Same check as BlokContainer.getChildren() uses to convert a child to a BlokContainer */
+static bool IsContainerChild(AIArtHandle art, const std::string& name)
+{
+	return name == "<BlokGroup>" || BlokIsContainer(art);
+}
+
+BlokSnapshot::BlokSnapshot() :
+	root(NULL),
+	measuredCount(0),
+	textMeasurer(NULL),
+	supported(true),
+	overrideArt(NULL),
+	overrideWidth(0.0),
+	overrideHeight(0.0)
+{
+}
+
+AIErr BlokSnapshot::Capture(AIArtHandle rootArt, BlokTextMeasurer* measurer)
+{
+	AIErr error = BeginCapture(rootArt, measurer);
+
+	while (!error && !IsCaptured())
+	{
+		error = CaptureNext();
+	}
+
+	return error;
+}
+
+AIErr BlokSnapshot::BeginCapture(AIArtHandle rootArt, BlokTextMeasurer* measurer)
+{
+	root = rootArt;
+	supported = true;
+	measuredCount = 0;
+	textMeasurer = measurer;
+
+	tree.Clear();
+	art.clear();
+	bg.clear();
+	rect.clear();
+	bgRect.clear();
+	tags.clear();
+	isContainer.clear();
+	isAreaText.clear();
+	textKeys.clear();
+	artChildCount.clear();
+	pending.clear();
+
+	tree.Append(1);
+	art.resize(1, NULL);
+	bg.resize(1, NULL);
+	rect.resize(1);
+	bgRect.resize(1);
+	tags.resize(1);
+	isContainer.resize(1, true);
+	isAreaText.resize(1, false);
+	textKeys.resize(1);
+	artChildCount.resize(1, 0);
+
+	double width = 0.0;
+	double height = 0.0;
+
+	AIErr error = ReadNode(0, rootArt, true, width, height);
+
+	if (!error)
+	{
+		PendingContainer container = { 0, width, height, false, false, false };
+		pending.push_back(container);
+	}
+
+	return error;
+}
+
+AIErr BlokSnapshot::CaptureNext()
+{
+	PendingContainer container = pending.back();
+	pending.pop_back();
+
+	AIErr error = CaptureChildren(container.node, container.width, container.height, container.needsBaseline);
+
+	if (!error)
+	{
+		// The parent's say comes last, like it did when this was recursive
+		if (container.isWidthFreed)
+		{
+			tree.styleWidth[container.node] = kUndefined;
+		}
+
+		if (container.isHeightFreed)
+		{
+			tree.styleHeight[container.node] = kUndefined;
+		}
+	}
+
+	return error;
+}
+
+/**	Port of Blok.computeCssNode(), plus the tag writes that BlokAdapter.getBlok()
+	and getBlokContainer() make. width and height are the dims the node would
+	hand its container.
+*/
+AIErr BlokSnapshot::ReadNode(size_t node, AIArtHandle nodeArt, bool container, double& width, double& height)
+{
+	art[node] = nodeArt;
+	isContainer[node] = container;
+
+	BlokTagData& tag = tags[node];
+	AIErr error = BlokReadTag(nodeArt, tag);
+
+	if (!error)
+	{
+		std::string type;
+		tag.GetString("type", type);
+
+		if (container)
+		{
+			if (type != "BlokContainer")
+			{
+				// Brand new, give it the same defaults as BlokContainerUserSettings
+				tag.SetString("type", "BlokContainer");
+				tag.SetNumber("flexDirection", kBlokFlexDirectionRow);
+				tag.SetNumber("justifyContent", kBlokJustifyFlexStart);
+				tag.SetNumber("alignItems", kBlokAlignFlexStart);
+				tag.SetNumber("flexWrap", 0);
+			}
+		}
+		else
+		{
+			tag.SetString("type", "Blok");
+		}
+
+		// Always needed, BlokApplier diffs the new layout against it
+		error = BlokGetArtRect(nodeArt, rect[node]);
+	}
+
+	if (!error)
+	{
+		bool useCachedPrestretch = false;
+
+		if (tag.GetBoolean("useCachedPrestretch", useCachedPrestretch) && useCachedPrestretch)
+		{
+			if (!tag.GetNumber("cachedPrestretchWidth", width))
+			{
+				width = kUndefined;
+			}
+
+			if (!tag.GetNumber("cachedPrestretchHeight", height))
+			{
+				height = kUndefined;
+			}
+
+			tag.SetBoolean("useCachedPrestretch", false);
+		}
+		else
+		{
+			width = rect[node].width;
+			height = rect[node].height;
+		}
+	}
+
+	if (!error)
+	{
+		double flex = 0.0;
+		double alignSelf = 0.0;
+
+		tree.flex[node] = tag.GetNumber("flex", flex) ? flex : 0.0;
+		tree.alignSelf[node] = tag.GetNumber("alignSelf", alignSelf) ? (int)alignSelf : kBlokAlignUnset;
+
+		if (!container)
+		{
+			tree.styleWidth[node] = width;
+			tree.styleHeight[node] = height;
+
+			// Needs the TextPath treatment from Blok.layout()
+			isAreaText[node] = BlokIsAreaText(nodeArt);
+		}
+	}
+
+	if (!error && isAreaText[node] && textMeasurer)
+	{
+		bool autoHeight = false;
+
+		if (tag.GetBoolean("autoHeight", autoHeight) && autoHeight)
+		{
+			// Its height follows its width, measured during the solve
+			error = textMeasurer->GetKey(nodeArt, textKeys[node]);
+
+			if (!error)
+			{
+				tree.isMeasured[node] = 1;
+				tree.styleHeight[node] = kUndefined;
+				measuredCount++;
+			}
+		}
+	}
+
+	return error;
+}
+
+/**	Port of the container half of BlokContainer.computeCssNode(). Child
+	containers are queued in pending instead of being captured right away,
+	last child on the bottom so the first comes off next, which numbers nodes
+	the same as a depth first walk.
+@param needsBaseline IN true if node's first baseline is used by its parent.
+*/
+AIErr BlokSnapshot::CaptureChildren(size_t node, double width, double height, bool needsBaseline)
+{
+	AIErr error = kNoErr;
+	BlokTagData& tag = tags[node];
+	double value = 0.0;
+
+	if (tag.GetNumber("overrideWidth", value))
+	{
+		width = value;
+	}
+
+	if (tag.GetNumber("overrideHeight", value))
+	{
+		height = value;
+	}
+
+	tag.Remove("overrideWidth");
+	tag.Remove("overrideHeight");
+
+	if (art[node] == overrideArt)
+	{
+		width = overrideWidth;
+		height = overrideHeight;
+	}
+
+	int flexDirection = tag.GetNumber("flexDirection", value) ? (int)value : kBlokFlexDirectionRow;
+	int justifyContent = tag.GetNumber("justifyContent", value) ? (int)value : kBlokJustifyFlexStart;
+	int alignItems = tag.GetNumber("alignItems", value) ? (int)value : kBlokAlignFlexStart;
+	int flexWrap = tag.GetNumber("flexWrap", value) ? (int)value : 0;
+
+	if (flexWrap != 0)
+	{
+		// flexWrap=WRAP not implemented, let TypeScript raise the error
+		supported = false;
+	}
+
+	tree.flexDirection[node] = flexDirection;
+	tree.justifyContent[node] = justifyContent;
+	tree.alignItems[node] = alignItems;
+	tree.gap[node] = tag.GetNumber("gap", value) ? std::max(value, 0.0) : 0.0;
+	tree.styleWidth[node] = kUndefined;
+	tree.styleHeight[node] = kUndefined;
+
+	bool isRow = flexDirection == kBlokFlexDirectionRow;
+
+	if (justifyContent == kBlokJustifySpaceBetween)
+	{
+		if (isRow)
+		{
+			tree.styleWidth[node] = width;
+		}
+		else
+		{
+			tree.styleHeight[node] = height;
+		}
+	}
+
+	// Collect children from low z-index to high z-index
+	std::vector<AIArtHandle> children;
+	std::vector<std::string> names;
+	AIArtHandle child = NULL;
+	size_t count = 0;
+
+	error = sAIArt->GetArtLastChild(art[node], &child);
+
+	while (!error && child)
+	{
+		std::string name;
+		error = BlokGetArtName(child, name);
+
+		if (!error)
+		{
+			if (count == 0 && BlokIsKeyInString(name, ".bg"))
+			{
+				// Only the bottom-most art is the .bg
+				bg[node] = child;
+				error = BlokGetArtRect(child, bgRect[node]);
+
+				// Add padding if they supplied it. Ex:
+				// .bg padding: 2 0 2 0;
+				static const std::regex paddingRegex("padding:\\s?(\\d+) (\\d+) (\\d+) (\\d+);");
+				std::smatch matches;
+
+				if (std::regex_search(name, matches, paddingRegex))
+				{
+					tree.paddingTop[node] = std::stod(matches[1].str());
+					tree.paddingRight[node] = std::stod(matches[2].str());
+					tree.paddingBottom[node] = std::stod(matches[3].str());
+					tree.paddingLeft[node] = std::stod(matches[4].str());
+				}
+			}
+
+			if (!BlokIsKeyInString(name, ".bg"))
+			{
+				children.push_back(child);
+				names.push_back(name);
+			}
+
+			count++;
+		}
+
+		if (!error)
+		{
+			error = sAIArt->GetArtPriorSibling(child, &child);
+		}
+	}
+
+	if (!error)
+	{
+		artChildCount[node] = count;
+		tag.SetNumber("cachedChildCount", (double)count);
+
+		size_t first = tree.Append(children.size());
+		size_t size = tree.Size();
+
+		art.resize(size, NULL);
+		bg.resize(size, NULL);
+		rect.resize(size);
+		bgRect.resize(size);
+		tags.resize(size);
+		isContainer.resize(size, false);
+		isAreaText.resize(size, false);
+		textKeys.resize(size);
+		artChildCount.resize(size, 0);
+
+		tree.SetChildren(node, first, children.size());
+
+		std::vector<PendingContainer> childContainers;
+
+		for (size_t i = 0; !error && i < children.size(); i++)
+		{
+			size_t childNode = first + i;
+			bool childIsContainer = IsContainerChild(children[i], names[i]);
+			double childWidth = 0.0;
+			double childHeight = 0.0;
+
+			error = ReadNode(childNode, children[i], childIsContainer, childWidth, childHeight);
+
+			// A baseline aligned child needs its first baseline, and so does the
+			// first child of a container whose baseline is needed
+			int alignment = tree.alignSelf[childNode] != kBlokAlignUnset ? tree.alignSelf[childNode] : alignItems;
+			bool childNeedsBaseline = (isRow && alignment == kBlokAlignBaseline) || (i == 0 && needsBaseline);
+
+			if (!error && childNeedsBaseline && !childIsContainer)
+			{
+				ReadBaseline(childNode);
+			}
+
+			if (!error && childIsContainer)
+			{
+				PendingContainer container = { childNode, childWidth, childHeight, childNeedsBaseline, false, false };
+				childContainers.push_back(container);
+			}
+
+			if (!error)
+			{
+				// A child container's own dims are set once it's captured, so it
+				// also remembers which ones to free afterwards
+				PendingContainer* container = childIsContainer ? &childContainers.back() : NULL;
+
+				// If even a single child is set to stretch, we must lay out with a
+				// fixed cross dim, otherwise the child has nothing to stretch in
+				int alignSelf = tree.alignSelf[childNode];
+
+				if (alignSelf == kBlokAlignStretch ||
+					(alignItems == kBlokAlignStretch && alignSelf == kBlokAlignUnset))
+				{
+					if (isRow)
+					{
+						tree.styleHeight[node] = height;
+						FreeHeight(childNode, container);
+					}
+					else
+					{
+						tree.styleWidth[node] = width;
+						FreeWidth(childNode, container);
+					}
+				}
+
+				if (tree.flex[childNode] > 0.0)
+				{
+					if (isRow)
+					{
+						tree.styleWidth[node] = width;
+						FreeWidth(childNode, container);
+					}
+					else
+					{
+						tree.styleHeight[node] = height;
+						FreeHeight(childNode, container);
+					}
+				}
+			}
+		}
+
+		if (!error)
+		{
+			pending.insert(pending.end(), childContainers.rbegin(), childContainers.rend());
+		}
+	}
+
+	return error;
+}
+
+/** Let a child size itself along the width, now or once it's captured */
+void BlokSnapshot::FreeWidth(size_t node, PendingContainer* container)
+{
+	tree.styleWidth[node] = kUndefined;
+
+	if (container)
+	{
+		container->isWidthFreed = true;
+	}
+}
+
+/** Let a child size itself along the height, now or once it's captured */
+void BlokSnapshot::FreeHeight(size_t node, PendingContainer* container)
+{
+	tree.styleHeight[node] = kUndefined;
+
+	if (container)
+	{
+		container->isHeightFreed = true;
+	}
+}
+
+/**	Read the first baseline of a text leaf. Other art, and text that can't be
+	measured, is aligned by its bottom edge.
+*/
+void BlokSnapshot::ReadBaseline(size_t node)
+{
+	if (!textMeasurer || !BlokIsText(art[node]))
+	{
+		return;
+	}
+
+	AIReal baseline = 0.0;
+
+	// autoHeight text already has its key
+	if ((tree.isMeasured[node] || textMeasurer->GetKey(art[node], textKeys[node]) == kNoErr) &&
+		textMeasurer->GetBaseline(art[node], textKeys[node], -rect[node].top, baseline) == kNoErr)
+	{
+		tree.styleBaseline[node] = baseline;
+	}
+}
+
+void BlokSnapshot::AttachMeasure()
+{
+	tree.measure = measuredCount > 0 ? MeasureText : NULL;
+	tree.measureContext = this;
+}
+
+/**	BlokMeasureFunc for autoHeight area text. Text that can't be measured
+	keeps the height it has.
+*/
+void BlokSnapshot::MeasureText(void* context, size_t node, double width, double& measuredWidth, double& measuredHeight)
+{
+	BlokSnapshot* snapshot = (BlokSnapshot*)context;
+	AIReal height = snapshot->rect[node].height;
+
+	// Area text doesn't have a natural width, it wraps to whatever it's given
+	measuredWidth = std::isnan(width) ? snapshot->rect[node].width : width;
+
+	if (snapshot->textMeasurer->Measure(snapshot->art[node], snapshot->textKeys[node], measuredWidth, height) != kNoErr)
+	{
+		height = snapshot->rect[node].height;
+	}
+
+	measuredHeight = height;
+}
@@ -0,0 +1,135 @@
+#ifndef __BlokSnapshot_h__
+#define __BlokSnapshot_h__
+
+#include "IllustratorSDK.h"
+#include "BlokArt.h"
+#include "BlokLayout.h"
+#include "BlokTag.h"
+#include "BlokText.h"
+
+#include <string>
+#include <vector>
+
+/**	Everything needed to lay out one root BlokContainer without touching
+	Illustrator again. Capture() runs on the main thread and builds the same
+	style tree BlokContainer.computeCssNode() would, after which tree can be
+	solved on any thread.
+
+	Per-node arrays line up with the nodes of tree.
+*/
+struct BlokSnapshot
+{
+	BlokSnapshot();
+
+	/** Root container this snapshot was taken from */
+	AIArtHandle root;
+
+	/** Style input and layout output */
+	BlokLayoutTree tree;
+
+	/** The art behind each node */
+	std::vector<AIArtHandle> art;
+
+	/** The .bg of each container node, NULL if it doesn't have one */
+	std::vector<AIArtHandle> bg;
+
+	/** Bounds of each node's art and .bg at capture time, what BlokApplier diffs against */
+	std::vector<BlokRect> rect;
+	std::vector<BlokRect> bgRect;
+
+	/** Saved properties of each node, including any changes capturing made */
+	std::vector<BlokTagData> tags;
+
+	/** True for BlokContainer nodes */
+	std::vector<bool> isContainer;
+
+	/** True for Bloks that are area text, which resize through their text path */
+	std::vector<bool> isAreaText;
+
+	/** For text that's measured or baseline aligned, what ATE measures it by */
+	std::vector<BlokTextKey> textKeys;
+
+	/** Number of nodes tree measures through textMeasurer */
+	size_t measuredCount;
+
+	/** Measures autoHeight area text, NULL to leave it at its current height */
+	BlokTextMeasurer* textMeasurer;
+
+	/** Number of art children of each container, .bg included (pageItems.length) */
+	std::vector<size_t> artChildCount;
+
+	/**	False if the tree uses something we can't lay out natively yet, in which
+		case the caller should fall back to BlokContainer.invalidate().
+	*/
+	bool supported;
+
+	/**	A container the user is resizing, laid out as if it were overrideWidth
+		by overrideHeight instead of its current size, like the overrideWidth
+		and overrideHeight saved properties. Set before capturing, NULL for none.
+	*/
+	AIArtHandle overrideArt;
+	double overrideWidth;
+	double overrideHeight;
+
+	/**	Walk a root container and build its tree.
+	@param rootArt IN a root BlokContainer.
+	@param measurer IN measures autoHeight area text, NULL to treat it like any other Blok.
+	@return kNoErr on success, other AIErr otherwise. An unsupported tree is not an error.
+	*/
+	AIErr Capture(AIArtHandle rootArt, BlokTextMeasurer* measurer = NULL);
+
+	/**	Same as Capture(), a container at a time so it can be spread over
+		several calls. BeginCapture() reads the root, then call CaptureNext()
+		until IsCaptured(). Capturing only reads the art, the tag changes it
+		makes are kept in tags until BlokApplier::SaveTags().
+	@param rootArt IN a root BlokContainer.
+	@param measurer IN measures autoHeight area text, NULL to treat it like any other Blok.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr BeginCapture(AIArtHandle rootArt, BlokTextMeasurer* measurer = NULL);
+
+	/**	Capture the children of the next container waiting.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr CaptureNext();
+
+	/** True once every container's children are captured */
+	bool IsCaptured() const { return pending.empty(); }
+
+	/**	Point tree's measure function at this snapshot. Call once the snapshot
+		won't move in memory anymore. Measuring calls into Illustrator, so a
+		tree with measuredCount > 0 has to be solved on the main thread, and
+		it can stretch frames and put them back, see BlokTextMeasurer::Measure().
+	*/
+	void AttachMeasure();
+
+private:
+	/** A container whose children haven't been captured yet */
+	struct PendingContainer
+	{
+		size_t node;
+
+		/** Dims the container would hand its parent, from ReadNode() */
+		double width;
+		double height;
+
+		bool needsBaseline;
+
+		/** True if the parent has it size itself along that axis */
+		bool isWidthFreed;
+		bool isHeightFreed;
+	};
+
+	// Containers left to capture, the next one is at the back
+	std::vector<PendingContainer> pending;
+
+	static void MeasureText(void* context, size_t node, double width, double& measuredWidth, double& measuredHeight);
+
+	AIErr ReadNode(size_t node, AIArtHandle nodeArt, bool container, double& width, double& height);
+	AIErr CaptureChildren(size_t node, double width, double height, bool needsBaseline);
+	void ReadBaseline(size_t node);
+	void FreeWidth(size_t node, PendingContainer* container);
+	void FreeHeight(size_t node, PendingContainer* container);
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "IllustratorSDK.h"
+#include "BlokSpacers.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+#include <chrono>
+#include <locale>
+#include <sstream>
+#include <vector>
+
+typedef std::chrono::steady_clock BlokClock;
+
+BlokSpacerStats::BlokSpacerStats() :
+	spacers(0),
+	changed(0),
+	skipped(0),
+	isRebuilt(false),
+	milliseconds(0.0)
+{
+}
+
+std::string BlokSpacerStats::ToJSON() const
+{
+	std::ostringstream json;
+	json.imbue(std::locale::classic());
+
+	json << "{\"spacers\":" << spacers
+		<< ",\"changed\":" << changed
+		<< ",\"skipped\":" << skipped
+		<< ",\"rebuilt\":" << (isRebuilt ? "true" : "false")
+		<< ",\"ms\":" << milliseconds
+		<< "}";
+
+	return json.str();
+}
+
+bool BlokIsSpacer(AIArtHandle art)
+{
+	std::string name;
+	short type = kUnknownArt;
+
+	if (BlokGetArtName(art, name) != kNoErr)
+	{
+		return false;
+	}
+
+	if (name.empty() && sAIArt->GetArtType(art, &type) == kNoErr && type == kSymbolArt)
+	{
+		// Unnamed instances go by their symbol's name
+		AIPatternHandle symbol = NULL;
+		ai::UnicodeString symbolName;
+
+		if (sAISymbol->GetSymbolPatternOfSymbolArt(art, &symbol) == kNoErr &&
+			sAISymbol->GetSymbolPatternName(symbol, symbolName) == kNoErr)
+		{
+			name = symbolName.as_UTF8();
+		}
+	}
+
+	return BlokIsKeyInString(name, ".spacer");
+}
+
+/**	Whether Illustrator will let us change art, so we don't have to try it
+	and see. Art is off limits when it, one of its parents or its layer is
+	locked, or when it's outside the art being edited in Isolation Mode.
+*/
+static bool IsEditable(AIArtHandle art, bool isIsolated)
+{
+	AILayerHandle layer = NULL;
+	AIBoolean isLayerEditable = false;
+
+	if (sAIArt->GetLayerOfArt(art, &layer) != kNoErr || !layer ||
+		sAILayer->GetLayerEditable(layer, &isLayerEditable) != kNoErr || !isLayerEditable)
+	{
+		return false;
+	}
+
+	if (isIsolated)
+	{
+		AIArtHandle layerGroup = NULL;
+
+		if (sAIArt->GetFirstArtOfLayer(layer, &layerGroup) != kNoErr ||
+			sAIIsolationMode->IsNonIsolatedLayer(layerGroup))
+		{
+			return false;
+		}
+	}
+
+	while (art)
+	{
+		ai::int32 attr = 0;
+		AIArtHandle parent = NULL;
+
+		if (sAIArt->GetArtUserAttr(art, kArtLocked, &attr) != kNoErr || (attr & kArtLocked) ||
+			sAIArt->GetArtParent(art, &parent) != kNoErr)
+		{
+			return false;
+		}
+
+		art = parent;
+	}
+
+	return true;
+}
+
+void BlokSpacerIndex::Update(const ai::ArtObjectsChangedNotifierData& data)
+{
+	if (!fIsValid)
+	{
+		return;
+	}
+
+	AIDocumentHandle document = NULL;
+
+	if (sAIDocument->GetDocument(&document) != kNoErr || document != fDocument)
+	{
+		// Changes to some other document. Start over when we're next needed
+		Invalidate();
+		return;
+	}
+
+	const ai::ArtObjectsChangedData& changes = data.artObjsChangedData;
+
+	for (size_t i = 0; i < changes.removedObjList.GetCount(); i++)
+	{
+		fSpacers.erase(changes.removedObjList[i]);
+	}
+
+	// Inserted art might be a spacer, modified art might have been renamed
+	for (size_t i = 0; i < changes.insertedObjList.GetCount(); i++)
+	{
+		Refresh(changes.insertedObjList[i]);
+	}
+
+	for (size_t i = 0; i < changes.modifiedObjList.GetCount(); i++)
+	{
+		Refresh(changes.modifiedObjList[i]);
+	}
+}
+
+void BlokSpacerIndex::Invalidate()
+{
+	fSpacers.clear();
+	fDocument = NULL;
+	fIsValid = false;
+}
+
+void BlokSpacerIndex::DocumentClosed()
+{
+	if (fDocument && !BlokIsDocumentOpen(fDocument))
+	{
+		Invalidate();
+	}
+}
+
+AIErr BlokSpacerIndex::SetOpacity(AIReal opacity, BlokSpacerStats& stats)
+{
+	BlokClock::time_point start = BlokClock::now();
+	AIDocumentHandle document = NULL;
+
+	AIErr error = sAIDocument->GetDocument(&document);
+
+	if (!error && (!fIsValid || document != fDocument))
+	{
+		error = Rebuild(document);
+		stats.isRebuilt = true;
+	}
+
+	// Resolve every uuid before touching anything
+	std::vector<AIArtHandle> spacers;
+
+	if (!error)
+	{
+		std::vector<ai::uuid> stale;
+		spacers.reserve(fSpacers.size());
+
+		for (std::set<ai::uuid>::const_iterator it = fSpacers.begin(); it != fSpacers.end(); ++it)
+		{
+			AIArtHandle art = NULL;
+
+			if (sAIUUID->GetArtHandle(*it, art) == kNoErr && art)
+			{
+				spacers.push_back(art);
+			}
+			else
+			{
+				stale.push_back(*it);
+			}
+		}
+
+		for (size_t i = 0; i < stale.size(); i++)
+		{
+			fSpacers.erase(stale[i]);
+		}
+	}
+
+	if (!error)
+	{
+		bool isIsolated = sAIIsolationMode->IsInIsolationMode() ? true : false;
+
+		for (size_t i = 0; !error && i < spacers.size(); i++)
+		{
+			if (!IsEditable(spacers[i], isIsolated))
+			{
+				// That's OK. The user can unlock it or exit Isolation Mode and try again
+				stats.skipped++;
+			}
+			else if (sAIBlendStyle->GetOpacity(spacers[i]) != opacity)
+			{
+				error = sAIBlendStyle->SetOpacity(spacers[i], opacity);
+				stats.changed++;
+			}
+		}
+
+		stats.spacers = spacers.size();
+	}
+
+	stats.milliseconds = std::chrono::duration<double, std::milli>(BlokClock::now() - start).count();
+
+	return error;
+}
+
+AIErr BlokSpacerIndex::Rebuild(AIDocumentHandle document)
+{
+	Invalidate();
+
+	AIMatchingArtSpec spec(kAnyArt, 0, 0);
+	AIArtHandle** matches = NULL;
+	ai::int32 numMatches = 0;
+
+	AIErr error = sAIMatchingArt->GetMatchingArt(&spec, 1, &matches, &numMatches);
+
+	if (!error)
+	{
+		for (ai::int32 i = 0; i < numMatches; i++)
+		{
+			AIArtHandle art = (*matches)[i];
+			ai::uuid uuid;
+
+			if (BlokIsSpacer(art) && sAIUUID->GetArtUUID(art, uuid) == kNoErr)
+			{
+				fSpacers.insert(uuid);
+			}
+		}
+
+		if (matches)
+		{
+			sAIMdMemory->MdMemoryDisposeHandle((AIMdMemoryHandle)matches);
+		}
+
+		fDocument = document;
+		fIsValid = true;
+	}
+
+	return error;
+}
+
+void BlokSpacerIndex::Refresh(const ai::uuid& uuid)
+{
+	AIArtHandle art = NULL;
+
+	if (sAIUUID->GetArtHandle(uuid, art) == kNoErr && art && BlokIsSpacer(art))
+	{
+		fSpacers.insert(uuid);
+	}
+	else
+	{
+		fSpacers.erase(uuid);
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef __BlokSpacers_h__
+#define __BlokSpacers_h__
+
+#include "IllustratorSDK.h"
+#include "AIUUID.h"
+
+#include <set>
+#include <string>
+
+/** What a show/hide pass did */
+struct BlokSpacerStats
+{
+	BlokSpacerStats();
+
+	/** Art named .spacer in the document */
+	size_t spacers;
+
+	/** Spacers whose opacity was changed, the rest already had it */
+	size_t changed;
+
+	/** Spacers left alone because they can't be edited, like locked art or
+		art outside of Isolation Mode */
+	size_t skipped;
+
+	/** True if the whole document had to be scanned first */
+	bool isRebuilt;
+
+	double milliseconds;
+
+	/** Serialize for the ExtendScript side */
+	std::string ToJSON() const;
+};
+
+/**	Every piece of art named .spacer in the current document, by uuid. It's
+	built by scanning the document once and kept up to date from
+	kAIArtObjectsChangedNotifier, so showing or hiding spacers never has to
+	look at the rest of the art.
+
+	Only call from the main thread.
+*/
+class BlokSpacerIndex
+{
+public:
+	BlokSpacerIndex() : fDocument(NULL), fIsValid(false) {}
+
+	/**	Keep up with art that was added, removed, renamed or otherwise changed.
+		Does nothing until the index has been built.
+	@param data IN from kAIArtObjectsChangedNotifier.
+	*/
+	void Update(const ai::ArtObjectsChangedNotifierData& data);
+
+	/** Forget everything, the next SetOpacity() scans the document again */
+	void Invalidate();
+
+	/** Invalidate() if the index is for a document that was just closed */
+	void DocumentClosed();
+
+	/**	Set the opacity of every spacer that can be edited, in one pass.
+		Editability is checked up front instead of waiting for Illustrator
+		to refuse.
+	@param opacity IN 0.0 to 1.0.
+	@param stats OUT what was changed and skipped.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr SetOpacity(AIReal opacity, BlokSpacerStats& stats);
+
+private:
+	AIErr Rebuild(AIDocumentHandle document);
+	void Refresh(const ai::uuid& uuid);
+
+	std::set<ai::uuid> fSpacers;
+	AIDocumentHandle fDocument;
+	bool fIsValid;
+};
+
+/**	True for art named .spacer, or an instance of a symbol named .spacer,
+	like changeSpacerOpacity() in index.ts looked for.
+*/
+bool BlokIsSpacer(AIArtHandle art);
+
+#endif
@@ -0,0 +1,215 @@
+#include "IllustratorSDK.h"
+#include "BlokSymbols.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+void BlokSymbolIndex::Update(const ai::ArtObjectsChangedNotifierData& data)
+{
+	if (!IsCurrent())
+	{
+		return;
+	}
+
+	const ai::ArtObjectsChangedData& changes = data.artObjsChangedData;
+
+	for (size_t i = 0; i < changes.removedObjList.GetCount(); i++)
+	{
+		Remove(changes.removedObjList[i]);
+	}
+
+	// Modified instances might point at another symbol now
+	for (size_t i = 0; i < changes.insertedObjList.GetCount(); i++)
+	{
+		Refresh(changes.insertedObjList[i]);
+	}
+
+	for (size_t i = 0; i < changes.modifiedObjList.GetCount(); i++)
+	{
+		Refresh(changes.modifiedObjList[i]);
+	}
+}
+
+void BlokSymbolIndex::Update(const AISymbolSetChangeNotifierData& data)
+{
+	if (!IsCurrent())
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < data.count; i++)
+	{
+		if (data.changeTypes[i] == kSymbolDeleted)
+		{
+			// Its instances were expanded or removed along with it
+			std::map<AIPatternHandle, std::set<ai::uuid> >::iterator found = fInstances.find(data.changedSymbols[i]);
+
+			if (found != fInstances.end())
+			{
+				for (std::set<ai::uuid>::const_iterator it = found->second.begin(); it != found->second.end(); ++it)
+				{
+					fSymbols.erase(*it);
+				}
+
+				fInstances.erase(found);
+			}
+		}
+	}
+}
+
+void BlokSymbolIndex::Invalidate()
+{
+	fInstances.clear();
+	fSymbols.clear();
+	fDocument = NULL;
+	fIsValid = false;
+}
+
+void BlokSymbolIndex::DocumentClosed()
+{
+	if (fDocument && !BlokIsDocumentOpen(fDocument))
+	{
+		Invalidate();
+	}
+}
+
+AIErr BlokSymbolIndex::GetInstances(AIPatternHandle symbol, std::vector<AIArtHandle>& instances)
+{
+	AIDocumentHandle document = NULL;
+	instances.clear();
+
+	AIErr error = sAIDocument->GetDocument(&document);
+
+	if (!error && (!fIsValid || document != fDocument))
+	{
+		error = Rebuild(document);
+	}
+
+	if (!error)
+	{
+		std::map<AIPatternHandle, std::set<ai::uuid> >::iterator found = fInstances.find(symbol);
+
+		if (found != fInstances.end())
+		{
+			std::vector<ai::uuid> stale;
+
+			for (std::set<ai::uuid>::const_iterator it = found->second.begin(); it != found->second.end(); ++it)
+			{
+				AIArtHandle art = NULL;
+
+				if (sAIUUID->GetArtHandle(*it, art) == kNoErr && art)
+				{
+					instances.push_back(art);
+				}
+				else
+				{
+					stale.push_back(*it);
+				}
+			}
+
+			for (size_t i = 0; i < stale.size(); i++)
+			{
+				Remove(stale[i]);
+			}
+		}
+	}
+
+	return error;
+}
+
+AIErr BlokSymbolIndex::Rebuild(AIDocumentHandle document)
+{
+	Invalidate();
+
+	AIMatchingArtSpec spec(kSymbolArt, 0, 0);
+	AIArtHandle** matches = NULL;
+	ai::int32 numMatches = 0;
+
+	AIErr error = sAIMatchingArt->GetMatchingArt(&spec, 1, &matches, &numMatches);
+
+	if (!error)
+	{
+		for (ai::int32 i = 0; i < numMatches; i++)
+		{
+			AIArtHandle art = (*matches)[i];
+			AIPatternHandle symbol = NULL;
+			ai::uuid uuid;
+
+			if (sAISymbol->GetSymbolPatternOfSymbolArt(art, &symbol) == kNoErr &&
+				sAIUUID->GetArtUUID(art, uuid) == kNoErr)
+			{
+				fInstances[symbol].insert(uuid);
+				fSymbols[uuid] = symbol;
+			}
+		}
+
+		if (matches)
+		{
+			sAIMdMemory->MdMemoryDisposeHandle((AIMdMemoryHandle)matches);
+		}
+
+		fDocument = document;
+		fIsValid = true;
+	}
+
+	return error;
+}
+
+void BlokSymbolIndex::Refresh(const ai::uuid& uuid)
+{
+	AIArtHandle art = NULL;
+	short type = kUnknownArt;
+	AIPatternHandle symbol = NULL;
+
+	Remove(uuid);
+
+	if (sAIUUID->GetArtHandle(uuid, art) == kNoErr && art &&
+		sAIArt->GetArtType(art, &type) == kNoErr && type == kSymbolArt &&
+		sAISymbol->GetSymbolPatternOfSymbolArt(art, &symbol) == kNoErr)
+	{
+		fInstances[symbol].insert(uuid);
+		fSymbols[uuid] = symbol;
+	}
+}
+
+void BlokSymbolIndex::Remove(const ai::uuid& uuid)
+{
+	std::map<ai::uuid, AIPatternHandle>::iterator found = fSymbols.find(uuid);
+
+	if (found != fSymbols.end())
+	{
+		std::map<AIPatternHandle, std::set<ai::uuid> >::iterator instances = fInstances.find(found->second);
+
+		if (instances != fInstances.end())
+		{
+			instances->second.erase(uuid);
+
+			if (instances->second.empty())
+			{
+				fInstances.erase(instances);
+			}
+		}
+
+		fSymbols.erase(found);
+	}
+}
+
+/** True if the index is built and for the current document. If it's for
+	another one, it's thrown away */
+bool BlokSymbolIndex::IsCurrent()
+{
+	if (!fIsValid)
+	{
+		return false;
+	}
+
+	AIDocumentHandle document = NULL;
+
+	if (sAIDocument->GetDocument(&document) != kNoErr || document != fDocument)
+	{
+		// Changes to some other document. Start over when we're next needed
+		Invalidate();
+		return false;
+	}
+
+	return true;
+}
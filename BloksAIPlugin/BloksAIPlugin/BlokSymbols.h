@@ -0,0 +1,63 @@
+#ifndef __BlokSymbols_h__
+#define __BlokSymbols_h__
+
+#include "IllustratorSDK.h"
+#include "AIUUID.h"
+#include "AISymbol.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+/**	Every symbol instance in the current document, grouped by symbol, so the
+	Bloks that wrap a symbol can be found without looking at any other
+	instance. It's built by scanning the document once. Instances that are
+	placed, removed or swapped to another symbol are tracked through
+	kAIArtObjectsChangedNotifier, and deleted symbols through
+	kAIArtSymbolSetDetailedChangeNotifier.
+
+	Only call from the main thread.
+*/
+class BlokSymbolIndex
+{
+public:
+	BlokSymbolIndex() : fDocument(NULL), fIsValid(false) {}
+
+	/**	Keep up with instances that were added, removed or changed. Does
+		nothing until the index has been built.
+	@param data IN from kAIArtObjectsChangedNotifier.
+	*/
+	void Update(const ai::ArtObjectsChangedNotifierData& data);
+
+	/**	Keep up with symbols that were deleted. Does nothing until the index
+		has been built.
+	@param data IN from kAIArtSymbolSetDetailedChangeNotifier.
+	*/
+	void Update(const AISymbolSetChangeNotifierData& data);
+
+	/** Forget everything, the next GetInstances() scans the document again */
+	void Invalidate();
+
+	/** Invalidate() if the index is for a document that was just closed */
+	void DocumentClosed();
+
+	/**	Every instance of symbol in the current document.
+	@param symbol IN the symbol.
+	@param instances OUT its instances, cleared first.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr GetInstances(AIPatternHandle symbol, std::vector<AIArtHandle>& instances);
+
+private:
+	AIErr Rebuild(AIDocumentHandle document);
+	void Refresh(const ai::uuid& uuid);
+	void Remove(const ai::uuid& uuid);
+	bool IsCurrent();
+
+	std::map<AIPatternHandle, std::set<ai::uuid> > fInstances;
+	std::map<ai::uuid, AIPatternHandle> fSymbols;
+	AIDocumentHandle fDocument;
+	bool fIsValid;
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include "BlokTag.h"
+
+#include <cmath>
+#include <locale>
+#include <sstream>
+
+static void SkipWhitespace(const char*& p)
+{
+	while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+	{
+		p++;
+	}
+}
+
+/** Advance past a JSON string, p must point at the opening quote */
+static bool SkipString(const char*& p)
+{
+	if (*p != '"')
+	{
+		return false;
+	}
+
+	p++;
+
+	while (*p && *p != '"')
+	{
+		if (*p == '\\' && p[1])
+		{
+			p++;
+		}
+
+		p++;
+	}
+
+	if (*p != '"')
+	{
+		return false;
+	}
+
+	p++;
+	return true;
+}
+
+/** Advance past any JSON value. Nested objects and arrays are skipped whole */
+static bool SkipValue(const char*& p)
+{
+	if (*p == '"')
+	{
+		return SkipString(p);
+	}
+	else if (*p == '{' || *p == '[')
+	{
+		int depth = 0;
+
+		while (*p)
+		{
+			if (*p == '"')
+			{
+				if (!SkipString(p))
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			if (*p == '{' || *p == '[')
+			{
+				depth++;
+			}
+			else if (*p == '}' || *p == ']')
+			{
+				depth--;
+
+				if (depth == 0)
+				{
+					p++;
+					return true;
+				}
+			}
+
+			p++;
+		}
+
+		return false;
+	}
+	else
+	{
+		const char* start = p;
+
+		while (*p && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		{
+			p++;
+		}
+
+		return p != start;
+	}
+}
+
+BlokTagData::BlokTagData() : fDirty(false)
+{
+}
+
+bool BlokTagData::Parse(const char* json)
+{
+	fProperties.clear();
+	fDirty = false;
+
+	if (!json || !*json)
+	{
+		return true;
+	}
+
+	const char* p = json;
+	SkipWhitespace(p);
+
+	if (*p != '{')
+	{
+		return false;
+	}
+
+	p++;
+	SkipWhitespace(p);
+
+	while (*p && *p != '}')
+	{
+		const char* keyStart = p;
+
+		if (!SkipString(p))
+		{
+			fProperties.clear();
+			return false;
+		}
+
+		std::string key(keyStart + 1, p - 1);
+
+		SkipWhitespace(p);
+
+		if (*p != ':')
+		{
+			fProperties.clear();
+			return false;
+		}
+
+		p++;
+		SkipWhitespace(p);
+
+		const char* valueStart = p;
+
+		if (!SkipValue(p))
+		{
+			fProperties.clear();
+			return false;
+		}
+
+		fProperties.push_back(std::make_pair(key, std::string(valueStart, p)));
+
+		SkipWhitespace(p);
+
+		if (*p == ',')
+		{
+			p++;
+			SkipWhitespace(p);
+		}
+	}
+
+	return true;
+}
+
+std::string BlokTagData::Serialize() const
+{
+	std::string json = "{";
+
+	for (size_t i = 0; i < fProperties.size(); i++)
+	{
+		if (i > 0)
+		{
+			json += ",";
+		}
+
+		json += "\"" + fProperties[i].first + "\":" + fProperties[i].second;
+	}
+
+	json += "}";
+
+	return json;
+}
+
+const std::string* BlokTagData::Find(const char* name) const
+{
+	for (size_t i = 0; i < fProperties.size(); i++)
+	{
+		if (fProperties[i].first == name)
+		{
+			return &fProperties[i].second;
+		}
+	}
+
+	return NULL;
+}
+
+bool BlokTagData::Has(const char* name) const
+{
+	const std::string* raw = Find(name);
+	return raw && *raw != "null";
+}
+
+bool BlokTagData::GetNumber(const char* name, double& value) const
+{
+	const std::string* raw = Find(name);
+
+	if (!raw || raw->empty() || (*raw)[0] == '"' || *raw == "null" || *raw == "true" || *raw == "false")
+	{
+		return false;
+	}
+
+	// Not strtod, which respects the user's locale decimal separator
+	std::istringstream stream(*raw);
+	stream.imbue(std::locale::classic());
+	stream >> value;
+
+	return !stream.fail();
+}
+
+bool BlokTagData::GetBoolean(const char* name, bool& value) const
+{
+	const std::string* raw = Find(name);
+
+	if (raw && (*raw == "true" || *raw == "false"))
+	{
+		value = *raw == "true";
+		return true;
+	}
+
+	return false;
+}
+
+bool BlokTagData::GetString(const char* name, std::string& value) const
+{
+	const std::string* raw = Find(name);
+
+	if (!raw || raw->size() < 2 || (*raw)[0] != '"')
+	{
+		return false;
+	}
+
+	value.clear();
+
+	for (size_t i = 1; i + 1 < raw->size(); i++)
+	{
+		char c = (*raw)[i];
+
+		if (c == '\\' && i + 2 < raw->size())
+		{
+			i++;
+			c = (*raw)[i];
+
+			switch (c)
+			{
+			case 'n': c = '\n'; break;
+			case 't': c = '\t'; break;
+			case 'r': c = '\r'; break;
+			default: break;
+			}
+		}
+
+		value += c;
+	}
+
+	return true;
+}
+
+void BlokTagData::SetRaw(const char* name, const std::string& raw)
+{
+	for (size_t i = 0; i < fProperties.size(); i++)
+	{
+		if (fProperties[i].first == name)
+		{
+			if (fProperties[i].second != raw)
+			{
+				fProperties[i].second = raw;
+				fDirty = true;
+			}
+
+			return;
+		}
+	}
+
+	fProperties.push_back(std::make_pair(std::string(name), raw));
+	fDirty = true;
+}
+
+void BlokTagData::SetNumber(const char* name, double value)
+{
+	if (std::isnan(value) || std::isinf(value))
+	{
+		// Same as JSON2.stringify
+		SetRaw(name, "null");
+		return;
+	}
+
+	std::ostringstream stream;
+	stream.imbue(std::locale::classic());
+	stream.precision(15);
+	stream << value;
+
+	SetRaw(name, stream.str());
+}
+
+void BlokTagData::SetBoolean(const char* name, bool value)
+{
+	SetRaw(name, value ? "true" : "false");
+}
+
+void BlokTagData::SetString(const char* name, const std::string& value)
+{
+	std::string raw = "\"";
+
+	for (size_t i = 0; i < value.size(); i++)
+	{
+		char c = value[i];
+
+		if (c == '"' || c == '\\')
+		{
+			raw += '\\';
+		}
+
+		raw += c;
+	}
+
+	raw += "\"";
+
+	SetRaw(name, raw);
+}
+
+void BlokTagData::Remove(const char* name)
+{
+	for (size_t i = 0; i < fProperties.size(); i++)
+	{
+		if (fProperties[i].first == name)
+		{
+			fProperties.erase(fProperties.begin() + i);
+			fDirty = true;
+			return;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef __BlokTag_h__
+#define __BlokTag_h__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Name of the art tag that blok-adapter.ts stores every saved property in */
+#define kBlokTagName "BLOKS_data"
+
+/**	The saved properties of a Blok. blok-adapter.ts writes them with JSON2 as a
+	flat JSON object of numbers, strings and booleans. Keys keep their original
+	order so that round tripping through the plugin leaves the tag untouched
+	when nothing changed.
+*/
+class BlokTagData
+{
+public:
+	BlokTagData();
+
+	/**	Replace our contents with a parsed JSON object.
+	@param json IN flat JSON object, may be NULL or empty.
+	@return false if the string couldn't be parsed. The contents are cleared.
+	*/
+	bool Parse(const char* json);
+
+	/**	Write our contents back out as a JSON object.
+	*/
+	std::string Serialize() const;
+
+	/** True if a property has been set or removed since the last Parse */
+	bool IsDirty() const { return fDirty; }
+
+	bool Has(const char* name) const;
+	bool GetNumber(const char* name, double& value) const;
+	bool GetBoolean(const char* name, bool& value) const;
+	bool GetString(const char* name, std::string& value) const;
+
+	void SetNumber(const char* name, double value);
+	void SetBoolean(const char* name, bool value);
+	void SetString(const char* name, const std::string& value);
+
+	/** Equivalent to setting a property to undefined from TypeScript */
+	void Remove(const char* name);
+
+private:
+	const std::string* Find(const char* name) const;
+	void SetRaw(const char* name, const std::string& raw);
+
+	// Pairs of key and raw JSON value
+	std::vector<std::pair<std::string, std::string>> fProperties;
+	bool fDirty;
+};
+
+#endif
@@ -0,0 +1,439 @@
+#include "IllustratorSDK.h"
+#include "BlokText.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+#include "IText.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/** Height a frame is stretched to while measuring, so none of its text overflows */
+#define kBlokTextComposeHeight 10000.0
+
+/** Same mix as BlokLayout's subtree hash (FNV-1a a word at a time) */
+static inline uint64_t HashMix(uint64_t hash, uint64_t value)
+{
+	return (hash ^ value) * 0x100000001b3ull;
+}
+
+static inline uint64_t HashMix(uint64_t hash, double value)
+{
+	uint64_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	return HashMix(hash, bits);
+}
+
+/** Stands in for a feature that isn't assigned, the getter's value is meaningless then */
+#define kBlokTextUnassigned 0x9e3779b97f4a7c15ull
+
+static inline uint64_t HashValue(uint64_t hash, double value)
+{
+	return HashMix(hash, value);
+}
+
+static inline uint64_t HashValue(uint64_t hash, float value)
+{
+	return HashMix(hash, (double)value);
+}
+
+/** Integers, bools and enums */
+template <typename T>
+static inline uint64_t HashValue(uint64_t hash, T value)
+{
+	return HashMix(hash, (uint64_t)(int64_t)value);
+}
+
+/**	Mix in one of the features of ICharFeatures or IParaFeatures, only if
+	it's assigned.
+@param getter IN like &ATE::IParaFeatures::GetSpaceBefore.
+*/
+template <class Features, typename T>
+static inline uint64_t HashFeature(uint64_t hash, const Features& features, T (Features::*getter)(bool*) const)
+{
+	bool isAssigned = false;
+	T value = (features.*getter)(&isAssigned);
+
+	return isAssigned ? HashValue(hash, value) : HashMix(hash, (uint64_t)kBlokTextUnassigned);
+}
+
+/**	Mix in the font of a run by its PostScript name, which stays the same for
+	the same font where its ATE reference doesn't.
+*/
+static uint64_t HashFont(uint64_t hash, const ATE::ICharFeatures& features)
+{
+	bool isAssigned = false;
+	ATE::IFont font = features.GetFont(&isAssigned);
+	AIFontKey fontKey = NULL;
+	char name[256] = { 0 };
+
+	if (!isAssigned || font.IsNull() ||
+		sAIFont->FontKeyFromFont(font.GetRef(), &fontKey) != kNoErr ||
+		sAIFont->GetPostScriptFontName(fontKey, name, (ai::int16)sizeof(name)) != kNoErr)
+	{
+		return HashMix(hash, (uint64_t)kBlokTextUnassigned);
+	}
+
+	for (size_t i = 0; i < sizeof(name) && name[i]; i++)
+	{
+		hash = HashMix(hash, (uint64_t)(unsigned char)name[i]);
+	}
+
+	return hash;
+}
+
+AIErr BlokTextMeasurer::GetKey(AIArtHandle art, BlokTextKey& key) const
+{
+	TextFrameRef frameRef = NULL;
+	AIErr error = sAITextFrame->GetATETextFrame(art, &frameRef);
+
+	if (!error)
+	{
+		try
+		{
+			// The C++ wrapper takes over the reference
+			ATE::ITextFrame frame(frameRef);
+			ATE::ITextRange range = frame.GetTextRange();
+
+			// UTF-16 as ATE keeps it, every character counts, NULs included
+			std::vector<ATETextDOM::Unicode> text(range.GetSize() + 1, 0);
+			ATETextDOM::Int32 length = range.GetContents(&text[0], (ATETextDOM::Int32)text.size());
+
+			key.contentHash = HashMix(0xcbf29ce484222325ull, (uint64_t)length);
+
+			for (ATETextDOM::Int32 i = 0; i < length && i < (ATETextDOM::Int32)text.size(); i++)
+			{
+				key.contentHash = HashMix(key.contentHash, (uint64_t)text[i]);
+			}
+
+			key.styleHash = HashMix(0xcbf29ce484222325ull, (double)frame.GetSpacing());
+
+			for (ATE::ITextRunsIterator runs = range.GetTextRunsIterator(); runs.IsNotDone(); runs.Next())
+			{
+				ATE::ITextRange run = runs.Item();
+				ATE::ICharFeatures features = run.GetUniqueCharFeatures();
+
+				key.styleHash = HashMix(key.styleHash, (uint64_t)run.GetSize());
+				key.styleHash = HashFont(key.styleHash, features);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::ICharFeatures::GetFontSize);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::ICharFeatures::GetAutoLeading);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::ICharFeatures::GetLeading);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::ICharFeatures::GetTracking);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::ICharFeatures::GetHorizontalScale);
+			}
+
+			// How lines break and stack counts as much as the characters
+			for (ATE::IParagraphsIterator paragraphs = range.GetParagraphsIterator(); paragraphs.IsNotDone(); paragraphs.Next())
+			{
+				ATE::ITextRange paragraph = paragraphs.Item().GetTextRange();
+				ATE::IParaFeatures features = paragraph.GetUniqueParaFeatures();
+
+				key.styleHash = HashMix(key.styleHash, (uint64_t)paragraph.GetSize());
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetJustification);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetSingleWordJustification);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetFirstLineIndent);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetStartIndent);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetEndIndent);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetSpaceBefore);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetSpaceAfter);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetAutoHyphenate);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetHyphenatedWordSize);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetPreHyphenSize);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetPostHyphenSize);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetConsecutiveHyphenLimit);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetHyphenationZone);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetHyphenateCapitalized);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetEveryLineComposer);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetMinWordSpacing);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetDesiredWordSpacing);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetMaxWordSpacing);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetMinLetterSpacing);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetDesiredLetterSpacing);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetMaxLetterSpacing);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetMinGlyphScaling);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetDesiredGlyphScaling);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetMaxGlyphScaling);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetAutoLeadingPercentage);
+				key.styleHash = HashFeature(key.styleHash, features, &ATE::IParaFeatures::GetLeadingType);
+			}
+		}
+		catch (ATE::Exception& ex)
+		{
+			error = ex.error;
+		}
+	}
+
+	return error;
+}
+
+AIErr BlokTextMeasurer::Measure(AIArtHandle art, const BlokTextKey& key, AIReal width, AIReal& height)
+{
+	uint64_t hash = HashMix(HashMix(key.contentHash, key.styleHash), (double)width);
+	std::unordered_map<uint64_t, Entry>::const_iterator found = fCache.find(hash);
+
+	if (found != fCache.end() &&
+		found->second.key.contentHash == key.contentHash &&
+		found->second.key.styleHash == key.styleHash &&
+		found->second.width == width)
+	{
+		height = found->second.height;
+		fHitCount++;
+		return kNoErr;
+	}
+
+	fMissCount++;
+
+	AIErr error = Compose(art, width, height);
+
+	if (!error)
+	{
+		if (fCache.size() >= kBlokTextCacheSize)
+		{
+			fCache.clear();
+		}
+
+		Entry entry = { key, width, height };
+		fCache[hash] = entry;
+	}
+
+	return error;
+}
+
+AIErr BlokTextMeasurer::GetBaseline(AIArtHandle art, const BlokTextKey& key, AIReal top, AIReal& baseline)
+{
+	uint64_t hash = HashMix(key.contentHash, key.styleHash);
+	std::unordered_map<uint64_t, Entry>::const_iterator found = fBaselines.find(hash);
+
+	if (found != fBaselines.end() &&
+		found->second.key.contentHash == key.contentHash &&
+		found->second.key.styleHash == key.styleHash)
+	{
+		baseline = found->second.height;
+		fHitCount++;
+		return kNoErr;
+	}
+
+	fMissCount++;
+
+	TextFrameRef frameRef = NULL;
+	AIErr error = sAITextFrame->GetATETextFrame(art, &frameRef);
+
+	if (!error)
+	{
+		try
+		{
+			ATE::ITextFrame frame(frameRef);
+			ATETextDOM::RealMatrix matrix = frame.GetMatrix();
+			ATE::ITextLinesIterator lines = frame.GetTextLinesIterator();
+
+			// No text, no baseline. Fall back to the bottom edge like other art
+			error = kBadParameterErr;
+
+			if (lines.IsNotDone())
+			{
+				ATE::IArrayLine baselines = lines.Item().GetBaselines();
+
+				if (baselines.GetSize() > 0)
+				{
+					ATETextDOM::FloatPoint start;
+					ATETextDOM::FloatPoint end;
+					baselines.Item(0, &start, &end);
+
+					baseline = top - (matrix.b * start.h + matrix.d * start.v + matrix.ty);
+					error = kNoErr;
+				}
+			}
+		}
+		catch (ATE::Exception& ex)
+		{
+			error = ex.error;
+		}
+	}
+
+	if (!error)
+	{
+		if (fBaselines.size() >= kBlokTextCacheSize)
+		{
+			fBaselines.clear();
+		}
+
+		// Only the key matters, the width is unused
+		Entry entry = { key, 0.0, baseline };
+		fBaselines[hash] = entry;
+	}
+
+	return error;
+}
+
+void BlokTextMeasurer::Clear()
+{
+	fCache.clear();
+	fBaselines.clear();
+	fHitCount = 0;
+	fMissCount = 0;
+	fEditCount = 0;
+}
+
+/**	How far below the top of its frame art's composed text reaches, plus the
+	frame's inset at the bottom.
+@param art IN area text.
+@param top IN top of the frame, in Illustrator's coordinates.
+@param height OUT height the frame needs.
+*/
+static AIErr GetComposedHeight(AIArtHandle art, AIReal top, AIReal& height)
+{
+	TextFrameRef frameRef = NULL;
+	AIErr error = sAITextFrame->GetATETextFrame(art, &frameRef);
+
+	if (!error)
+	{
+		try
+		{
+			ATE::ITextFrame frame(frameRef);
+			ATETextDOM::RealMatrix matrix = frame.GetMatrix();
+			AIReal bottom = top;
+
+			for (ATE::ITextLinesIterator lines = frame.GetTextLinesIterator(); lines.IsNotDone(); lines.Next())
+			{
+				ATE::ITextLine line = lines.Item();
+				ATE::IArrayLine baselines = line.GetBaselines();
+				AIReal descent = 0.0;
+
+				for (ATE::IGlyphRunsIterator runs = line.GetGlyphRunsIterator(); runs.IsNotDone(); runs.Next())
+				{
+					descent = std::max(descent, (AIReal)runs.Item().GetDescent());
+				}
+
+				for (ATETextDOM::Int32 i = 0; i < baselines.GetSize(); i++)
+				{
+					ATETextDOM::FloatPoint start;
+					ATETextDOM::FloatPoint end;
+					baselines.Item(i, &start, &end);
+
+					// Baselines are in the frame's space
+					AIReal y = matrix.b * start.h + matrix.d * start.v + matrix.ty;
+					bottom = std::min(bottom, y - descent);
+				}
+			}
+
+			height = top - bottom + frame.GetSpacing();
+		}
+		catch (ATE::Exception& ex)
+		{
+			error = ex.error;
+		}
+	}
+
+	return error;
+}
+
+/**	True if some of art's text doesn't fit in its frame, only what fits is composed.
+*/
+static AIErr IsOverset(AIArtHandle art, bool& isOverset)
+{
+	TextFrameRef frameRef = NULL;
+	AIErr error = sAITextFrame->GetATETextFrame(art, &frameRef);
+
+	if (!error)
+	{
+		try
+		{
+			ATE::ITextFrame frame(frameRef);
+			isOverset = frame.GetTextRange(false).GetSize() < frame.GetTextRange(true).GetSize();
+		}
+		catch (ATE::Exception& ex)
+		{
+			error = ex.error;
+		}
+	}
+
+	return error;
+}
+
+/**	Reflow art's text at width and see how tall it comes out. If the frame
+	already is that wide and all of its text fits, ATE's lines are read as
+	they are. Otherwise ATE has to compose it again, and it only composes
+	text inside the frame, so the frame is stretched to width and made very
+	tall first, then put back exactly as it was. That's an edit of the
+	document, counted in fEditCount so BlokEngine can keep it out of the
+	undo history.
+*/
+AIErr BlokTextMeasurer::Compose(AIArtHandle art, AIReal width, AIReal& height)
+{
+	AIArtHandle path = NULL;
+	ai::int16 count = 0;
+	std::vector<AIPathSegment> original;
+	AIRealRect bounds;
+	bool isOverset = true;
+
+	AIErr error = sAITextFrame->GetPathObject(art, &path);
+
+	if (!error)
+	{
+		error = sAIArt->GetArtBounds(path, &bounds);
+	}
+
+	if (!error && BlokNearlyEqual(bounds.right - bounds.left, width))
+	{
+		error = IsOverset(art, isOverset);
+	}
+
+	if (!error && !isOverset)
+	{
+		return GetComposedHeight(art, bounds.top, height);
+	}
+
+	if (!error && !fCanEdit)
+	{
+		error = kBadParameterErr;
+	}
+
+	if (!error)
+	{
+		error = sAIPath->GetPathSegmentCount(path, &count);
+	}
+
+	if (!error && count == 0)
+	{
+		error = kBadParameterErr;
+	}
+
+	if (!error)
+	{
+		original.resize(count);
+		error = sAIPath->GetPathSegments(path, 0, count, &original[0]);
+	}
+
+	if (!error)
+	{
+		AIReal currentWidth = bounds.right - bounds.left;
+		AIReal currentHeight = bounds.top - bounds.bottom;
+
+		// Scale about the top left, like the frame would be resized
+		AIRealMatrix matrix;
+		matrix.a = width / (currentWidth == 0.0 ? 1.0 : currentWidth);
+		matrix.b = 0.0;
+		matrix.c = 0.0;
+		matrix.d = kBlokTextComposeHeight / (currentHeight == 0.0 ? 1.0 : currentHeight);
+		matrix.tx = bounds.left - matrix.a * bounds.left;
+		matrix.ty = bounds.top - matrix.d * bounds.top;
+
+		std::vector<AIPathSegment> stretched(original);
+		BlokTransformPathSegments(stretched, matrix);
+
+		fEditCount++;
+		error = sAIPath->SetPathSegments(path, 0, count, &stretched[0]);
+
+		if (!error)
+		{
+			error = GetComposedHeight(art, bounds.top, height);
+
+			// Even if measuring failed, the frame has to go back
+			AIErr restoreError = sAIPath->SetPathSegments(path, 0, count, &original[0]);
+			error = error ? error : restoreError;
+		}
+	}
+
+	return error;
+}
@@ -0,0 +1,105 @@
+#ifndef __BlokText_h__
+#define __BlokText_h__
+
+#include "IllustratorSDK.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+/** Everything that decides how a text frame composes, apart from its width */
+struct BlokTextKey
+{
+	/** Hash of the characters */
+	uint64_t contentHash;
+
+	/**	Hash of the character styles of every run, the paragraph styles of
+		every paragraph (spacing, indents, hyphenation, composer and
+		justification), and the frame's inset
+	*/
+	uint64_t styleHash;
+};
+
+/** Most measurements BlokTextMeasurer remembers before starting over */
+#define kBlokTextCacheSize 4096
+
+/**	Measures text through ATE. Asking how tall a frame's text is at some
+	width means reflowing it, so every answer is remembered by the frame's
+	BlokTextKey and the width. Text that didn't change is never reflowed again,
+	no matter which frame it's in or how many passes ask. First baselines are
+	remembered by BlokTextKey alone.
+
+	Only call from the main thread.
+*/
+class BlokTextMeasurer
+{
+public:
+	BlokTextMeasurer() : fHitCount(0), fMissCount(0), fEditCount(0), fCanEdit(true) {}
+
+	/**	Read what decides how art's text composes. Cheap next to Measure(),
+		nothing is reflowed.
+	@param art IN point or area text.
+	@param key OUT hashes of its text and styles.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr GetKey(AIArtHandle art, BlokTextKey& key) const;
+
+	/**	The height art's frame needs to show all of its text at width,
+		including the frame's inset. Text that fits its frame at its current
+		width is read as it is. Any other width, or text that overflows, is
+		composed by stretching the frame and putting it back, which is an
+		edit of the document, see GetEditCount().
+	@param art IN area text.
+	@param key IN from GetKey().
+	@param width IN width of the frame.
+	@param height OUT height of the frame.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr Measure(AIArtHandle art, const BlokTextKey& key, AIReal width, AIReal& height);
+
+	/**	How far below the top of art its first line's baseline is, for
+		baseline alignment.
+	@param art IN point or area text.
+	@param key IN from GetKey().
+	@param top IN top of art, in Illustrator's coordinates.
+	@param baseline OUT distance from top to the first baseline.
+	@return kNoErr on success, other AIErr otherwise.
+	*/
+	AIErr GetBaseline(AIArtHandle art, const BlokTextKey& key, AIReal top, AIReal& baseline);
+
+	/** Forget every measurement */
+	void Clear();
+
+	/** Measurements answered from the cache, and ones that reflowed text, so far */
+	size_t GetHitCount() const { return fHitCount; }
+	size_t GetMissCount() const { return fMissCount; }
+
+	/** Number of times a frame was stretched and put back to measure it, so far */
+	size_t GetEditCount() const { return fEditCount; }
+
+	/**	Allow or forbid stretching frames to measure them. While forbidden,
+		Measure() only answers from the cache or for text that fits its
+		frame already, and fails for anything else.
+	@param canEdit IN false to never touch the document.
+	*/
+	void SetCanEdit(bool canEdit) { fCanEdit = canEdit; }
+
+private:
+	struct Entry
+	{
+		BlokTextKey key;
+		AIReal width;
+		AIReal height;
+	};
+
+	AIErr Compose(AIArtHandle art, AIReal width, AIReal& height);
+
+	std::unordered_map<uint64_t, Entry> fCache;
+	std::unordered_map<uint64_t, Entry> fBaselines;
+
+	size_t fHitCount;
+	size_t fMissCount;
+	size_t fEditCount;
+	bool fCanEdit;
+};
+
+#endif
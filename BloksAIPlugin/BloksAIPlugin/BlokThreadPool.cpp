@@ -0,0 +1,212 @@
+#include "BlokThreadPool.h"
+
+// Which pool and queue the current thread belongs to, if any
+static thread_local const BlokThreadPool* tPool = NULL;
+static thread_local size_t tQueueIndex = 0;
+
+BlokThreadPool::BlokThreadPool() : fQueued(0), fStopping(false)
+{
+}
+
+BlokThreadPool::~BlokThreadPool()
+{
+	Stop();
+}
+
+void BlokThreadPool::Start(size_t threadCount)
+{
+	if (!fWorkers.empty())
+	{
+		return;
+	}
+
+	if (threadCount == 0)
+	{
+		// The main thread always helps out, so leave a core for it
+		size_t cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 0;
+	}
+
+	fStopping = false;
+	fQueued = 0;
+	fQueues.clear();
+
+	for (size_t i = 0; i < threadCount + 1; i++)
+	{
+		fQueues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+	}
+
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		fWorkers.push_back(std::thread(&BlokThreadPool::WorkerMain, this, i + 1));
+	}
+}
+
+void BlokThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(fSleepMutex);
+		fStopping = true;
+	}
+
+	fWake.notify_all();
+
+	for (size_t i = 0; i < fWorkers.size(); i++)
+	{
+		fWorkers[i].join();
+	}
+
+	fWorkers.clear();
+	fQueues.clear();
+}
+
+size_t BlokThreadPool::GetQueueIndex() const
+{
+	return tPool == this ? tQueueIndex : 0;
+}
+
+bool BlokThreadPool::RunOne(size_t index)
+{
+	Task task;
+	bool found = false;
+	size_t queueCount = fQueues.size();
+
+	// Newest work from our own queue first, it's likely still in cache
+	{
+		TaskQueue& own = *fQueues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			fQueued--;
+			found = true;
+		}
+	}
+
+	// Then the oldest work from someone else, which tends to be the biggest
+	for (size_t i = 1; !found && i < queueCount; i++)
+	{
+		TaskQueue& victim = *fQueues[(index + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			fQueued--;
+			found = true;
+		}
+	}
+
+	if (found)
+	{
+		task.work();
+
+		if (--task.group->fPending == 0)
+		{
+			// Wake whoever is blocked in Wait() on the group, same pairing as in Spawn()
+			{
+				std::lock_guard<std::mutex> lock(fSleepMutex);
+			}
+
+			fWake.notify_all();
+		}
+	}
+
+	return found;
+}
+
+void BlokThreadPool::WorkerMain(size_t index)
+{
+	tPool = this;
+	tQueueIndex = index;
+
+	for (;;)
+	{
+		if (RunOne(index))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(fSleepMutex);
+		fWake.wait(lock, [this] { return fStopping || fQueued.load() > 0; });
+
+		if (fStopping && fQueued.load() == 0)
+		{
+			return;
+		}
+	}
+}
+
+void BlokThreadPool::Spawn(BlokTaskGroup& group, std::function<void()> task)
+{
+	if (fWorkers.empty())
+	{
+		task();
+		return;
+	}
+
+	group.fPending++;
+
+	{
+		TaskQueue& own = *fQueues[GetQueueIndex()];
+		std::lock_guard<std::mutex> lock(own.mutex);
+
+		Task queued;
+		queued.work = std::move(task);
+		queued.group = &group;
+
+		// Counted under the same lock it's taken under, so a thief can't see it first
+		fQueued++;
+		own.tasks.push_back(std::move(queued));
+	}
+
+	{
+		// Pairs with the wait in WorkerMain so the wake up can't be missed
+		std::lock_guard<std::mutex> lock(fSleepMutex);
+	}
+
+	fWake.notify_one();
+}
+
+void BlokThreadPool::Wait(BlokTaskGroup& group)
+{
+	size_t index = GetQueueIndex();
+
+	while (group.fPending.load() > 0)
+	{
+		// Help out first, the task we're waiting on may be behind others
+		if (!fQueues.empty() && RunOne(index))
+		{
+			continue;
+		}
+
+		// Everything left is running on other threads, sleep until it's done or there's more to take
+		std::unique_lock<std::mutex> lock(fSleepMutex);
+		fWake.wait(lock, [this, &group] { return group.fPending.load() == 0 || fQueued.load() > 0; });
+	}
+}
+
+void BlokThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 1 || fWorkers.empty())
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			body(i);
+		}
+
+		return;
+	}
+
+	BlokTaskGroup group;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		Spawn(group, [&body, i] { body(i); });
+	}
+
+	Wait(group);
+}
@@ -0,0 +1,103 @@
+#ifndef __BlokThreadPool_h__
+#define __BlokThreadPool_h__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**	A set of tasks that can be waited on together. Tasks may spawn more tasks
+	into the same group or into a group of their own.
+*/
+class BlokTaskGroup
+{
+public:
+	BlokTaskGroup() : fPending(0) {}
+
+private:
+	friend class BlokThreadPool;
+
+	std::atomic<size_t> fPending;
+};
+
+/**	A fixed set of worker threads for solving Blok trees. Work submitted here
+	must never call into Illustrator, workers don't have an AppContext.
+
+	Every thread has its own deque of tasks. A thread pushes and pops at the back
+	of its own deque and steals from the front of everyone else's when it runs
+	dry, so a task that spawns subtasks keeps working on its own part of the tree
+	while idle threads take the big pieces left over.
+*/
+class BlokThreadPool
+{
+public:
+	BlokThreadPool();
+	~BlokThreadPool();
+
+	/**	Spin up the workers. Safe to call more than once.
+	@param threadCount IN number of workers, 0 picks one less than the number of cores.
+	*/
+	void Start(size_t threadCount = 0);
+
+	/**	Join all workers. Any queued work is finished first.
+	*/
+	void Stop();
+
+	/**	Number of threads that can run work at once, including the calling thread.
+	*/
+	size_t GetConcurrency() const { return fWorkers.size() + 1; }
+
+	/**	Queue a task. If the pool isn't running the task runs immediately.
+	@param group IN group to account the task to, see Wait().
+	@param task IN work to run.
+	*/
+	void Spawn(BlokTaskGroup& group, std::function<void()> task);
+
+	/**	Run queued tasks on the calling thread until every task in group is done,
+		sleeping while the rest of the group runs on other threads.
+	@param group IN group to wait on.
+	*/
+	void Wait(BlokTaskGroup& group);
+
+	/**	Call body(i) for every i in [0, count), spread across the workers and the
+		calling thread. Blocks until every call has returned.
+	@param count IN number of work items.
+	@param body IN function to run for each item.
+	*/
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+	struct Task
+	{
+		std::function<void()> work;
+		BlokTaskGroup* group;
+	};
+
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void WorkerMain(size_t index);
+	size_t GetQueueIndex() const;
+	bool RunOne(size_t index);
+
+	std::vector<std::thread> fWorkers;
+
+	// Index 0 is shared by threads that aren't ours (the main thread), then one per worker
+	std::vector<std::unique_ptr<TaskQueue>> fQueues;
+
+	// Tasks sitting in some queue, only changed under that queue's mutex
+	std::atomic<size_t> fQueued;
+	std::mutex fSleepMutex;
+	std::condition_variable fWake;
+	bool fStopping;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "IllustratorSDK.h"
+#include "BlokUndo.h"
+#include "BlokArt.h"
+#include "BloksAIPluginSuites.h"
+
+BlokUndoMerger::BlokUndoMerger() :
+	fTags(0),
+	fLastDocument(NULL),
+	fIsInSession(false)
+{
+}
+
+ai::int32 BlokUndoMerger::BeginStep(const std::vector<AIArtHandle>& roots, bool canMerge)
+{
+	bool isMerged = false;
+
+	if (canMerge && fTags > 0 && IsOnTop(fTags))
+	{
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fLastTime).count();
+		bool isSameRoots = false;
+
+		for (size_t i = 0; !isSameRoots && i < roots.size(); i++)
+		{
+			isSameRoots = fLastRoots.count(roots[i]) > 0;
+		}
+
+		isMerged = fIsInSession || (isSameRoots && elapsedMs < kBlokUndoMergeMs);
+	}
+
+	if (isMerged)
+	{
+		sAIUndo->SetKind(kAIAppendUndoContext);
+	}
+	else
+	{
+		fLastRoots.clear();
+	}
+
+	fLastRoots.insert(roots.begin(), roots.end());
+	fLastTime = std::chrono::steady_clock::now();
+	sAIDocument->GetDocument(&fLastDocument);
+	fTags++;
+
+	sAIUndo->SetUndoTextUS(ai::UnicodeString("Undo Bloks Layout"), ai::UnicodeString("Redo Bloks Layout"));
+	sAIUndo->SetTagUS(ai::UnicodeString(kBlokUndoTag), fTags);
+
+	return fTags;
+}
+
+bool BlokUndoMerger::IsOnTop(ai::int32 tag) const
+{
+	return IsNthTagged(-1, tag);
+}
+
+bool BlokUndoMerger::IsUndone(ai::int32 tag) const
+{
+	return IsNthTagged(1, tag);
+}
+
+void BlokUndoMerger::Clear()
+{
+	fLastRoots.clear();
+	fIsInSession = false;
+
+	// Steps of a closed document can't match anymore
+	fTags++;
+}
+
+void BlokUndoMerger::DocumentClosed()
+{
+	if (fLastDocument && !BlokIsDocumentOpen(fLastDocument))
+	{
+		Clear();
+		fLastDocument = NULL;
+	}
+}
+
+/**	True if the nth undo step is tagged by us with tag, negative n counts
+	back from the last step done, positive forward through the ones undone.
+*/
+bool BlokUndoMerger::IsNthTagged(ai::int32 n, ai::int32 tag) const
+{
+	ai::int32 past = 0;
+	ai::int32 future = 0;
+	ai::UnicodeString tagString;
+	ai::int32 tagInteger = 0;
+
+	if (sAIUndo->CountTransactions(&past, &future) != kNoErr || (n < 0 ? past < -n : future < n))
+	{
+		return false;
+	}
+
+	return sAIUndo->GetNthTransactionTagUS(n, tagString, &tagInteger) == kNoErr &&
+		tagString == ai::UnicodeString(kBlokUndoTag) &&
+		tagInteger == tag;
+}
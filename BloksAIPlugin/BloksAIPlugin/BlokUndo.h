@@ -0,0 +1,77 @@
+#ifndef __BlokUndo_h__
+#define __BlokUndo_h__
+
+#include "IllustratorSDK.h"
+
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+/** Tags our undo steps, the tag's integer tells them apart */
+#define kBlokUndoTag "Bloks Layout"
+
+/** Milliseconds after a layout during which the next one of the same roots joins its undo step */
+#define kBlokUndoMergeMs 1000.0
+
+/**	Gives every relayout a single undo step named "Bloks Layout", and folds
+	relayouts that follow each other into one step. Typing values into the
+	panel lays out the same roots again on every change, which would
+	otherwise leave a step for each.
+
+	A step joins the one before it if that's still the last step of ours,
+	nothing else happened in between, and either it laid out some of the
+	same roots less than kBlokUndoMergeMs ago or the panel is in an edit
+	session.
+
+	Only call from the main thread, inside the AppContext of the changes.
+*/
+class BlokUndoMerger
+{
+public:
+	BlokUndoMerger();
+
+	/**	Name and tag the current undo context, appending it to the last step
+		if that's a layout it should merge with. Call before making changes.
+	@param roots IN root containers the changes are for.
+	@param canMerge IN false to always start a step of its own.
+	@return the step's tag integer, see IsOnTop().
+	*/
+	ai::int32 BeginStep(const std::vector<AIArtHandle>& roots, bool canMerge = true);
+
+	/**	True if a step we tagged is the last one, nothing was done since.
+	@param tag IN from BeginStep().
+	*/
+	bool IsOnTop(ai::int32 tag) const;
+
+	/**	True if a step we tagged was just undone, it's the first one redo would redo.
+	@param tag IN from BeginStep().
+	*/
+	bool IsUndone(ai::int32 tag) const;
+
+	/**	Start or end an edit session. While one is going, every relayout
+		merges with the one before it no matter how long ago it was.
+	@param isInSession IN true to start one.
+	*/
+	void SetSession(bool isInSession) { fIsInSession = isInSession; }
+
+	/** Forget the last step */
+	void Clear();
+
+	/** Clear() if the last step was in a document that was just closed */
+	void DocumentClosed();
+
+private:
+	bool IsNthTagged(ai::int32 n, ai::int32 tag) const;
+
+	// Last tag handed out, also the tag of the last step
+	ai::int32 fTags;
+
+	// When the last step was tagged, what it laid out and in which document
+	std::chrono::steady_clock::time_point fLastTime;
+	std::unordered_set<AIArtHandle> fLastRoots;
+	AIDocumentHandle fLastDocument;
+
+	bool fIsInSession;
+};
+
+#endif
@@ -4,9 +4,57 @@
 #include "SDKPlugPlug.h"
 #include "AICSXS.h"
 #include "AIMenuCommandNotifiers.h"
+#include "BlokBenchmark.h"
+#include "BlokSelection.h"
+
+#include <algorithm>
+#include <locale>
+#include <sstream>
 
 #define BLOKS_PING_EVENT "com.westonthayer.bloks.events.PingDownEvent"
 
+/** Before any of these, the scheduler finishes its work so the file has the final layout */
+static const char* const kBloksFlushNotifiers[] =
+{
+	kAISaveCommandPreNotifierStr,
+	kAISaveAsCommandPreNotifierStr,
+	kAISaveACopyAsCommandPreNotifierStr,
+	kAISaveAsTemplateCommandPreNotifierStr,
+	kAIAdobeAISaveForWebCommandPreNotifierStr,
+	kAISaveForOfficeCommandPreNotifierStr,
+	kAIExportCommandPreNotifierStr,
+
+	// Saves from scripts don't go through the menu
+	kAIDocumentWritePreprocessNotifier
+};
+
+/**	Look up the art of a comma separated list of pageItem.uuid, the way
+	script messages hand it to us. UUIDs of art that's gone are left out.
+@param uuidList IN message->inParam.
+@param art OUT the art, in the same order.
+*/
+static void GetArtFromUUIDs(const ai::UnicodeString& uuidList, std::vector<AIArtHandle>& art)
+{
+	std::istringstream uuids(uuidList.as_UTF8());
+	std::string uuidString;
+
+	art.clear();
+
+	while (std::getline(uuids, uuidString, ','))
+	{
+		ai::uuid uuid;
+		AIArtHandle handle = NULL;
+
+		if (!uuidString.empty() &&
+			sAIUUID->StringToUUID(ai::UnicodeString::FromUTF8(uuidString), uuid) == kNoErr &&
+			sAIUUID->GetArtHandle(uuid, handle) == kNoErr &&
+			handle)
+		{
+			art.push_back(handle);
+		}
+	}
+}
+
 Plugin* AllocatePlugin(SPPluginRef pluginRef)
 {
 	return new BloksAIPlugin(pluginRef);
@@ -22,7 +70,12 @@ BloksAIPlugin::BloksAIPlugin(SPPluginRef pluginRef) : Plugin(pluginRef)
 	fRegisterEventNotifierHandle = NULL;
 	fRegisterSelectionChangedHandle = NULL;
 	fRegisterUndoHandle = NULL;
+	fRegisterRedoHandle = NULL;
 	fRegisterRulerHandle = NULL;
+	fRegisterArtObjectsChangedHandle = NULL;
+	fRegisterDocumentClosedHandle = NULL;
+	fRegisterSymbolSetChangedHandle = NULL;
+	fRegisterIsolationModeHandle = NULL;
 	strncpy(fPluginName, kBloksAIPluginName, kMaxStringLength);
 }
 
@@ -72,6 +125,16 @@ ASErr BloksAIPlugin::StartupPlugin(SPInterfaceMessage *message)
 			&fRegisterUndoHandle);
 	}
 
+	if (!error)
+	{
+		// Register for redo, which puts a layout back just like undo does
+		error = sAINotifier->AddNotifier(
+			fPluginRef,
+			"Bloks",
+			kAIRedoCommandPreNotifierStr,
+			&fRegisterRedoHandle);
+	}
+
 	if (!error)
 	{
 		// Register for show/hide rulers
@@ -82,6 +145,75 @@ ASErr BloksAIPlugin::StartupPlugin(SPInterfaceMessage *message)
 			&fRegisterRulerHandle);
 	}
 
+	if (!error)
+	{
+		// Register for art changes, to keep the .spacer and symbol indexes up to date
+		error = sAINotifier->AddNotifier(
+			fPluginRef,
+			"Bloks",
+			kAIArtObjectsChangedNotifier,
+			&fRegisterArtObjectsChangedHandle);
+	}
+
+	if (!error)
+	{
+		// Register for document close, what we kept for that document goes with it
+		error = sAINotifier->AddNotifier(
+			fPluginRef,
+			"Bloks",
+			kAIDocumentClosedNotifier,
+			&fRegisterDocumentClosedHandle);
+	}
+
+	if (!error)
+	{
+		// Register for symbol changes, to drop deleted symbols from the symbol index
+		error = sAINotifier->AddNotifier(
+			fPluginRef,
+			"Bloks",
+			kAIArtSymbolSetDetailedChangeNotifier,
+			&fRegisterSymbolSetChangedHandle);
+	}
+
+	if (!error)
+	{
+		// Register for isolation mode changes, queued layouts run when it's left
+		error = sAINotifier->AddNotifier(
+			fPluginRef,
+			"Bloks",
+			kAIIsolationModeChangedNotifier,
+			&fRegisterIsolationModeHandle);
+	}
+
+	for (size_t i = 0; !error && i < sizeof(kBloksFlushNotifiers) / sizeof(kBloksFlushNotifiers[0]); i++)
+	{
+		// Register for save and export, to finish layout first
+		AINotifierHandle handle = NULL;
+		error = sAINotifier->AddNotifier(fPluginRef, "Bloks", kBloksFlushNotifiers[i], &handle);
+
+		fRegisterFlushHandles.push_back(handle);
+	}
+
+	if (!error)
+	{
+		error = fScheduler.Startup(fPluginRef);
+	}
+
+	if (!error)
+	{
+		error = fResizeTool.Startup(fPluginRef);
+	}
+
+	if (!error)
+	{
+		error = fDebugOverlay.Startup(fPluginRef);
+	}
+
+	if (!error)
+	{
+		fEngine.SetDebugOverlay(&fDebugOverlay);
+	}
+
 	//sAIUser->MessageAlert(ai::UnicodeString("Hello from BloksAIPlugin!"));
 
 	return error;
@@ -134,6 +266,8 @@ ASErr BloksAIPlugin::ShutdownPlugin(SPInterfaceMessage *message)
 
 	//sAIUser->MessageAlert(ai::UnicodeString("Goodbye from BloksAIPlugin!"));
 
+	fEngine.Shutdown();
+
 	if (!error)
 	{
 		error = Plugin::ShutdownPlugin(message);
@@ -142,6 +276,321 @@ ASErr BloksAIPlugin::ShutdownPlugin(SPInterfaceMessage *message)
 	return error;
 }
 
+ASErr BloksAIPlugin::UnloadPlugin(SPInterfaceMessage *message)
+{
+	// Worker threads can't outlive our code
+	fEngine.Shutdown();
+
+	return Plugin::UnloadPlugin(message);
+}
+
+ASErr BloksAIPlugin::Message(char* caller, char* selector, void* message)
+{
+	ASErr error = kUnhandledMsgErr;
+
+	if (strcmp(caller, kCallerAIScriptMessage) == 0)
+	{
+		AIScriptMessage* scriptMessage = (AIScriptMessage*)message;
+		AppContext appContext(scriptMessage->d.self);
+
+		error = ScriptMessage(selector, scriptMessage);
+	}
+	else if (strcmp(caller, kCallerAIAnnotation) == 0)
+	{
+		// Plugin doesn't route annotator messages at all
+		AIAnnotatorMessage* annotatorMessage = (AIAnnotatorMessage*)message;
+		AppContext appContext(annotatorMessage->d.self);
+		error = kNoErr;
+
+		if (strcmp(selector, kSelectorAIDrawAnnotation) == 0 && fResizeTool.IsAnnotator(annotatorMessage->annotator))
+		{
+			error = fResizeTool.Draw(*annotatorMessage);
+		}
+		else if (strcmp(selector, kSelectorAIDrawAnnotation) == 0 && fDebugOverlay.IsAnnotator(annotatorMessage->annotator))
+		{
+			error = fDebugOverlay.Draw(*annotatorMessage);
+		}
+	}
+	else
+	{
+		error = Plugin::Message(caller, selector, message);
+	}
+
+	return error;
+}
+
+ASErr BloksAIPlugin::ScriptMessage(const char* selector, AIScriptMessage* message)
+{
+	ASErr error = kNoErr;
+	BlokEngineStats stats;
+	std::string result;
+
+	if (strcmp(selector, "relayoutRoots") == 0)
+	{
+		// inParam is a comma separated list of pageItem.uuid
+		std::vector<AIArtHandle> art;
+		GetArtFromUUIDs(message->inParam, art);
+
+		error = fEngine.RelayoutRoots(art, stats);
+		result = stats.ToJSON();
+	}
+	else if (strcmp(selector, "checkRoots") == 0)
+	{
+		// Like relayoutRoots, but only solves. See jsx/ts/test/native-solve.ts
+		std::vector<AIArtHandle> art;
+		GetArtFromUUIDs(message->inParam, art);
+
+		error = fEngine.CheckRoots(art, stats);
+		result = stats.ToJSON();
+	}
+	else if (strcmp(selector, "relayoutAll") == 0)
+	{
+		error = fEngine.RelayoutAll(stats);
+		result = stats.ToJSON();
+	}
+	else if (strcmp(selector, "scheduleRelayoutAll") == 0)
+	{
+		// Like relayoutAll, but once Illustrator is idle. Skipped roots come back from flushInvalidations
+		fScheduler.QueueRelayoutAll();
+		result = "{}";
+	}
+	else if (strcmp(selector, "queueInvalidation") == 0)
+	{
+		// inParam is a comma separated list of pageItem.uuid, of any Blok in the tree
+		std::vector<AIArtHandle> art;
+		GetArtFromUUIDs(message->inParam, art);
+
+		for (size_t i = 0; i < art.size(); i++)
+		{
+			fInvalidations.Push(art[i]);
+		}
+
+		// Whatever the script changed shares an undo step with the layout that follows
+		fEngine.BeginUndoStep(art);
+		result = "{}";
+	}
+	else if (strcmp(selector, "flushInvalidations") == 0)
+	{
+		FlushInvalidations();
+
+		// Hand back everything the scheduler left for TypeScript so far
+		fScriptInvalidations.Take(stats.skipped);
+		result = stats.ToJSON();
+	}
+	else if (strcmp(selector, "setSpacerOpacity") == 0)
+	{
+		// inParam is the new opacity, 0.0 to 1.0. Set once Illustrator is idle
+		std::istringstream input(message->inParam.as_UTF8());
+		input.imbue(std::locale::classic());
+		AIReal opacity = 1.0;
+
+		if (!(input >> opacity))
+		{
+			error = kBadParameterErr;
+		}
+
+		if (!error)
+		{
+			fScheduler.QueueSpacerOpacity(opacity);
+			result = "{}";
+		}
+	}
+	else if (strcmp(selector, "setUndoSession") == 0)
+	{
+		// inParam is "true" while the panel is being edited, "false" after
+		std::string input = message->inParam.as_UTF8();
+
+		if (input != "true" && input != "false")
+		{
+			error = kBadParameterErr;
+		}
+
+		if (!error)
+		{
+			fEngine.SetUndoSession(input == "true");
+			result = "{}";
+		}
+	}
+	else if (strcmp(selector, "setDebugOverlay") == 0)
+	{
+		// inParam is "true" or "false"
+		std::string input = message->inParam.as_UTF8();
+		bool isVisible = input == "true";
+
+		if (!isVisible && input != "false")
+		{
+			error = kBadParameterErr;
+		}
+
+		if (!error)
+		{
+			error = fDebugOverlay.SetVisible(isVisible);
+		}
+
+		if (!error && isVisible)
+		{
+			// Shows how every root lays out without applying it, later
+			// layouts keep it up to date
+			error = fEngine.RefreshDebugOverlay();
+		}
+
+		if (!error)
+		{
+			result = "{}";
+		}
+	}
+	else if (strcmp(selector, "getSymbolInstances") == 0)
+	{
+		// inParam is the symbol's name
+		AIPatternHandle symbol = NULL;
+		std::vector<AIArtHandle> instances;
+
+		error = sAISymbol->GetSymbolPatternByName(message->inParam, &symbol);
+
+		if (!error)
+		{
+			error = fSymbols.GetInstances(symbol, instances);
+		}
+
+		if (!error)
+		{
+			std::ostringstream json;
+			bool isFirst = true;
+			json << "{\"instances\":[";
+
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				ai::uuid uuid;
+				ai::UnicodeString uuidString;
+
+				if (sAIUUID->GetArtUUID(instances[i], uuid) == kNoErr &&
+					sAIUUID->UUIDToString(uuid, uuidString) == kNoErr)
+				{
+					json << (isFirst ? "" : ",") << "\"" << uuidString.as_UTF8() << "\"";
+					isFirst = false;
+				}
+			}
+
+			json << "]}";
+			result = json.str();
+		}
+	}
+	else if (strcmp(selector, "benchmark") == 0)
+	{
+		// Doesn't touch the document, see jsx/ts/test/layout-benchmark.ts
+		result = BlokRunBenchmark();
+	}
+	else
+	{
+		error = kUnhandledMsgErr;
+	}
+
+	if (!error)
+	{
+		message->outParam = ai::UnicodeString::FromUTF8(result);
+	}
+	else if (error != kUnhandledMsgErr)
+	{
+		// Failing the message looks the same to a script as the plugin not being
+		// there, so hand the error back instead. See sendMessage() in native-layout.ts
+		std::ostringstream json;
+		json << "{\"error\":" << error << "}";
+
+		message->outParam = ai::UnicodeString::FromUTF8(json.str());
+		error = kNoErr;
+	}
+
+	return error;
+}
+
+void BloksAIPlugin::FlushInvalidations()
+{
+	// Illustrator refuses layout while a mode is active, keep waiting
+	if (!sAIIsolationMode->IsInIsolationMode() && !fInvalidations.IsEmpty())
+	{
+		std::vector<AIArtHandle> roots;
+		fInvalidations.Take(roots);
+
+		fScheduler.QueueRoots(roots);
+	}
+}
+
+ASErr BloksAIPlugin::GoTimer(AITimerMessage* message)
+{
+	// Plugin doesn't set up an AppContext for timers like it does for notifiers
+	AppContext appContext(message->d.self);
+
+	// Work left in other documents keeps the timer going, but the panel only
+	// shows the current one's
+	bool isCurrentBusy = fScheduler.IsCurrentBusy();
+	ASErr error = fScheduler.Tick(fEngine, fSpacers, fScriptInvalidations);
+
+	if (!isCurrentBusy)
+	{
+		return error;
+	}
+
+	// Let the panel show how far along it is, the last one says it's done
+	csxs::event::EventErrorCode result = csxs::event::kEventErrorCode_Success;
+	std::string progress = fScheduler.GetProgressJSON();
+	SDKPlugPlug plug;
+	plug.Load(sAIFolders);
+
+	csxs::event::Event ev = {
+		"com.westonthayer.bloks.events.LayoutProgress",
+		csxs::event::kEventScope_Application,
+		"ILST",
+		"com.westonthayer.bloks",
+		progress.c_str()
+	};
+
+	result = plug.DispatchEvent(&ev);
+
+	if (!error && result != csxs::event::kEventErrorCode_Success)
+	{
+		error = 1;
+	}
+
+	plug.Unload();
+
+	return error;
+}
+
+ASErr BloksAIPlugin::ToolMouseDown(AIToolMessage* message)
+{
+	// Plugin doesn't set up an AppContext for tools either
+	AppContext appContext(message->d.self);
+
+	return fResizeTool.IsTool(message->tool) ? fResizeTool.MouseDown(*message, fEngine) : kNoErr;
+}
+
+ASErr BloksAIPlugin::ToolMouseDrag(AIToolMessage* message)
+{
+	AppContext appContext(message->d.self);
+
+	return fResizeTool.IsTool(message->tool) ? fResizeTool.MouseDrag(*message, fEngine) : kNoErr;
+}
+
+ASErr BloksAIPlugin::ToolMouseUp(AIToolMessage* message)
+{
+	AppContext appContext(message->d.self);
+	ASErr error = kNoErr;
+
+	if (fResizeTool.IsTool(message->tool))
+	{
+		BlokEngineStats stats;
+		error = fResizeTool.MouseUp(*message, fEngine, stats);
+
+		// Trees we can't lay out have the new size saved, TypeScript finishes them
+		for (size_t i = 0; i < stats.skipped.size(); i++)
+		{
+			fScriptInvalidations.Push(stats.skipped[i]);
+		}
+	}
+
+	return error;
+}
+
 ASErr BloksAIPlugin::Notify(AINotifierMessage* message)
 {
 	ASErr error = kNoErr;
@@ -166,12 +615,17 @@ ASErr BloksAIPlugin::Notify(AINotifierMessage* message)
 		SDKPlugPlug plug;
 		plug.Load(sAIFolders);
 
+		// What the panel can do with the selection, so it doesn't have to ask
+		// ExtendScript. Empty if it has to anyway
+		std::string summary;
+		BlokGetSelectionSummary(summary);
+
 		csxs::event::Event ev = {
 			"com.westonthayer.bloks.events.SelectionChanged",
 			csxs::event::kEventScope_Application,
 			"ILST",
 			"com.westonthayer.bloks",
-			"selectionchanged"
+			summary.c_str()
 		};
 
 		result = plug.DispatchEvent(&ev);
@@ -206,6 +660,29 @@ ASErr BloksAIPlugin::Notify(AINotifierMessage* message)
 
 		plug.Unload();
 	}
+	else if (message->notifier == fRegisterRedoHandle)
+	{
+		csxs::event::EventErrorCode result = csxs::event::kEventErrorCode_Success;
+		SDKPlugPlug plug;
+		plug.Load(sAIFolders);
+
+		csxs::event::Event ev = {
+			"com.westonthayer.bloks.events.PreRedo",
+			csxs::event::kEventScope_Application,
+			"ILST",
+			"com.westonthayer.bloks",
+			"preredo"
+		};
+
+		result = plug.DispatchEvent(&ev);
+
+		if (result != csxs::event::kEventErrorCode_Success)
+		{
+			error = 1;
+		}
+
+		plug.Unload();
+	}
 	else if (message->notifier == fRegisterRulerHandle)
 	{
 		csxs::event::EventErrorCode result = csxs::event::kEventErrorCode_Success;
@@ -229,6 +706,40 @@ ASErr BloksAIPlugin::Notify(AINotifierMessage* message)
 
 		plug.Unload();
 	}
+	else if (message->notifier == fRegisterArtObjectsChangedHandle)
+	{
+		const ai::ArtObjectsChangedNotifierData* data = (const ai::ArtObjectsChangedNotifierData*)message->notifyData;
+
+		fSpacers.Update(*data);
+		fSymbols.Update(*data);
+		fScheduler.Update(*data);
+	}
+	else if (message->notifier == fRegisterSymbolSetChangedHandle)
+	{
+		fSymbols.Update(*(const AISymbolSetChangeNotifierData*)message->notifyData);
+	}
+	else if (message->notifier == fRegisterIsolationModeHandle)
+	{
+		const AIIsolationModeChangedNotifierData* data = (const AIIsolationModeChangedNotifierData*)message->notifyData;
+
+		if (!data->inIsolationMode)
+		{
+			FlushInvalidations();
+		}
+	}
+	else if (std::find(fRegisterFlushHandles.begin(), fRegisterFlushHandles.end(), message->notifier) != fRegisterFlushHandles.end())
+	{
+		error = fScheduler.Flush(fEngine, fSpacers, fScriptInvalidations);
+	}
+	else if (message->notifier == fRegisterDocumentClosedHandle)
+	{
+		// Other documents are still open, only what was the closed one's goes
+		fSpacers.DocumentClosed();
+		fSymbols.DocumentClosed();
+		fScheduler.DocumentClosed();
+		fDebugOverlay.DocumentClosed();
+		fEngine.DocumentClosed();
+	}
 
 	return error;
 }
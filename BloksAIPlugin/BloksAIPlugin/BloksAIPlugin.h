@@ -2,7 +2,15 @@
 #define __BloksAIPlugin_h__
 
 #include "Plugin.hpp"
+#include "AIScriptMessage.h"
 #include "BloksAIPluginID.h"
+#include "BlokDebugOverlay.h"
+#include "BlokEngine.h"
+#include "BlokInvalidation.h"
+#include "BlokResizeTool.h"
+#include "BlokScheduler.h"
+#include "BlokSpacers.h"
+#include "BlokSymbols.h"
 
 /**	Creates a new BloksAIPlugin.
 @param pluginRef IN unique reference to this plugin.
@@ -47,14 +55,80 @@ public:
 	*/
 	ASErr ShutdownPlugin(SPInterfaceMessage * message); // override
 
+	/**	Stops our worker threads before the plugin leaves memory.
+	@param message IN message sent by the plugin manager.
+	@return kNoErr on success, other ASErr otherwise.
+	*/
+	ASErr UnloadPlugin(SPInterfaceMessage * message); // override
+
+	/**	Routes app.sendScriptMessage() calls from the ExtendScript side to
+		ScriptMessage() and draws the resize preview, everything else goes to
+		Plugin.
+	*/
+	ASErr Message(char* caller, char* selector, void* message); // override
+
 protected:
 	virtual ASErr Notify(AINotifierMessage* message); // override
 
+	/**	Runs a tick of the scheduler, inside an AppContext.
+	@param message IN the timer message.
+	@return kNoErr on success, other ASErr otherwise.
+	*/
+	virtual ASErr GoTimer(AITimerMessage* message); // override
+
+	/**	Mouse messages for the Bloks Resize tool, each inside an AppContext.
+	@param message IN the tool message.
+	@return kNoErr on success, other ASErr otherwise.
+	*/
+	virtual ASErr ToolMouseDown(AIToolMessage* message); // override
+	virtual ASErr ToolMouseDrag(AIToolMessage* message); // override
+	virtual ASErr ToolMouseUp(AIToolMessage* message); // override
+
 private:
+	/**	Handle a message from app.sendScriptMessage("BloksAIPlugin", selector, inParam).
+	@param selector IN name of the operation, like "relayoutRoots".
+	@param message IN/OUT inParam is the input, outParam is set to a JSON result.
+	@return kNoErr on success, kUnhandledMsgErr for an unknown selector, other ASErr otherwise.
+	*/
+	ASErr ScriptMessage(const char* selector, AIScriptMessage* message);
+
+	/**	Hand every root queued during Isolation or Symbol Editing Mode to
+		the scheduler, unless a mode is still active. Roots the native layout
+		can't handle wait for ExtendScript to ask for them.
+	*/
+	void FlushInvalidations();
+
+	BlokEngine fEngine;
+	BlokSpacerIndex fSpacers;
+	BlokSymbolIndex fSymbols;
+
+	/** Roots to lay out once we're out of Isolation or Symbol Editing Mode */
+	BlokInvalidationQueue fInvalidations;
+
+	/** Roots the scheduler couldn't lay out natively */
+	BlokInvalidationQueue fScriptInvalidations;
+
+	/** Layout work that waits until Illustrator is idle */
+	BlokScheduler fScheduler;
+
+	/** Resizes BlokGroups without scaling them */
+	BlokResizeTool fResizeTool;
+
+	/** Draws layout boxes over the document when the panel asks for them */
+	BlokDebugOverlay fDebugOverlay;
+
 	AINotifierHandle fRegisterEventNotifierHandle;
 	AINotifierHandle fRegisterSelectionChangedHandle;
 	AINotifierHandle fRegisterUndoHandle;
+	AINotifierHandle fRegisterRedoHandle;
 	AINotifierHandle fRegisterRulerHandle;
+	AINotifierHandle fRegisterArtObjectsChangedHandle;
+	AINotifierHandle fRegisterDocumentClosedHandle;
+	AINotifierHandle fRegisterSymbolSetChangedHandle;
+	AINotifierHandle fRegisterIsolationModeHandle;
+
+	/** One for each of kBloksFlushNotifiers */
+	std::vector<AINotifierHandle> fRegisterFlushHandles;
 };
 
 #endif
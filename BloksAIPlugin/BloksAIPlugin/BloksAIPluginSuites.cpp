@@ -1,5 +1,6 @@
 #include "IllustratorSDK.h"
 #include "BloksAIPluginSuites.h"
+#include "ATETextSuitesImportHelper.h"
 
 // Suite externs
 extern "C"
@@ -7,6 +8,32 @@ extern "C"
 	SPBlocksSuite* sSPBlocks = NULL;
 	AIUnicodeStringSuite* sAIUnicodeString = NULL;
 	AIStringFormatUtilsSuite* sAIStringFormatUtils = NULL;
+	AIArtSuite* sAIArt = NULL;
+	AITagSuite* sAITag = NULL;
+	AITransformArtSuite* sAITransformArt = NULL;
+	AITextFrameSuite* sAITextFrame = NULL;
+	AIUUIDSuite* sAIUUID = NULL;
+	AIDocumentSuite* sAIDocument = NULL;
+	AIMatchingArtSuite* sAIMatchingArt = NULL;
+	AIMdMemorySuite* sAIMdMemory = NULL;
+	AIPathSuite* sAIPath = NULL;
+	AIRealMathSuite* sAIRealMath = NULL;
+	AILayerSuite* sAILayer = NULL;
+	AISymbolSuite* sAISymbol = NULL;
+	AIBlendStyleSuite* sAIBlendStyle = NULL;
+	AIIsolationModeSuite* sAIIsolationMode = NULL;
+	AITimerSuite* sAITimer = NULL;
+	AIDocumentViewSuite* sAIDocumentView = NULL;
+	AIArtboardSuite* sAIArtboard = NULL;
+	AIUndoSuite* sAIUndo = NULL;
+	AIToolSuite* sAITool = NULL;
+	AIAnnotatorSuite* sAIAnnotator = NULL;
+	AIAnnotatorDrawerSuite* sAIAnnotatorDrawer = NULL;
+	AIFontSuite* sAIFont = NULL;
+	AIDocumentListSuite* sAIDocumentList = NULL;
+
+	// ATE, for BlokTextMeasurer
+	EXTERN_TEXT_SUITES
 }
 
 // Import suites
@@ -15,5 +42,29 @@ ImportSuite gImportSuites[] =
 	kSPBlocksSuite, kSPBlocksSuiteVersion, &sSPBlocks,
 	kAIUnicodeStringSuite, kAIUnicodeStringVersion, &sAIUnicodeString,
 	kAIStringFormatUtilsSuite, kAIStringFormatUtilsSuiteVersion, &sAIStringFormatUtils,
+	kAIArtSuite, kAIArtVersion, &sAIArt,
+	kAITagSuite, kAITagVersion, &sAITag,
+	kAITransformArtSuite, kAITransformArtVersion, &sAITransformArt,
+	kAITextFrameSuite, kAITextFrameVersion, &sAITextFrame,
+	kAIUUIDSuite, kAIUUIDVersion, &sAIUUID,
+	kAIDocumentSuite, kAIDocumentVersion, &sAIDocument,
+	kAIMatchingArtSuite, kAIMatchingArtVersion, &sAIMatchingArt,
+	kAIMdMemorySuite, kAIMdMemoryVersion, &sAIMdMemory,
+	kAIPathSuite, kAIPathVersion, &sAIPath,
+	kAIRealMathSuite, kAIRealMathVersion, &sAIRealMath,
+	kAILayerSuite, kAILayerVersion, &sAILayer,
+	kAISymbolSuite, kAISymbolVersion, &sAISymbol,
+	kAIBlendStyleSuite, kAIBlendStyleVersion, &sAIBlendStyle,
+	kAIIsolationModeSuite, kAIIsolationModeVersion, &sAIIsolationMode,
+	kAITimerSuite, kAITimerVersion, &sAITimer,
+	kAIDocumentViewSuite, kAIDocumentViewVersion, &sAIDocumentView,
+	kAIArtboardSuite, kAIArtboardVersion, &sAIArtboard,
+	kAIUndoSuite, kAIUndoVersion, &sAIUndo,
+	kAIToolSuite, kAIToolVersion, &sAITool,
+	kAIAnnotatorSuite, kAIAnnotatorVersion, &sAIAnnotator,
+	kAIAnnotatorDrawerSuite, kAIAnnotatorDrawerVersion, &sAIAnnotatorDrawer,
+	kAIFontSuite, kAIFontVersion, &sAIFont,
+	kAIDocumentListSuite, kAIDocumentListVersion, &sAIDocumentList,
+	IMPORT_TEXT_SUITES
 	nullptr, 0, nullptr
 };
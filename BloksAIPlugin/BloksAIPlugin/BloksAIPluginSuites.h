@@ -6,10 +6,47 @@
 #include "AIStringFormatUtils.h"
 
 // AI suite headers
+#include "AIAnnotator.h"
+#include "AIAnnotatorDrawer.h"
+#include "AIArtboard.h"
+#include "AIDocumentList.h"
+#include "AIDocumentView.h"
+#include "AIFont.h"
+#include "AIIsolationMode.h"
+#include "AIMask.h"
+#include "AISymbol.h"
+#include "AITag.h"
+#include "AITimer.h"
+#include "AITransformArt.h"
+#include "AIUUID.h"
+#include "IAIArtboards.hpp"
 
 // Suite externs
 extern "C" SPBlocksSuite *sSPBlocks;
 extern "C" AIUnicodeStringSuite* sAIUnicodeString;
 extern "C" AIStringFormatUtilsSuite* sAIStringFormatUtils;
+extern "C" AIArtSuite* sAIArt;
+extern "C" AITagSuite* sAITag;
+extern "C" AITransformArtSuite* sAITransformArt;
+extern "C" AITextFrameSuite* sAITextFrame;
+extern "C" AIUUIDSuite* sAIUUID;
+extern "C" AIDocumentSuite* sAIDocument;
+extern "C" AIMatchingArtSuite* sAIMatchingArt;
+extern "C" AIMdMemorySuite* sAIMdMemory;
+extern "C" AIPathSuite* sAIPath;
+extern "C" AIRealMathSuite* sAIRealMath;
+extern "C" AILayerSuite* sAILayer;
+extern "C" AISymbolSuite* sAISymbol;
+extern "C" AIBlendStyleSuite* sAIBlendStyle;
+extern "C" AIIsolationModeSuite* sAIIsolationMode;
+extern "C" AITimerSuite* sAITimer;
+extern "C" AIDocumentViewSuite* sAIDocumentView;
+extern "C" AIArtboardSuite* sAIArtboard;
+extern "C" AIUndoSuite* sAIUndo;
+extern "C" AIToolSuite* sAITool;
+extern "C" AIAnnotatorSuite* sAIAnnotator;
+extern "C" AIAnnotatorDrawerSuite* sAIAnnotatorDrawer;
+extern "C" AIFontSuite* sAIFont;
+extern "C" AIDocumentListSuite* sAIDocumentList;
 
 #endif
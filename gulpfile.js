@@ -39,6 +39,7 @@ gulp.task("build-jsx", function() {
                 // Append some debugging helpers
                 contents += "\n\n//loader(7).checkSelectionForRelayout();"
                 contents += "\n//loader(7).relayoutSelection();"
+                contents += "\n//loader(7).relayoutAll();"
                 contents += "\n//loader(7).updateSelectedBlokContainer({ flexDirection: 0, justifyContent: 0, alignItems: 0, flexWrap: 0 });"
                 contents += "\n//loader(7).createBlokContainerFromSelection({ flexDirection: 0, justifyContent: 0, alignItems: 0, flexWrap: 0 });"
                 contents += "\n//loader(7).updateSelectedBlok({ flex: undefined, alignSelf: 0 });"
@@ -34,10 +34,14 @@
                 this.isCreateButtonVisible = ko.observable(false);
                 this.isLayoutButtonVisible = ko.observable(false);
                 this.isAutoLayoutOn = ko.observable(true);
+                this.isDebugOverlayOn = ko.observable(false);
+                this.layoutProgress = ko.observable("");
 
                 // Blok settings
                 this.flex = ko.observable(undefined).extend({ positiveNumeric: 0 });
                 this.alignSelf = ko.observable(undefined);
+                this.autoHeight = ko.observable(undefined);
+                this.isAreaText = ko.observable(false);
                 this.parentBlokContainerFlexDirection = ko.observable(0);
 
                 // BlokContainer settings
@@ -45,11 +49,13 @@
                 this.justifyContent = ko.observable(0);
                 this.alignItems = ko.observable(0);
                 this.flexWrap = ko.observable(0);
+                this.gap = ko.observable(undefined).extend({ positiveNumeric: 0 });
             }
 
             BlokVm.prototype.blokEquals = function(settings) {
                 return this.flex() === settings.flex &&
-                    this.alignSelf() === settings.alignSelf;
+                    this.alignSelf() === settings.alignSelf &&
+                    this.autoHeight() === settings.autoHeight;
             };
 
             BlokVm.prototype.blokContainerEquals = function(settings) {
@@ -57,7 +63,8 @@
                     this.flexDirection() === settings.flexDirection &&
                     this.justifyContent() === settings.justifyContent &&
                     this.alignItems() === settings.alignItems &&
-                    this.flexWrap() === settings.flexWrap;
+                    this.flexWrap() === settings.flexWrap &&
+                    this.gap() === settings.gap;
             };
 
             return BlokVm;
@@ -93,18 +100,37 @@
                         cb();
                     });
                 },
+                /** Register a callback for whenever Illustrator is about to redo an action. Will fire before SELECTION_CHANGED */
+                onPreRedo: function(cb) {
+                    csInterface.addEventListener("com.westonthayer.bloks.events.PreRedo", function(ret) {
+                        cb();
+                    });
+                },
                 /** Register a callback for whenever Illustrator is about to show or hide the rulers. */
                 onPreShowHideRulers: function(cb) {
                     csInterface.addEventListener("com.westonthayer.bloks.events.PreShowHideRulers", function(ret) {
                         cb();
                     });
                 },
-                /** Register a callback for whenever Illustrator's SELECTION_CHANGED event fires (a lot) */
+                /** Register a callback for progress of layout the native plugin runs while Illustrator is idle */
+                onLayoutProgress: function(cb) {
+                    csInterface.addEventListener("com.westonthayer.bloks.events.LayoutProgress", function(ret) {
+                        // CEP hands JSON data over already parsed
+                        cb(typeof ret.data === "string" ? JSON.parse(ret.data) : ret.data);
+                    });
+                },
+                /**
+                 * Register a callback for whenever Illustrator's SELECTION_CHANGED event fires (a lot).
+                 * The plugin works out what getActionsFromSelection() would return and hands it to cb,
+                 * undefined if it couldn't
+                 */
                 onSelectionChanged: function(cb) {
                     csInterface.addEventListener("com.westonthayer.bloks.events.SelectionChanged", function(ret) {
                         // Only listen for our plugin's events, we could be hearing others
                         if (ret.extensionId === "com.westonthayer.bloks") {
-                            cb();
+                            // CEP hands JSON data over already parsed
+                            var summary = ret.data || undefined;
+                            cb(typeof summary === "string" ? JSON.parse(summary) : summary);
                         }
                     });
                 },
@@ -141,11 +167,23 @@
                 relayoutSelection: function() {
                     csInterface.evalScript("loader(7).relayoutSelection()");
                 },
+                relayoutAll: function() {
+                    csInterface.evalScript("loader(7).relayoutAll()");
+                },
                 hideSpacers: function() {
                     csInterface.evalScript("loader(7).hideSpacers()");
                 },
                 showSpacers: function() {
                     csInterface.evalScript("loader(7).showSpacers()");
+                },
+                convertSpacersToGap: function() {
+                    csInterface.evalScript("loader(7).convertSpacersToGap()");
+                },
+                setDebugOverlay: function(isVisible) {
+                    csInterface.evalScript("loader(7).setDebugOverlay(" + isVisible + ")");
+                },
+                setUndoSession: function(isInSession) {
+                    csInterface.evalScript("loader(7).setUndoSession(" + isInSession + ")");
                 }
             };
         })();
@@ -162,6 +200,7 @@
         ko.applyBindings(viewModel);
         
         // Global which tracks whether a selection changed event is caused by an undo
+        // or redo. Either one puts back a layout that was already done
         var isUndo = false;
         
         // Global which tracks when the last time a ruler was shown/hidden
@@ -171,6 +210,10 @@
             isUndo = true;
         });
         
+        BlokScripts.onPreRedo(function() {
+            isUndo = true;
+        });
+        
         BlokScripts.onPreShowHideRulers(function() {
             var endTime = new Date();
             var diff = endTime - lastRulerTime;
@@ -203,6 +246,8 @@
             else if (result.action === 1) {
                 // Container sel
                 viewModel.title("Blok Group");
+                viewModel.autoHeight(undefined);
+                viewModel.isAreaText(false);
 
                 if (result.blok.isAlsoChild) {
                     viewModel.isChildSettingsVisible(true);
@@ -223,6 +268,7 @@
                 viewModel.flexDirection(result.blok.flexDirection);
                 viewModel.justifyContent(result.blok.justifyContent);
                 viewModel.alignItems(result.blok.alignItems);
+                viewModel.gap(result.blok.gap);
             }
             else if (result.action === 2) {
                 // child sel
@@ -234,6 +280,8 @@
 
                 viewModel.flex(result.blok.flex);
                 viewModel.alignSelf(result.blok.alignSelf);
+                viewModel.autoHeight(result.blok.autoHeight);
+                viewModel.isAreaText(!!result.blok.isAreaText);
                 
                 if (result.blok.parentBlokContainer) {
                     viewModel.parentBlokContainerFlexDirection(result.blok.parentBlokContainer.flexDirection);
@@ -249,14 +297,20 @@
                 viewModel.flexDirection(0);
                 viewModel.justifyContent(0);
                 viewModel.alignItems(0);
+                viewModel.gap(undefined);
             }
             else {
                 throw new Error("Unexpected action value: " + result);
             }
         }
 
-        BlokScripts.onSelectionChanged(function() {  
-            BlokScripts.getActionsFromSelection(respondToActions);
+        BlokScripts.onSelectionChanged(function(summary) {
+            if (summary) {
+                respondToActions(summary);
+            }
+            else {
+                BlokScripts.getActionsFromSelection(respondToActions);
+            }
             
             if (!isUndo && viewModel.isAutoLayoutOn()) {
                 BlokScripts.checkSelectionForRelayout();
@@ -265,6 +319,21 @@
             isUndo = false;
         });
 
+        BlokScripts.onLayoutProgress(function(progress) {
+            if (!progress.isBusy) {
+                viewModel.layoutProgress("");
+                return;
+            }
+            
+            var text = "Laying out... " + Math.round(progress.pass.progress * 100) + "%";
+            
+            if (progress.queued > 0) {
+                text += ", " + progress.queued + " more waiting";
+            }
+            
+            viewModel.layoutProgress(text);
+        });
+
         // On-the-fly updates
         
         function handleBlokPropertyChanged(newValue) {
@@ -282,6 +351,7 @@
         
         viewModel.flex.subscribe(handleBlokPropertyChanged);
         viewModel.alignSelf.subscribe(handleBlokPropertyChanged);
+        viewModel.autoHeight.subscribe(handleBlokPropertyChanged);
 
         
         function handleBlokContainerPropertyChanged(newValue) {
@@ -295,6 +365,7 @@
         viewModel.flexDirection.subscribe(handleBlokContainerPropertyChanged);
         viewModel.justifyContent.subscribe(handleBlokContainerPropertyChanged);
         viewModel.alignItems.subscribe(handleBlokContainerPropertyChanged);
+        viewModel.gap.subscribe(handleBlokContainerPropertyChanged);
 
 
         // Group creation
@@ -305,7 +376,8 @@
                 flexDirection: viewModel.flexDirection(),
                 justifyContent: viewModel.justifyContent(),
                 alignItems: viewModel.alignItems(),
-                flexWrap: viewModel.flexWrap()
+                flexWrap: viewModel.flexWrap(),
+                gap: viewModel.gap()
             };
             
             BlokScripts.createBlokContainerFromSelection(JSON.stringify(settings));
@@ -316,6 +388,10 @@
             BlokScripts.relayoutSelection();
         });
         
+        $("#layout-all-btn").click(function() {
+            BlokScripts.relayoutAll();
+        });
+        
         // Easy show/hide of .spacer PageItems
         $("#spacer-hide-btn").click(function() {
             BlokScripts.hideSpacers();
@@ -324,6 +400,24 @@
         $("#spacer-show-btn").click(function() {
             BlokScripts.showSpacers();
         });
+        
+        $("#spacer-convert-btn").click(function() {
+            BlokScripts.convertSpacersToGap();
+        });
+        
+        // Edits made while the panel has focus share one undo step
+        $(window).focus(function() {
+            BlokScripts.setUndoSession(true);
+        });
+        
+        $(window).blur(function() {
+            BlokScripts.setUndoSession(false);
+        });
+        
+        // Layout box overlay, drawn by the plugin
+        viewModel.isDebugOverlayOn.subscribe(function(newValue) {
+            BlokScripts.setDebugOverlay(newValue);
+        });
 
 
 
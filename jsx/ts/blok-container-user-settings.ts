@@ -12,6 +12,7 @@ class BlokContainerUserSettings extends BlokUserSettings {
     public justifyContent: number;
     public alignItems: number;
     public flexWrap: number;
+    public gap: number;
 
     constructor() {
         super();
@@ -20,6 +21,7 @@ class BlokContainerUserSettings extends BlokUserSettings {
         this.justifyContent = Css.Justifications.FLEX_START;
         this.alignItems = Css.Alignments.FLEX_START;
         this.flexWrap = Css.FlexWraps.NOWRAP;
+        this.gap = 0;
     }
 }
 
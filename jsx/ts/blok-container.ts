@@ -9,6 +9,7 @@ import BlokContainerUserSettings = require("./blok-container-user-settings");
 import Rect = require("./rect");
 import BlokAdapter = require("./blok-adapter");
 import Utils = require("./utils");
+import NativeLayout = require("./native-layout");
 
 var JSON2 = require("JSON2");
 require("./shim/myshims");
@@ -76,6 +77,19 @@ class BlokContainer extends Blok {
         this.setSavedProperty<Css.FlexWraps>("flexWrap", value);
     }
 
+    /** Space between each pair of children along the main axis. Like css gap */
+    public getGap(): number {
+        return this.getSavedProperty<number>("gap");
+    }
+    /** Optional >= 0 number, undefined is the same as 0 */
+    public setGap(value: number): void {
+        if (value !== undefined && value < 0) {
+            throw new RangeError("Cannot set a negative gap!");
+        }
+
+        this.setSavedProperty<number>("gap", value);
+    }
+
     /** The visible position and size, relative to the parent BlokContainer,
     or to the current artboard if there is no container */
     public /*override*/ getRect(): Rect {
@@ -104,6 +118,7 @@ class BlokContainer extends Blok {
         settings.justifyContent = this.getJustifyContent();
         settings.alignItems = this.getAlignItems();
         settings.flexWrap = this.getFlexWrap();
+        settings.gap = this.getGap();
 
         return settings;
     }
@@ -138,6 +153,92 @@ class BlokContainer extends Blok {
         this.setJustifyContent(value.justifyContent);
         this.setAlignItems(value.alignItems);
         this.setFlexWrap(value.flexWrap);
+        this.setGap(value.gap);
+    }
+
+    /**
+     * Replace the .spacer art between our children with a gap. Only done when
+     * every other child is a .spacer and they're all the same size along our
+     * main axis, inflexible and no taller across it than the tallest other
+     * child, so nothing moves.
+     *
+     * @returns true if .spacers were removed. The caller should invalidate()
+     */
+    public convertSpacersToGap(): boolean {
+        let items = [];
+
+        // low z-index to high z-index, like getChildren()
+        for (let i = this._pageItem.pageItems.length - 1; i >= 0; i--) {
+            let pageItem = this._pageItem.pageItems[i];
+
+            if (!Utils.isKeyInString(pageItem.name, ".bg")) {
+                items.push(pageItem);
+            }
+        }
+
+        if (items.length < 3 || items.length % 2 === 0) {
+            return false;
+        }
+
+        let isRow = this.getFlexDirection() === Css.FlexDirections.ROW;
+        let spacerSize: number = undefined;
+        let spacerCrossSize = 0;
+        let itemCrossSize = 0;
+
+        for (let i = 0; i < items.length; i++) {
+            let pageItem = items[i];
+            let name = pageItem.name;
+
+            if (!name && pageItem.symbol) {
+                name = pageItem.symbol.name;
+            }
+
+            let isSpacer = Utils.isKeyInString(name, ".spacer") && !BlokAdapter.isBlokContainerAttached(pageItem);
+
+            if (isSpacer !== (i % 2 === 1)) {
+                return false;
+            }
+
+            // [left, top, right, bottom] in cartesian coordinates
+            let bounds = pageItem.geometricBounds;
+            let crossSize = isRow ? bounds[1] - bounds[3] : bounds[2] - bounds[0];
+
+            if (!isSpacer) {
+                itemCrossSize = Math.max(itemCrossSize, crossSize);
+            }
+            else {
+                let flex = BlokAdapter.getSavedProperty<number>(pageItem, "flex");
+
+                if (flex !== undefined && flex > 0) {
+                    return false;
+                }
+
+                let size = isRow ? bounds[2] - bounds[0] : bounds[1] - bounds[3];
+                spacerCrossSize = Math.max(spacerCrossSize, crossSize);
+
+                if (spacerSize === undefined) {
+                    spacerSize = size;
+                }
+                else if (!Utils.nearlyEqual(spacerSize, size)) {
+                    return false;
+                }
+            }
+        }
+
+        // A .spacer that sets our cross size would take it with it
+        if (spacerCrossSize > itemCrossSize && !Utils.nearlyEqual(spacerCrossSize, itemCrossSize)) {
+            return false;
+        }
+
+        for (let i = 1; i < items.length; i += 2) {
+            items[i].remove();
+        }
+
+        // Each .spacer sat between two gaps that were already there
+        let gap = this.getGap() || 0;
+        this.setGap(2 * gap + Math.max(spacerSize, 0));
+
+        return true;
     }
 
     /** Return a pre-layout css-layout node for this BlokContainer and all child Bloks */
@@ -179,7 +280,7 @@ class BlokContainer extends Blok {
 
         cssNode.style.flexDirection = Css.enumStringToCssString(Css.FlexDirections[this.getFlexDirection()]);
         cssNode.style.justifyContent = Css.enumStringToCssString(Css.Justifications[this.getJustifyContent()]);
-        cssNode.style.alignItems = Css.enumStringToCssString(Css.Alignments[this.getAlignItems()]);
+        cssNode.style.alignItems = Css.alignmentToCssString(this.getAlignItems());
         cssNode.style.flexWrap = Css.enumStringToCssString(Css.FlexWraps[this.getFlexWrap()]);
 
         // Add padding if we have a .bg and they supplied a padding. Ex:
@@ -202,9 +303,22 @@ class BlokContainer extends Blok {
 
         let blokChildren = this.getChildren();
 
-        blokChildren.forEach((blok) => {
+        let gap = this.getGap() || 0;
+
+        blokChildren.forEach((blok, index) => {
             let childCssNode = blok.computeCssNode();
 
+            // css-layout has no gap, a leading margin on every child but the
+            // first lays out the same
+            if (gap > 0 && index > 0) {
+                if (this.getFlexDirection() === Css.FlexDirections.ROW) {
+                    childCssNode.style.marginLeft = gap;
+                }
+                else {
+                    childCssNode.style.marginTop = gap;
+                }
+            }
+
             // Clear a dim from the child if we're stretching and give ourself
             // a fixed dimension. If even a single Blok child is set to stretch,
             // the BlokContainer must layout with a fixed w/h, otherwise the Blok child
@@ -262,7 +376,7 @@ class BlokContainer extends Blok {
 
         if (this.getCachedChildCount() !== this._pageItem.pageItems.length) {
             // Short circut for new child count
-            this.invalidate();
+            NativeLayout.relayout(this);
         }
         else {
             let rect = this.getRect();
@@ -287,21 +401,24 @@ class BlokContainer extends Blok {
                     // Attempting to fix those values is difficult, since a TextFrameItem can have many
                     // TextRanges, all with different settings. Rather than attempt to store/restore those
                     // values, we just undo the resize, but not before we record our new desired size.
+                    //
+                    // The Bloks Resize tool in BloksAIPlugin hands the new size straight to layout and
+                    // never scales anything, so this is only for resizes with the Selection tool
                     app.undo();
 
                     this.setOverrideWidth(rect.getWidth());
                     this.setOverrideHeight(rect.getHeight());
 
-                    this.invalidate();
+                    NativeLayout.relayout(this);
                 }
                 else {
-                    this.invalidate();
+                    NativeLayout.relayout(this);
                 }
             }
             else {
                 if (isZIndexInvalid) {
                     // We are a Blok child that is at a new z
-                    this.invalidate();
+                    NativeLayout.relayout(this);
                 }
                 else {
                     // Check to see if one of our Blok children is out of order
@@ -321,7 +438,7 @@ class BlokContainer extends Blok {
                     }
 
                     if (shouldInvalidate) {
-                        this.invalidate();
+                        NativeLayout.relayout(this);
                     }
                 }
             }
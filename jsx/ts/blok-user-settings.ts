@@ -7,6 +7,7 @@
 class BlokUserSettings {
     public flex: number;
     public alignSelf: number;
+    public autoHeight: boolean;
 
     constructor() {
         // Leave everything as undefined
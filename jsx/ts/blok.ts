@@ -9,6 +9,7 @@ import BlokUserSettings = require("./blok-user-settings");
 import BlokContainer = require("./blok-container");
 import BlokAdapter = require("./blok-adapter");
 import Utils = require("./utils");
+import NativeLayout = require("./native-layout");
 
 /**
  * Wraps an Illustrator pageItem to add the capabilities needed for layout.
@@ -79,12 +80,25 @@ class Blok {
         this.setSavedProperty<Css.Alignments>("alignSelf", value);
     }
 
+    /**
+     * Optional, for area text only. If true, the native layout measures how tall
+     * the text is at the width it's laid out at and sizes the frame to fit
+     */
+    public getAutoHeight(): boolean {
+        return this.getSavedProperty<boolean>("autoHeight");
+    }
+    /** Optional, for area text only. See getAutoHeight() */
+    public setAutoHeight(value: boolean): void {
+        this.setSavedProperty<boolean>("autoHeight", value);
+    }
+
     /** Create a settings object reflecting our current state */
     public getUserSettings(): BlokUserSettings {
         let settings = new BlokUserSettings();
         
         settings.flex = this.getFlex();
         settings.alignSelf = this.getAlignSelf();
+        settings.autoHeight = this.getAutoHeight();
 
         return settings;
     }
@@ -104,6 +118,7 @@ class Blok {
 
         this.setFlex(value.flex);
         this.setAlignSelf(value.alignSelf);
+        this.setAutoHeight(value.autoHeight);
     }
 
     /** Return a css-layout node */
@@ -132,7 +147,7 @@ class Blok {
         
         // Have to set it here, css-layout gets confused if it's set and not needed
         if (this.getAlignSelf() !== undefined) {
-            cssNode.style.alignSelf = Css.enumStringToCssString(Css.Alignments[this.getAlignSelf()]);
+            cssNode.style.alignSelf = Css.alignmentToCssString(this.getAlignSelf());
         }
 
         return cssNode;
@@ -159,7 +174,7 @@ class Blok {
         let isZIndexInvalid = cachedZ !== undefined && cachedZ !== z;
 
         if (isWidthInvalid || isHeightInvalid || isZIndexInvalid) {
-            this.getContainer().invalidate();
+            NativeLayout.relayout(this);
         }
         
         // Update z index cache
@@ -284,6 +299,11 @@ class Blok {
         return this._pageItem === value._pageItem;
     }
 
+    /** Illustrator's unique id for our art, also how the native plugin finds it */
+    public getUuid(): string {
+        return this._pageItem.uuid;
+    }
+
     public getZIndex(): number {
         let index = -1;
 
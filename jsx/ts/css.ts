@@ -19,12 +19,31 @@ export function cssStringToEnumString(value: string): string {
     return value.replace("-", "_").toUpperCase();
 }
 
-/** CSS flexbox alignment values */
+/**
+ * CSS flexbox alignment values. BASELINE only lines up rows, and only the native
+ * layout supports it.
+ */
 export enum Alignments {
     FLEX_START,
     CENTER,
     FLEX_END,
     STRETCH,
+    BASELINE,
+}
+
+/**
+ * Converts an alignment to what css-layout understands. It has no baseline
+ * alignment, so that falls back to flex-start.
+ *
+ * @param value - ex: Alignments.CENTER
+ * @returns ex: center
+ */
+export function alignmentToCssString(value: Alignments): string {
+    if (value === Alignments.BASELINE) {
+        value = Alignments.FLEX_START;
+    }
+
+    return enumStringToCssString(Alignments[value]);
 }
 
 /** CSS flexbox flex-direction. We only support row and column for simplicity. */
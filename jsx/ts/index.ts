@@ -12,6 +12,7 @@ import BlokUserSettings = require("./blok-user-settings");
 import BlokContainer = require("./blok-container");
 import BlokContainerUserSettings = require("./blok-container-user-settings");
 import Utils = require("./utils");
+import NativeLayout = require("./native-layout");
 
 // npm imports
 var JSON2: any = require("JSON2");
@@ -56,6 +57,30 @@ function isPageItemSymbolRoot(pageItem: any): boolean {
         pageItem.parent.parent.name === "Symbol Editing Mode";
 }
 
+/**
+ * Find every SymbolItem in the active document that is an instance of a symbol.
+ * Asks the native plugin first, which doesn't have to look at every SymbolItem.
+ *
+ * @param symName - name of the symbol
+ */
+function getSymbolItems(symName: string): any[] {
+    let symItems = NativeLayout.getSymbolInstances(symName);
+
+    if (symItems === undefined) {
+        symItems = [];
+
+        for (let i = 0; i < app.activeDocument.symbolItems.length; i++) {
+            let symItem = app.activeDocument.symbolItems[i];
+
+            if (symItem.symbol.name === symName) {
+                symItems.push(symItem);
+            }
+        }
+    }
+
+    return symItems;
+}
+
 // Global variables
 var bloksToBeInvalidated = []; // A cache of Bloks to call invalidate() on when its possible to do so
 var lastSelection; // Tracks the most recent result of app.activeDocument.selection
@@ -84,47 +109,67 @@ export function checkSelectionForRelayout(): void {
                         // We're editing a Symbol. Special cases to make this important scenario work
                         let symName = pageItem.parent.name;
 
-                        // Use the document's list of symbols to find the Bloks that wrap the symbol
-                        for (let i = 0; i < app.activeDocument.symbolItems.length; i++) {
-                            let symItem = app.activeDocument.symbolItems[i];
+                        // Find the Bloks that wrap the symbol
+                        let symItems = getSymbolItems(symName);
+                        let bloks: Blok[] = [];
 
-                            if (symItem.symbol.name === symName && BlokAdapter.shouldBlokBeAttached(symItem)) {
-                                let blok = BlokAdapter.getBlok(symItem);
+                        for (let i = 0; i < symItems.length; i++) {
+                            let symItem = symItems[i];
 
-                                // Illustrator will refuse to run layout because we're in Symbol Editing Mode, so make a
-                                // list of Bloks to invalidate the next chance we get
-                                bloksToBeInvalidated.push(blok);
+                            if (BlokAdapter.shouldBlokBeAttached(symItem)) {
+                                bloks.push(BlokAdapter.getBlok(symItem));
                             }
                         }
+
+                        // Illustrator will refuse to run layout because we're in Symbol Editing Mode, so make a
+                        // list of Bloks to invalidate the next chance we get. The plugin does it as soon as the
+                        // mode is left
+                        if (!NativeLayout.queueInvalidation(bloks)) {
+                            bloks.forEach((blok: Blok) => {
+                                bloksToBeInvalidated.push(blok);
+                            });
+                        }
                     }
                 }
             }
             else {
+                // The plugin lays out its queue itself while idle once a mode is left. Catch
+                // anything it couldn't lay out
+                let skipped = NativeLayout.flushInvalidations();
+
+                if (skipped !== undefined) {
+                    skipped.forEach((uuid: string) => {
+                        BlokAdapter.getBlokContainer(app.activeDocument.getPageItemFromUuid(uuid)).invalidate();
+                    });
+                }
+
                 // Ensure we're not in any sort of mode where invalidation would fail
-                if (app.activeDocument.activeLayer.name !== "Isolation Mode" &&
+                if (bloksToBeInvalidated.length > 0 &&
+                    app.activeDocument.activeLayer.name !== "Isolation Mode" &&
                     (app.activeDocument.activeLayer.parent &&
                         app.activeDocument.activeLayer.parent.name !== "Symbol Editing Mode")) {
 
                     // Don't call invalidate on Bloks that share the same root BlokContainer since
                     // that's wasted work
-                    let roots = [];
+                    let roots: BlokContainer[] = [];
+                    let isQueued: { [uuid: string]: boolean } = {};
 
                     bloksToBeInvalidated.forEach((blok: Blok) => {
                         let root = blok.getRootContainer();
-                        let alreadyInvalid = false;
+                        let uuid = root.getUuid();
 
-                        roots.forEach((r: BlokContainer) => {
-                            if (r.equals(root)) {
-                                alreadyInvalid = true;
-                            }
-                        });
-
-                        if (!alreadyInvalid) {
+                        if (!isQueued[uuid]) {
+                            isQueued[uuid] = true;
                             roots.push(root);
-                            blok.invalidate();
                         }
                     });
 
+                    // Let the plugin solve the roots in parallel. Anything it can't handle
+                    // gets laid out here
+                    NativeLayout.relayoutRoots(roots).forEach((root: BlokContainer) => {
+                        root.invalidate();
+                    });
+
                     // Clear the list
                     bloksToBeInvalidated.splice(0, bloksToBeInvalidated.length);
                 }
@@ -149,12 +194,40 @@ export function relayoutSelection(): void {
                 let blok = BlokAdapter.getBlok(pageItem);
 
                 if (blok) {
-                    blok.invalidate();
+                    NativeLayout.relayout(blok);
                 }
             }
             else if (BlokAdapter.isBlokContainerAttached(pageItem)) {
                 let blokContainer = BlokAdapter.getBlokContainer(pageItem);
-                blokContainer.invalidate();
+                NativeLayout.relayout(blokContainer);
+            }
+        }
+    }
+    catch (ex) {
+        raiseException(ex);
+    }
+}
+
+/**
+ * Lay out every root BlokContainer in the active document.
+ */
+export function relayoutAll(): void {
+    try {
+        if (isActiveDocumentPresent()) {
+            // The plugin works through it while idle, skipped roots come back on the next
+            // selection change through flushInvalidations()
+            if (!NativeLayout.scheduleRelayoutAll()) {
+                // No plugin, find every root ourselves
+                let doc = app.activeDocument;
+
+                for (let i = 0; i < doc.groupItems.length; i++) {
+                    let groupItem = doc.groupItems[i];
+
+                    if (BlokAdapter.isBlokContainerAttached(groupItem) &&
+                        !BlokAdapter.isBlokContainerAttached(groupItem.parent)) {
+                        BlokAdapter.getBlokContainer(groupItem).invalidate();
+                    }
+                }
             }
         }
     }
@@ -176,25 +249,33 @@ export function updateSelectedBlok(settings: BlokUserSettings): void {
 
             if (BlokAdapter.shouldBlokBeAttached(pageItem)) {
                 let blok = BlokAdapter.getBlok(pageItem, settings);
-                blok.invalidate();
+                NativeLayout.relayout(blok);
             }
             else if (isPageItemSymbolRoot(pageItem)) {
                 let symName = pageItem.parent.name;
                 let blok: Blok = undefined;
 
-                // Use the document's list of symbols to find the Bloks that wrap the symbol
-                for (let i = 0; i < app.activeDocument.symbolItems.length; i++) {
-                    let symItem = app.activeDocument.symbolItems[i];
+                // Find the Bloks that wrap the symbol
+                let symItems = getSymbolItems(symName);
+                let symBloks: Blok[] = [];
+
+                for (let i = 0; i < symItems.length; i++) {
+                    let symItem = symItems[i];
 
-                    if (symItem.symbol.name === symName && BlokAdapter.shouldBlokBeAttached(symItem)) {
+                    if (BlokAdapter.shouldBlokBeAttached(symItem)) {
                         if (!blok) {
                             blok = BlokAdapter.getBlok(pageItem, settings, true);
                         }
 
-                        let symBlok = BlokAdapter.getBlok(symItem, blok.getUserSettings());
-                        bloksToBeInvalidated.push(symBlok);
+                        symBloks.push(BlokAdapter.getBlok(symItem, blok.getUserSettings()));
                     }
                 }
+
+                if (!NativeLayout.queueInvalidation(symBloks)) {
+                    symBloks.forEach((symBlok: Blok) => {
+                        bloksToBeInvalidated.push(symBlok);
+                    });
+                }
             }
             else {
                 throw new Error("We're not updating a Blok!");
@@ -221,7 +302,7 @@ export function updateSelectedBlokContainer(settings: BlokContainerUserSettings)
             }
 
             let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
-            blokContainer.invalidate();
+            NativeLayout.relayout(blokContainer);
         }
         else {
             throw new Error("Can only update one BlokContainer at a time!");
@@ -280,7 +361,7 @@ export function createBlokContainerFromSelection(settings: BlokContainerUserSett
             }
 
             let blokContainer = BlokAdapter.getBlokContainer(groupPageItem, settings);
-            blokContainer.invalidate();
+            NativeLayout.relayout(blokContainer);
         }
         else {
             throw new Error("Must have multiple items selected to group them!");
@@ -293,7 +374,8 @@ export function createBlokContainerFromSelection(settings: BlokContainerUserSett
 
 /**
  * Check the active document's current selection and report back what
- * Bloks can do with it.
+ * Bloks can do with it. The panel only asks when the plugin can't work it
+ * out itself, BlokGetSelectionSummary() has to give the same answer.
  *
  * @returns a JSON string with two properties:
  *     action: number - a single option of what Bloks can do
@@ -349,23 +431,23 @@ export function getActionsFromSelection(): { action: number, blok: any } {
                     else if (isPageItemSymbolRoot(pageItem)) {
                         let symName = pageItem.parent.name;
 
-                        // Use the document's list of symbols to find the Bloks that wrap the symbol
-                        for (let i = 0; i < app.activeDocument.symbolItems.length; i++) {
-                            let symItem = app.activeDocument.symbolItems[i];
+                        // Find the Bloks that wrap the symbol
+                        let symItems = getSymbolItems(symName);
 
-                            if (symItem.symbol.name === symName) {
-                                if (BlokAdapter.shouldBlokBeAttached(symItem)) {
-                                    let blok = BlokAdapter.getBlok(pageItem, undefined, true);
-                                    ret.action = 2;
-                                    ret.blok = blok.getUserSettings();
-                                    //ret.blok.parentBlokContainer = blok.getContainer().getUserSettings();
+                        for (let i = 0; i < symItems.length; i++) {
+                            let symItem = symItems[i];
 
-                                    if (pageItem.typename === "TextFrame" && pageItem.kind === TextType.AREATEXT) {
-                                        ret.blok.isAreaText = true;
-                                    }
+                            if (BlokAdapter.shouldBlokBeAttached(symItem)) {
+                                let blok = BlokAdapter.getBlok(pageItem, undefined, true);
+                                ret.action = 2;
+                                ret.blok = blok.getUserSettings();
+                                //ret.blok.parentBlokContainer = blok.getContainer().getUserSettings();
 
-                                    break;
+                                if (pageItem.typename === "TextFrame" && pageItem.kind === TextType.AREATEXT) {
+                                    ret.blok.isAreaText = true;
                                 }
+
+                                break;
                             }
                         }
                     }
@@ -387,13 +469,62 @@ export function getActionsFromSelection(): { action: number, blok: any } {
     }
 }
 
+/**
+ * One-shot migration from .spacer art to gap. Every BlokContainer in the active
+ * document whose children alternate with same-sized .spacers loses the .spacers
+ * and gets a gap instead, then its root is laid out again.
+ */
+export function convertSpacersToGap(): void {
+    try {
+        if (isActiveDocumentPresent()) {
+            let doc = app.activeDocument;
+            let containers: BlokContainer[] = [];
+            let roots: BlokContainer[] = [];
+            let isQueued: { [uuid: string]: boolean } = {};
+
+            // Find them all first, removing .spacers changes the collection
+            for (let i = 0; i < doc.groupItems.length; i++) {
+                let groupItem = doc.groupItems[i];
+
+                if (BlokAdapter.isBlokContainerAttached(groupItem)) {
+                    containers.push(BlokAdapter.getBlokContainer(groupItem));
+                }
+            }
+
+            containers.forEach((container) => {
+                if (container.convertSpacersToGap()) {
+                    let root = container.getRootContainer();
+                    let uuid = root.getUuid();
+
+                    if (!isQueued[uuid]) {
+                        isQueued[uuid] = true;
+                        roots.push(root);
+                    }
+                }
+            });
+
+            NativeLayout.relayoutRoots(roots).forEach((root: BlokContainer) => {
+                root.invalidate();
+            });
+        }
+    }
+    catch (ex) {
+        raiseException(ex);
+    }
+}
+
 /**
  * Look for PageItems with ".spacer" in their name and change their opacity.
+ * The native plugin does this from its index of spacers, without this scan.
  *
  * @param opacity - the new opacity value
  */
 function changeSpacerOpacity(opacity: number): void {
     try {
+        if (NativeLayout.setSpacerOpacity(opacity)) {
+            return;
+        }
+
         let pageItems = app.activeDocument.pageItems;
 
         for (let i = 0; i < pageItems.length; i++) {
@@ -431,4 +562,35 @@ export function hideSpacers(): void {
 
 export function showSpacers(): void {
     changeSpacerOpacity(100.0);
+}
+
+/**
+ * Start or end a panel edit session, see NativeLayout.setUndoSession. Without
+ * the plugin every edit keeps its own undo step.
+ *
+ * @param isInSession - true when the panel starts being edited, false after
+ */
+export function setUndoSession(isInSession: boolean): void {
+    try {
+        NativeLayout.setUndoSession(isInSession);
+    }
+    catch (ex) {
+        raiseException(ex);
+    }
+}
+
+/**
+ * Show or hide the native layout box overlay. Only the plugin can draw it.
+ *
+ * @param isVisible - true to show it
+ */
+export function setDebugOverlay(isVisible: boolean): void {
+    try {
+        if (!NativeLayout.setDebugOverlay(isVisible) && isVisible) {
+            throw new Error("Layout boxes need BloksAIPlugin!");
+        }
+    }
+    catch (ex) {
+        raiseException(ex);
+    }
 }
\ No newline at end of file
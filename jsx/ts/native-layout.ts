@@ -0,0 +1,236 @@
+/// <reference path="./typings/noderequire.d.ts" />
+/// <reference path="./typings/illustrator.d.ts" />
+
+// Hands layout work to BloksAIPlugin. The plugin snapshots each root BlokContainer,
+// solves them all in parallel and applies the results. Everything here falls back
+// gracefully if the plugin isn't installed.
+
+"use strict";
+
+import Blok = require("./blok");
+import BlokContainer = require("./blok-container");
+
+var JSON2: any = require("JSON2");
+
+/**
+ * Send a message to the native plugin.
+ *
+ * @param selector - name of the operation
+ * @param input - string handed to the plugin
+ * @returns the parsed JSON result, or undefined if the plugin isn't there
+ * @throws if the plugin ran the operation and it failed. Whatever it applied has
+ *         been taken back by then
+ */
+function sendMessage(selector: string, input: string): any {
+    let result = undefined;
+
+    try {
+        let ret = app.sendScriptMessage("BloksAIPlugin", selector, input);
+
+        if (ret) {
+            result = JSON2.parse(ret);
+        }
+    }
+    catch (ex) {
+        // Plugin isn't loaded. The caller falls back to TypeScript
+    }
+
+    if (result && result.error !== undefined) {
+        throw new Error("BloksAIPlugin " + selector + " failed with error " + result.error);
+    }
+
+    return result;
+}
+
+/**
+ * Lay out a set of root BlokContainers natively.
+ *
+ * @param roots - root BlokContainers, without duplicates
+ * @returns the roots that the plugin couldn't lay out. Call invalidate() on them
+ */
+export function relayoutRoots(roots: BlokContainer[]): BlokContainer[] {
+    if (roots.length === 0) {
+        return [];
+    }
+
+    let uuids: string[] = [];
+
+    roots.forEach((root: BlokContainer) => {
+        uuids.push(root.getUuid());
+    });
+
+    let result = sendMessage("relayoutRoots", uuids.join(","));
+
+    if (!result) {
+        return roots.slice(0);
+    }
+
+    let remaining: BlokContainer[] = [];
+
+    roots.forEach((root: BlokContainer) => {
+        let uuid = root.getUuid();
+
+        for (let i = 0; i < result.skipped.length; i++) {
+            if (result.skipped[i] === uuid) {
+                remaining.push(root);
+                break;
+            }
+        }
+    });
+
+    return remaining;
+}
+
+/**
+ * Solve a set of root BlokContainers natively and check each against a plain
+ * serial solve, without the measure cache, copying identical siblings or the
+ * thread pool. Nothing in the document changes.
+ *
+ * @param roots - root BlokContainers, without duplicates
+ * @returns stats like relayoutRoots() gets, roots that didn't match are listed (by uuid)
+ *          in mismatched. undefined if the plugin isn't available
+ */
+export function checkRoots(roots: BlokContainer[]): any {
+    let uuids: string[] = [];
+
+    roots.forEach((root: BlokContainer) => {
+        uuids.push(root.getUuid());
+    });
+
+    return sendMessage("checkRoots", uuids.join(","));
+}
+
+/**
+ * Lay out the tree a Blok is in after an edit, natively if the plugin can and
+ * with invalidate() if it can't. Use this rather than invalidate() for anything
+ * the user does: baseline alignment and autoHeight text only lay out natively,
+ * and only native layouts share undo steps, see setUndoSession().
+ *
+ * @param blok - any Blok or BlokContainer in the tree
+ */
+export function relayout(blok: Blok): void {
+    relayoutRoots([blok.getRootContainer()]).forEach((root: BlokContainer) => {
+        root.invalidate();
+    });
+}
+
+/**
+ * Lay out every root BlokContainer in the active document natively.
+ *
+ * @returns the roots that the plugin couldn't lay out (by uuid), or undefined if the
+ *          plugin isn't available
+ */
+export function relayoutAll(): string[] {
+    let result = sendMessage("relayoutAll", "");
+
+    if (!result) {
+        return undefined;
+    }
+
+    return result.skipped;
+}
+
+/**
+ * Lay out every root BlokContainer in the active document natively, a few at a
+ * time while Illustrator is idle. Roots the plugin can't lay out come back from
+ * flushInvalidations().
+ *
+ * @returns true if the plugin scheduled it, false if the caller should do it
+ */
+export function scheduleRelayoutAll(): boolean {
+    return sendMessage("scheduleRelayoutAll", "") !== undefined;
+}
+
+/**
+ * Set the opacity of every .spacer in the active document natively, once
+ * Illustrator is idle. The plugin keeps an index of them, so the rest of the
+ * document is never scanned.
+ *
+ * @param opacity - 0 to 100, like pageItem.opacity
+ * @returns true if the plugin handled it, false if the caller should do it
+ */
+export function setSpacerOpacity(opacity: number): boolean {
+    return sendMessage("setSpacerOpacity", String(opacity / 100)) !== undefined;
+}
+
+/**
+ * Start or end a panel edit session. Every relayout during one shares a
+ * single undo step, so typing values into the panel can be undone at once.
+ *
+ * @param isInSession - true when the panel starts being edited, false after
+ * @returns true if the plugin handled it, false if the plugin isn't available
+ */
+export function setUndoSession(isInSession: boolean): boolean {
+    return sendMessage("setUndoSession", isInSession ? "true" : "false") !== undefined;
+}
+
+/**
+ * Show or hide the plugin's layout box overlay. It outlines every Blok's
+ * layout box, the padding from .bg names, Bloks that flex and the ones the
+ * last relayout changed, each in its own color.
+ *
+ * @param isVisible - true to show it
+ * @returns true if the plugin handled it, false if the plugin isn't available
+ */
+export function setDebugOverlay(isVisible: boolean): boolean {
+    return sendMessage("setDebugOverlay", isVisible ? "true" : "false") !== undefined;
+}
+
+/**
+ * Find every instance of a symbol natively. The plugin keeps an index of
+ * instances by symbol, so other SymbolItems are never looked at.
+ *
+ * @param symbolName - name of the symbol
+ * @returns its SymbolItems, or undefined if the plugin isn't available
+ */
+export function getSymbolInstances(symbolName: string): any[] {
+    let result = sendMessage("getSymbolInstances", symbolName);
+
+    if (!result) {
+        return undefined;
+    }
+
+    let doc = app.activeDocument;
+    let instances = [];
+
+    result.instances.forEach((uuid: string) => {
+        instances.push(doc.getPageItemFromUuid(uuid));
+    });
+
+    return instances;
+}
+
+/**
+ * Queue Bloks to be laid out once Illustrator allows it again. The plugin keeps
+ * one entry per root BlokContainer and lays them out itself when Isolation or
+ * Symbol Editing Mode is left.
+ *
+ * @param bloks - any Bloks, duplicates and Bloks sharing a root are fine
+ * @returns true if the plugin queued them, false if the caller should
+ */
+export function queueInvalidation(bloks: Blok[]): boolean {
+    let uuids: string[] = [];
+
+    bloks.forEach((blok: Blok) => {
+        uuids.push(blok.getUuid());
+    });
+
+    return sendMessage("queueInvalidation", uuids.join(",")) !== undefined;
+}
+
+/**
+ * Schedule whatever queueInvalidation() is still holding, if Illustrator allows it.
+ * The plugin lays it out while idle.
+ *
+ * @returns the roots the plugin couldn't lay out so far (by uuid), or undefined if the
+ *          plugin isn't available
+ */
+export function flushInvalidations(): string[] {
+    let result = sendMessage("flushInvalidations", "");
+
+    if (!result) {
+        return undefined;
+    }
+
+    return result.skipped;
+}
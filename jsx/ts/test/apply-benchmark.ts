@@ -0,0 +1,64 @@
+/// <reference path="../typings/noderequire.d.ts" />
+/// <reference path="../typings/illustrator.d.ts" />
+
+"use strict";
+
+// Typescript imports
+import BlokAdapter = require("../blok-adapter");
+
+// npm imports
+var JSON2: any = require("JSON2");
+
+// To run:
+//     install BloksAIPlugin
+//     open a document with Bloks in it (sample-files/variable-list.ai works well)
+//     connect ExtendScript Toolkit to Illustrator
+//     run
+//
+// Lays out every root BlokContainer in the active document with the TypeScript
+// path (BlokContainer.invalidate()) and then natively, and reports the wall time
+// per node of each along with the SDK calls per node the native apply made.
+
+function relayoutNatively(): any {
+    return JSON2.parse(app.sendScriptMessage("BloksAIPlugin", "relayoutAll", ""));
+}
+
+function relayoutInTypeScript(): void {
+    let doc = app.activeDocument;
+
+    for (let i = 0; i < doc.groupItems.length; i++) {
+        let groupItem = doc.groupItems[i];
+
+        if (BlokAdapter.isBlokContainerAttached(groupItem) &&
+            !BlokAdapter.isBlokContainerAttached(groupItem.parent)) {
+            BlokAdapter.getBlokContainer(groupItem).invalidate();
+        }
+    }
+}
+
+function runBenchmark() {
+    // Settle the document first so both paths start from the same layout
+    let stats = relayoutNatively();
+    let nodes = stats.nodes > 0 ? stats.nodes : 1;
+
+    // Reading hiresTimer resets it, the value is in microseconds
+    $.hiresTimer;
+    relayoutInTypeScript();
+    let scriptMs = $.hiresTimer / 1000;
+
+    $.hiresTimer;
+    stats = relayoutNatively();
+    let nativeMs = $.hiresTimer / 1000;
+
+    let summary = stats.roots + " roots, " + stats.nodes + " nodes" +
+        "\n\nTypeScript: " + scriptMs.toFixed(2) + "ms, " + (scriptMs / nodes).toFixed(4) + "ms per node" +
+        "\n\nNative: " + nativeMs.toFixed(2) + "ms, " + (nativeMs / nodes).toFixed(4) + "ms per node" +
+        "\n    apply: " + stats.applyMs.toFixed(2) + "ms, " + stats.applyMsPerNode.toFixed(4) + "ms per node" +
+        "\n    SDK calls: " + stats.applyCalls + ", " + stats.applyCallsPerNode.toFixed(2) + " per node" +
+        "\n    art transformed: " + stats.changed;
+
+    $.writeln(summary);
+    alert(summary);
+}
+
+runBenchmark();
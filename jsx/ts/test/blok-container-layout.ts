@@ -13,6 +13,7 @@ import BlokContainerUserSettings = require("../blok-container-user-settings");
 import BlokAdapter = require("../blok-adapter");
 import Rect = require("../rect");
 import Css = require("../css");
+import NativeLayout = require("../native-layout");
 
 // npm imports
 var JSON2: any = require("JSON2");
@@ -303,6 +304,54 @@ function testTextFrameAreaMiddle() {
     Assert.areEqual(textFrame.textRange.autoLeading, true);
 }
 
+/** autoHeight area text is as tall as its text at whatever width it's laid out at */
+function testTextFrameAreaAutoHeight() {
+    let pageItem = app.activeDocument.pageItems[0];
+    let textFrame = pageItem.pageItems[0];
+    textFrame.contents = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore.";
+
+    let childSettings = new BlokUserSettings();
+    childSettings.autoHeight = true;
+    BlokAdapter.getBlok(textFrame, childSettings);
+
+    // Only the native layout measures text
+    NativeLayout.relayout(BlokAdapter.getBlokContainer(pageItem));
+
+    let wideRect = BlokAdapter.getBlok(textFrame).getRect();
+    Assert.areEqual(wideRect.getWidth(), 144);
+
+    // Half as wide takes more lines
+    textFrame.textPath.width = 72;
+    NativeLayout.relayout(BlokAdapter.getBlokContainer(pageItem));
+
+    let narrowRect = BlokAdapter.getBlok(textFrame).getRect();
+    Assert.areEqual(narrowRect.getWidth(), 72);
+    Assert.isTrue(narrowRect.getHeight() > wideRect.getHeight());
+
+    // The frame was resized around the text, the text itself wasn't scaled
+    Assert.areEqual(textFrame.textRange.horizontalScale, 100);
+    Assert.areEqual(textFrame.textRange.verticalScale, 100);
+    Assert.areEqual(textFrame.textRange.size, 12);
+    Assert.areEqual(textFrame.textRange.autoLeading, true);
+
+    // A trailing space doesn't wrap, but it's text the measure cache hasn't seen
+    let contents = textFrame.contents;
+    textFrame.contents = contents + " ";
+    app.redraw(); // Create undo waypoint 1
+
+    app.activeDocument.saved = true;
+    NativeLayout.relayout(BlokAdapter.getBlokContainer(pageItem));
+    app.redraw(); // Would be undo waypoint 2, if measuring left one
+
+    // Measuring edits the text and puts it back exactly, nothing moved and nothing is dirty
+    Assert.areEqual(BlokAdapter.getBlok(textFrame).getRect().getHeight(), narrowRect.getHeight());
+    Assert.isTrue(app.activeDocument.saved);
+
+    // So undo takes back the space, not an empty layout step
+    app.undo();
+    Assert.areEqual(textFrame.contents, contents);
+}
+
 function testInteractiveResizeRow() {
     let pageItem = app.activeDocument.pageItems[0];
     app.activeDocument.selection = pageItem; // Select it
@@ -612,6 +661,268 @@ function testInteractiveResizeNested() {
     Assert.isTrue(secondBlokContainer.getRect().equals(new Rect([139.5, 0, 139.5 + 78, 162])));
 }
 
+function testGapRow() {
+    let pageItem = app.activeDocument.pageItems[0];
+
+    let settings = new BlokContainerUserSettings();
+    settings.gap = 20;
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    Assert.areEqual(blokContainer.getGap(), 20);
+
+    let cssNode = blokContainer.computeCssNode();
+
+    // Every child but the first is pushed along by the gap
+    Assert.areEqual(cssNode.children[0].style.marginLeft, undefined);
+    Assert.areEqual(cssNode.children[1].style.marginLeft, 20);
+
+    // Now layout
+    blokContainer.invalidate();
+
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 170, 200])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[1]).getRect().equals(new Rect([0, 0, 100, 100])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[0]).getRect().equals(new Rect([120, 0, 170, 200])));
+}
+
+function testGapColumn() {
+    let pageItem = app.activeDocument.pageItems[0];
+
+    let settings = new BlokContainerUserSettings();
+    settings.flexDirection = Css.FlexDirections.COLUMN;
+    settings.gap = 20;
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    let cssNode = blokContainer.computeCssNode();
+
+    Assert.areEqual(cssNode.children[1].style.marginTop, 20);
+    Assert.areEqual(cssNode.children[1].style.marginLeft, undefined);
+
+    // Now layout
+    blokContainer.invalidate();
+
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 100, 320])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[0]).getRect().equals(new Rect([0, 120, 50, 320])));
+}
+
+/** The gap comes out of the free space, space-between spreads what's left on top of it */
+function testGapRowSpaceBetween() {
+    let pageItem = app.activeDocument.pageItems[0];
+
+    let settings = new BlokContainerUserSettings();
+    settings.justifyContent = Css.Justifications.SPACE_BETWEEN;
+    settings.gap = 10;
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    // Now layout
+    blokContainer.invalidate();
+
+    // Should not have changed width. 444 - 294 of children - 2 gaps leaves 65 on top of each gap
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 444, 200])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[2]).getRect().equals(new Rect([0, 0, 100, 100])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[1]).getRect().equals(new Rect([175, 0, 225, 200])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[0]).getRect().equals(new Rect([300, 0, 444, 65])));
+}
+
+function testInteractiveResizeRowDistributedGap() {
+    let pageItem = app.activeDocument.pageItems[0];
+    app.activeDocument.selection = pageItem; // Select it
+
+    let settings = new BlokContainerUserSettings();
+    settings.justifyContent = Css.Justifications.SPACE_BETWEEN;
+    settings.gap = 10;
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    blokContainer.invalidate();
+    app.redraw(); // Create undo waypoint 1
+
+    pageItem.width = 600; // Resize width
+    app.redraw(); // Create undo waypoint 2
+
+    // Attempt relayout
+    blokContainer.checkForRelayout(app.activeDocument.selection);
+
+    // Verify that it is the new width, with the gaps kept and the rest spread out
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 600, 200])));
+    Assert.areEqual(pageItem.width, 600);
+
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[2]).getRect().equals(new Rect([0, 0, 100, 100])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[1]).getRect().equals(new Rect([253, 0, 303, 200])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[0]).getRect().equals(new Rect([456, 0, 600, 65])));
+}
+
+/**
+ * Add a .spacer to a GroupItem and send it back behind some of its children.
+ *
+ * @param groupItem - the GroupItem to add it to
+ * @param width - of the spacer
+ * @param height - of the spacer
+ * @param backward - number of times to send it backward
+ */
+function addSpacer(groupItem: any, width: number, height: number, backward: number): any {
+    let spacer = groupItem.pathItems.rectangle(groupItem.top, groupItem.left, width, height);
+    spacer.name = ".spacer";
+
+    for (let i = 0; i < backward; i++) {
+        spacer.zOrder(ZOrderMethod.SENDBACKWARD);
+    }
+
+    return spacer;
+}
+
+function testSpacersToGap() {
+    let pageItem = app.activeDocument.pageItems[0];
+    addSpacer(pageItem, 30, 10, 1);
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem);
+    blokContainer.invalidate();
+
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 180, 200])));
+
+    Assert.isTrue(blokContainer.convertSpacersToGap());
+    Assert.areEqual(pageItem.pageItems.length, 2);
+    Assert.areEqual(blokContainer.getGap(), 30);
+
+    blokContainer.invalidate();
+
+    // Nothing moved
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 180, 200])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[0]).getRect().equals(new Rect([130, 0, 180, 200])));
+}
+
+function testSpacersToGapMismatched() {
+    let pageItem = app.activeDocument.pageItems[0];
+    addSpacer(pageItem, 30, 10, 1);
+    addSpacer(pageItem, 40, 10, 3);
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem);
+
+    // Spacers of different sizes can't be one gap, so they're left alone
+    Assert.areEqual(blokContainer.convertSpacersToGap(), false);
+    Assert.areEqual(pageItem.pageItems.length, 5);
+    Assert.areEqual(blokContainer.getGap(), undefined);
+}
+
+function testSpacersToGapTallSpacer() {
+    let pageItem = app.activeDocument.pageItems[0];
+    addSpacer(pageItem, 30, 300, 1);
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem);
+
+    // The .spacer is what makes the row 300 tall, taking it out would shrink it
+    Assert.areEqual(blokContainer.convertSpacersToGap(), false);
+    Assert.areEqual(pageItem.pageItems.length, 3);
+    Assert.areEqual(blokContainer.getGap(), undefined);
+}
+
+/**
+ * Duplicate the area text of blok-container-layout-one-deep-textframearea.ai
+ * with bigger text, whose first baseline is further below its top.
+ *
+ * @param pageItem - the fixture's BlokContainer
+ * @returns the new TextFrame, on top of the others so it's the last child
+ */
+function addBigText(pageItem: any): any {
+    let bigTextFrame = pageItem.pageItems[0].duplicate(pageItem, ElementPlacement.PLACEATBEGINNING);
+    bigTextFrame.textRange.characterAttributes.size = 24;
+
+    return bigTextFrame;
+}
+
+/** Baseline alignment only lays out natively, see NativeLayout.relayout() */
+function testBaselineRow() {
+    let pageItem = app.activeDocument.pageItems[0];
+    let bigTextFrame = addBigText(pageItem);
+    let textFrame = pageItem.pageItems[1];
+
+    let settings = new BlokContainerUserSettings();
+    settings.alignItems = Css.Alignments.BASELINE;
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    NativeLayout.relayout(blokContainer);
+
+    // Art other than text hangs from its bottom edge, the 50x200 one is the lowest
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[3]).getRect().equals(new Rect([0, 100, 100, 200])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[2]).getRect().equals(new Rect([100, 0, 150, 200])));
+
+    // Both first baselines are on the bottom edges, the bigger text's is further down its frame
+    let textTop = BlokAdapter.getBlok(textFrame).getRect().getTop();
+    let bigTextTop = BlokAdapter.getBlok(bigTextFrame).getRect().getTop();
+
+    Assert.isTrue(textTop > 200 - 65 && textTop < 200);
+    Assert.isTrue(bigTextTop < textTop);
+
+    Assert.areEqual(blokContainer.getRect().getBottom(), textTop + 65);
+    Assert.areEqual(textFrame.textRange.horizontalScale, 100);
+    Assert.areEqual(bigTextFrame.textRange.size, 24);
+}
+
+/** Only children that are baseline aligned line up, the rest keep to the top */
+function testBaselineAlignSelf() {
+    let pageItem = app.activeDocument.pageItems[0];
+    let bigTextFrame = addBigText(pageItem);
+    let textFrame = pageItem.pageItems[1];
+
+    let childSettings = new BlokUserSettings();
+    childSettings.alignSelf = Css.Alignments.BASELINE;
+    BlokAdapter.getBlok(textFrame, childSettings);
+    BlokAdapter.getBlok(bigTextFrame, childSettings);
+
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem);
+
+    NativeLayout.relayout(blokContainer);
+
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[3]).getRect().equals(new Rect([0, 0, 100, 100])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[2]).getRect().equals(new Rect([100, 0, 150, 200])));
+
+    // The bigger text's baseline is the lowest, so it stays at the top and the other comes down to it
+    Assert.areEqual(BlokAdapter.getBlok(bigTextFrame).getRect().getTop(), 0);
+    Assert.isTrue(BlokAdapter.getBlok(textFrame).getRect().getTop() > 0);
+}
+
+/** Baselines only line up across a row, a column treats baseline as flex-start */
+function testBaselineColumn() {
+    let pageItem = app.activeDocument.pageItems[0];
+
+    let settings = new BlokContainerUserSettings();
+    settings.flexDirection = Css.FlexDirections.COLUMN;
+    settings.alignItems = Css.Alignments.BASELINE;
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    NativeLayout.relayout(blokContainer);
+
+    Assert.isTrue(blokContainer.getRect().equals(new Rect([0, 0, 144, 365])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[2]).getRect().equals(new Rect([0, 0, 100, 100])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[1]).getRect().equals(new Rect([0, 100, 50, 300])));
+    Assert.isTrue(BlokAdapter.getBlok(pageItem.pageItems[0]).getRect().equals(new Rect([0, 300, 144, 365])));
+}
+
+/** A nested BlokContainer's baseline is its first child's */
+function testBaselineNested() {
+    let pageItem = app.activeDocument.pageItems[0];
+    let textFrame = pageItem.pageItems[0];
+
+    // The same text on its own in a container
+    let groupItem = pageItem.groupItems.add();
+    let nestedTextFrame = textFrame.duplicate(groupItem, ElementPlacement.PLACEATBEGINNING);
+    BlokAdapter.getBlokContainer(groupItem);
+
+    let settings = new BlokContainerUserSettings();
+    settings.alignItems = Css.Alignments.BASELINE;
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+
+    NativeLayout.relayout(blokContainer);
+
+    // Same baseline as the text beside it, so the same top
+    let textTop = BlokAdapter.getBlok(textFrame).getRect().getTop();
+
+    Assert.isTrue(textTop > 0);
+    Assert.areEqual(BlokAdapter.getBlokContainer(groupItem).getRect().getTop(), textTop);
+    Assert.areEqual(BlokAdapter.getBlok(nestedTextFrame).getRect().getTop(), textTop);
+}
+
 TestFramework.run("blok-container-layout-one-deep.ai", testOneDeepRow);
 TestFramework.run("blok-container-layout-one-deep.ai", testOneDeepRowStretch);
 TestFramework.run("blok-container-layout-one-deep.ai", testOneDeepRowChildStretch);
@@ -626,10 +937,22 @@ TestFramework.run("blok-container-layout-strokes.ai", testStrokes);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testTextFrameArea);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testTextFrameAreaStretch);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testTextFrameAreaMiddle);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testTextFrameAreaAutoHeight);
 TestFramework.run("blok-container-layout-one-deep.ai", testInteractiveResizeRow);
 TestFramework.run("blok-container-layout-one-deep.ai", testInteractiveResizeColumn);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testInteractiveResizeRowDistributed);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testInteractiveResizeColumnDistributed);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testInteractiveResizeRowDistributedStretch);
 TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testInteractiveResizeRowDistributedChildStretch);
-TestFramework.run("blok-container-layout-nested-groups-alt.ai", testInteractiveResizeNested);
\ No newline at end of file
+TestFramework.run("blok-container-layout-nested-groups-alt.ai", testInteractiveResizeNested);
+TestFramework.run("blok-container-layout-one-deep.ai", testGapRow);
+TestFramework.run("blok-container-layout-one-deep.ai", testGapColumn);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testGapRowSpaceBetween);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testInteractiveResizeRowDistributedGap);
+TestFramework.run("blok-container-layout-one-deep.ai", testSpacersToGap);
+TestFramework.run("blok-container-layout-one-deep-3.ai", testSpacersToGapMismatched);
+TestFramework.run("blok-container-layout-one-deep.ai", testSpacersToGapTallSpacer);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testBaselineRow);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testBaselineAlignSelf);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testBaselineColumn);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testBaselineNested);
@@ -0,0 +1,77 @@
+/// <reference path="../typings/noderequire.d.ts" />
+/// <reference path="../typings/illustrator.d.ts" />
+
+"use strict";
+
+// npm imports
+var JSON2: any = require("JSON2");
+
+// To run:
+//     install BloksAIPlugin
+//     connect ExtendScript Toolkit to Illustrator
+//     run
+//
+// Solves generated trees in the native plugin, so no document is needed. Scenarios
+// compare thread counts, SIMD kernel levels, the axis-specialized solver, the
+// measure cache, structural dedup and re-solving a resize drag frame by frame.
+
+function runBenchmark() {
+    let report = JSON2.parse(app.sendScriptMessage("BloksAIPlugin", "benchmark", ""));
+    let summary = "Cores: " + report.cores;
+
+    report.scenarios.forEach((scenario) => {
+        summary += "\n\n" + scenario.name;
+
+        if (scenario.nodes !== undefined) {
+            summary += " (" + scenario.trees + " trees, " + scenario.nodes + " nodes)";
+        }
+
+        if (scenario.runs) {
+            summary += "\n    serial: " + scenario.serialMs.toFixed(2) + "ms";
+
+            scenario.runs.forEach((run) => {
+                summary += "\n    " + run.threads + " threads: " + run.ms.toFixed(2) + "ms, " +
+                    run.speedup.toFixed(2) + "x" + (run.identical ? "" : " MISMATCH");
+            });
+        }
+
+        if (scenario.kernels) {
+            scenario.kernels.forEach((kernel) => {
+                summary += "\n    " + kernel.level + ": " + kernel.ms.toFixed(2) + "ms, " +
+                    kernel.speedup.toFixed(2) + "x, max error " + kernel.maxError;
+            });
+        }
+
+        if (scenario.specializedMs !== undefined) {
+            summary += "\n    runtime: " + scenario.runtimeMs.toFixed(2) + "ms" +
+                "\n    specialized: " + scenario.specializedMs.toFixed(2) + "ms, " +
+                scenario.speedup.toFixed(2) + "x" + (scenario.identical ? "" : " MISMATCH");
+        }
+
+        if (scenario.passes) {
+            scenario.passes.forEach((pass) => {
+                summary += "\n    " + pass.pass + ": " + pass.ms.toFixed(3) + "ms, " +
+                    pass.hits + " hits, " + pass.misses + " misses" + (pass.identical ? "" : " MISMATCH");
+            });
+        }
+
+        if (scenario.lists) {
+            scenario.lists.forEach((list) => {
+                summary += "\n    " + list.name + " (" + list.nodes + " nodes): " + list.ms.toFixed(2) + "ms, " +
+                    (list.dedupRatio * 100).toFixed(1) + "% copied";
+            });
+        }
+
+        if (scenario.frames !== undefined) {
+            summary += "\n    cold: " + scenario.coldMs.toFixed(3) + "ms" +
+                "\n    " + scenario.frames + " frames: median " + scenario.medianMs.toFixed(3) + "ms, max " +
+                scenario.maxMs.toFixed(3) + "ms, " + scenario.missesPerFrame.toFixed(1) + " misses per frame" +
+                "\n    over " + scenario.budgetMs + "ms budget: " + scenario.overBudget;
+        }
+    });
+
+    $.writeln(summary);
+    alert(summary);
+}
+
+runBenchmark();
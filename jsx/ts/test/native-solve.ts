@@ -0,0 +1,236 @@
+/// <reference path="../typings/noderequire.d.ts" />
+/// <reference path="../typings/illustrator.d.ts" />
+
+"use strict";
+
+// Typescript imports
+import Assert = require("./assert");
+import TestFramework = require("./test-framework");
+import BlokContainer = require("../blok-container");
+import BlokContainerUserSettings = require("../blok-container-user-settings");
+import BlokAdapter = require("../blok-adapter");
+import Rect = require("../rect");
+import Css = require("../css");
+import NativeLayout = require("../native-layout");
+
+// To run:
+//     install BloksAIPlugin
+//     connect ExtendScript Toolkit to Illustrator
+//     run
+//
+// Solves every root in real documents the way a relayout does, with the measure
+// cache, copies of identical siblings and the thread pool, and checks that each
+// matches a plain serial solve. The document isn't changed. The parity tests
+// lay each fixture out both ways, in the document, and compare the rects.
+
+/** Every root BlokContainer in the active document */
+function getRoots(): BlokContainer[] {
+    let doc = app.activeDocument;
+    let roots: BlokContainer[] = [];
+
+    for (let i = 0; i < doc.groupItems.length; i++) {
+        let groupItem = doc.groupItems[i];
+
+        if (BlokAdapter.isBlokContainerAttached(groupItem) &&
+            !BlokAdapter.isBlokContainerAttached(groupItem.parent)) {
+            roots.push(BlokAdapter.getBlokContainer(groupItem));
+        }
+    }
+
+    return roots;
+}
+
+/**
+ * Check the roots against a serial solve and return the stats.
+ *
+ * @param roots - root BlokContainers
+ */
+function checkRoots(roots: BlokContainer[]): any {
+    let result = NativeLayout.checkRoots(roots);
+
+    Assert.isTrue(result !== undefined); // BloksAIPlugin is installed
+    Assert.areEqual(result.roots + result.skipped.length, roots.length);
+    Assert.areEqual(result.mismatched.length, 0);
+
+    return result;
+}
+
+/** Lay out the first root of a fixture, then check it */
+function testFixture() {
+    let pageItem = app.activeDocument.pageItems[0];
+    BlokAdapter.getBlokContainer(pageItem).invalidate();
+
+    let result = checkRoots([BlokAdapter.getBlokContainer(pageItem)]);
+
+    Assert.areEqual(result.roots, 1);
+
+    // Solved again with one leaf dirty, its siblings come from the cache
+    Assert.isTrue(result.cacheHits > 0);
+}
+
+/** Every root of a sample document, as it was saved */
+function testSampleFile() {
+    let roots = getRoots();
+
+    Assert.isTrue(roots.length > 0);
+
+    checkRoots(roots);
+}
+
+/** A column of identical rows, all but the first copy its layout */
+function testRepeatedRows() {
+    let row = app.activeDocument.pageItems[0];
+    BlokAdapter.getBlokContainer(row).invalidate();
+
+    let list = app.activeDocument.groupItems.add();
+    row.move(list, ElementPlacement.PLACEATEND);
+
+    for (let i = 0; i < 5; i++) {
+        row.duplicate(list, ElementPlacement.PLACEATEND);
+    }
+
+    let settings = new BlokContainerUserSettings();
+    settings.flexDirection = Css.FlexDirections.COLUMN;
+    let blokContainer = BlokAdapter.getBlokContainer(list, settings);
+    blokContainer.invalidate();
+
+    let result = checkRoots([blokContainer]);
+
+    Assert.isTrue(result.dedupHits > 0);
+}
+
+/** Roots that don't share anything, solved side by side on the pool */
+function testManyRoots() {
+    let root = app.activeDocument.pageItems[0];
+    BlokAdapter.getBlokContainer(root).invalidate();
+
+    for (let i = 0; i < 8; i++) {
+        root.duplicate().translate(0, -(i + 1) * 300);
+    }
+
+    let roots = getRoots();
+
+    Assert.areEqual(roots.length, 9);
+
+    checkRoots(roots);
+}
+
+/**
+ * Collect the art of a BlokContainer and every Blok under it, depth first.
+ *
+ * @param pageItem - a BlokContainer's art
+ * @param pageItems - gets the art
+ */
+function getBlokPageItems(pageItem: any, pageItems: any[]): void {
+    pageItems.push(pageItem);
+
+    for (let i = 0; i < pageItem.pageItems.length; i++) {
+        let child = pageItem.pageItems[i];
+
+        if (BlokAdapter.isBlokContainerAttached(child)) {
+            getBlokPageItems(child, pageItems);
+        }
+        else if (BlokAdapter.isBlokAttached(child)) {
+            pageItems.push(child);
+        }
+    }
+}
+
+/** The rects of every Blok in pageItems, as getRect() sees them */
+function getRects(pageItems: any[]): Rect[] {
+    let rects: Rect[] = [];
+
+    pageItems.forEach((pageItem: any) => {
+        if (BlokAdapter.isBlokContainerAttached(pageItem)) {
+            rects.push(BlokAdapter.getBlokContainer(pageItem).getRect());
+        }
+        else {
+            rects.push(BlokAdapter.getBlok(pageItem).getRect());
+        }
+    });
+
+    return rects;
+}
+
+/**
+ * Lay out the first root of a fixture with invalidate(), knock every Blok under it
+ * out of place, lay it out again natively and check that each one lands where
+ * invalidate() put it.
+ *
+ * @param settings - optional user settings for the root
+ */
+function checkParity(settings?: BlokContainerUserSettings): void {
+    let pageItem = app.activeDocument.pageItems[0];
+    let blokContainer = BlokAdapter.getBlokContainer(pageItem, settings);
+    blokContainer.invalidate();
+
+    let pageItems: any[] = [];
+    getBlokPageItems(pageItem, pageItems);
+
+    let expected = getRects(pageItems);
+
+    // Sizes stay, so only the positions are left for the native layout to solve
+    for (let i = 1; i < pageItems.length; i++) {
+        pageItems[i].translate(7 * i, -5 * i);
+    }
+
+    let skipped = NativeLayout.relayoutRoots([blokContainer]);
+
+    Assert.areEqual(skipped.length, 0);
+
+    let actual = getRects(pageItems);
+
+    for (let i = 0; i < expected.length; i++) {
+        Assert.areEqual(actual[i].getLeft(), expected[i].getLeft());
+        Assert.areEqual(actual[i].getTop(), expected[i].getTop());
+        Assert.areEqual(actual[i].getWidth(), expected[i].getWidth());
+        Assert.areEqual(actual[i].getHeight(), expected[i].getHeight());
+    }
+}
+
+/** Native layout puts every Blok of a fixture where invalidate() does */
+function testParity() {
+    checkParity();
+}
+
+function testParityGapRow() {
+    let settings = new BlokContainerUserSettings();
+    settings.gap = 20;
+
+    checkParity(settings);
+}
+
+function testParityGapColumn() {
+    let settings = new BlokContainerUserSettings();
+    settings.flexDirection = Css.FlexDirections.COLUMN;
+    settings.gap = 20;
+
+    checkParity(settings);
+}
+
+function testParityGapRowSpaceBetween() {
+    let settings = new BlokContainerUserSettings();
+    settings.justifyContent = Css.Justifications.SPACE_BETWEEN;
+    settings.gap = 10;
+
+    checkParity(settings);
+}
+
+TestFramework.run("blok-container-layout-one-deep.ai", testFixture);
+TestFramework.run("blok-container-layout-one-deep-3.ai", testFixture);
+TestFramework.run("blok-container-layout-two-deep.ai", testFixture);
+TestFramework.run("blok-container-layout-nested-groups.ai", testFixture);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testFixture);
+TestFramework.run("../../../sample-files/simple-list.ai", testSampleFile);
+TestFramework.run("../../../sample-files/variable-list.ai", testSampleFile);
+TestFramework.run("../../../sample-files/grid.ai", testSampleFile);
+TestFramework.run("blok-container-layout-two-deep.ai", testRepeatedRows);
+TestFramework.run("blok-container-layout-two-deep.ai", testManyRoots);
+TestFramework.run("blok-container-layout-one-deep.ai", testParity);
+TestFramework.run("blok-container-layout-one-deep-3.ai", testParity);
+TestFramework.run("blok-container-layout-two-deep.ai", testParity);
+TestFramework.run("blok-container-layout-nested-groups.ai", testParity);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testParity);
+TestFramework.run("blok-container-layout-one-deep.ai", testParityGapRow);
+TestFramework.run("blok-container-layout-one-deep.ai", testParityGapColumn);
+TestFramework.run("blok-container-layout-one-deep-textframearea.ai", testParityGapRowSpaceBetween);